@@ -0,0 +1,336 @@
+#include "AssetRegistry.h"
+#include "ObjLoader.h"
+#include "Logger.h"
+#include "../VulkanCore/Texture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace EngineCore
+{
+
+	static inline uint64_t RotateLeft(uint64_t Value, int8_t Bits)
+	{
+		return (Value << Bits) | (Value >> (64 - Bits));
+	}
+
+	static inline uint64_t FinalMix(uint64_t Value)
+	{
+		Value ^= Value >> 33;
+		Value *= 0xFF51AFD7ED558CCDull;
+		Value ^= Value >> 33;
+		Value *= 0xC4CEB9FE1A85EC53ull;
+		Value ^= Value >> 33;
+		return Value;
+	}
+
+	static double SecondsSince(std::chrono::steady_clock::time_point Start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+
+	// MurmurHash3_x64_128, fast enough to hash whole files on load and wide enough that accidental collisions don't matter
+	ContentHash HashContent(const void* Data, size_t Size, uint64_t Seed)
+	{
+		const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+		const size_t NumBlocks = Size / 16;
+
+		uint64_t H1 = Seed;
+		uint64_t H2 = Seed;
+
+		const uint64_t C1 = 0x87C37B91114253D5ull;
+		const uint64_t C2 = 0x4CF5AD432745937Full;
+
+		for(size_t Block = 0; Block < NumBlocks; Block++)
+		{
+			uint64_t K1;
+			uint64_t K2;
+			memcpy(&K1, Bytes + Block * 16, sizeof(uint64_t));
+			memcpy(&K2, Bytes + Block * 16 + 8, sizeof(uint64_t));
+
+			K1 *= C1; K1 = RotateLeft(K1, 31); K1 *= C2; H1 ^= K1;
+			H1 = RotateLeft(H1, 27); H1 += H2; H1 = H1 * 5 + 0x52DCE729;
+
+			K2 *= C2; K2 = RotateLeft(K2, 33); K2 *= C1; H2 ^= K2;
+			H2 = RotateLeft(H2, 31); H2 += H1; H2 = H2 * 5 + 0x38495AB5;
+		}
+
+		const uint8_t* Tail = Bytes + NumBlocks * 16;
+		uint64_t K1 = 0;
+		uint64_t K2 = 0;
+
+		switch(Size & 15)
+		{
+		case 15: K2 ^= (uint64_t)Tail[14] << 48; [[fallthrough]];
+		case 14: K2 ^= (uint64_t)Tail[13] << 40; [[fallthrough]];
+		case 13: K2 ^= (uint64_t)Tail[12] << 32; [[fallthrough]];
+		case 12: K2 ^= (uint64_t)Tail[11] << 24; [[fallthrough]];
+		case 11: K2 ^= (uint64_t)Tail[10] << 16; [[fallthrough]];
+		case 10: K2 ^= (uint64_t)Tail[9] << 8; [[fallthrough]];
+		case 9:
+			K2 ^= (uint64_t)Tail[8];
+			K2 *= C2; K2 = RotateLeft(K2, 33); K2 *= C1; H2 ^= K2;
+			[[fallthrough]];
+		case 8: K1 ^= (uint64_t)Tail[7] << 56; [[fallthrough]];
+		case 7: K1 ^= (uint64_t)Tail[6] << 48; [[fallthrough]];
+		case 6: K1 ^= (uint64_t)Tail[5] << 40; [[fallthrough]];
+		case 5: K1 ^= (uint64_t)Tail[4] << 32; [[fallthrough]];
+		case 4: K1 ^= (uint64_t)Tail[3] << 24; [[fallthrough]];
+		case 3: K1 ^= (uint64_t)Tail[2] << 16; [[fallthrough]];
+		case 2: K1 ^= (uint64_t)Tail[1] << 8; [[fallthrough]];
+		case 1:
+			K1 ^= (uint64_t)Tail[0];
+			K1 *= C1; K1 = RotateLeft(K1, 31); K1 *= C2; H1 ^= K1;
+		}
+
+		H1 ^= Size;
+		H2 ^= Size;
+
+		H1 += H2;
+		H2 += H1;
+
+		H1 = FinalMix(H1);
+		H2 = FinalMix(H2);
+
+		H1 += H2;
+		H2 += H1;
+
+		return ContentHash{H1, H2};
+	}
+
+	AssetRegistry::AssetRegistry(const std::string& Name)
+		: DebugName{"Asset Registry: " + Name}
+	{
+	}
+
+	std::shared_ptr<StaticMesh> AssetRegistry::AcquireMesh(const std::string& Path)
+	{
+		std::error_code Error;
+		const std::filesystem::path CanonicalPath = std::filesystem::weakly_canonical(Path, Error);
+		const std::string PathKey = Error ? Path : CanonicalPath.string();
+
+		const std::filesystem::file_time_type WriteTime = std::filesystem::last_write_time(PathKey, Error);
+		const uintmax_t FileSize = Error ? 0 : std::filesystem::file_size(PathKey, Error);
+		if(Error)
+		{
+			BE_ERROR("{0}: can't read mesh {1}, {2}", DebugName, Path, Error.message());
+			return nullptr;
+		}
+
+		uint32_t ChunkVertices = 0;
+		uint32_t ChunkIndices = 0;
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+
+			ChunkVertices = MaxChunkVertices;
+			ChunkIndices = MaxChunkIndices;
+
+			// Unchanged files are found without touching their contents
+			auto PathItr = Paths.find(PathKey);
+			if(PathItr != Paths.end() && PathItr->second.WriteTime == WriteTime && PathItr->second.FileSize == FileSize)
+			{
+				if(std::shared_ptr<StaticMesh> Existing = FindMesh(PathItr->second.Hash))
+				{
+					RecordMeshHit(Existing, PathItr->second.Hash);
+					return Existing;
+				}
+			}
+		}
+
+		const auto LoadStart = std::chrono::steady_clock::now();
+
+		std::ifstream File(PathKey, std::ios::binary);
+		std::vector<char> Bytes((size_t)FileSize);
+		if(!File || !File.read(Bytes.data(), (std::streamsize)FileSize))
+		{
+			BE_ERROR("{0}: failed to read mesh {1}", DebugName, Path);
+			return nullptr;
+		}
+
+		const auto HashStart = std::chrono::steady_clock::now();
+		const ContentHash Hash = HashContent(Bytes.data(), Bytes.size());
+		const double HashSeconds = SecondsSince(HashStart);
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+
+			Stats.BytesHashed += Bytes.size();
+			Stats.HashSeconds += HashSeconds;
+			Paths[PathKey] = PathEntry{Hash, WriteTime, FileSize};
+
+			if(std::shared_ptr<StaticMesh> Existing = FindMesh(Hash))
+			{
+				RecordMeshHit(Existing, Hash);
+				return Existing;
+			}
+		}
+
+		// Parsed outside the lock, other meshes can be acquired meanwhile
+		OBJLoader Loader(ChunkVertices, ChunkIndices);
+		std::shared_ptr<StaticMesh> LoadedMesh = Loader.Load(Bytes);
+
+		// The loader still returns a mesh when parsing fails, it just has no geometry. Not cached, so a fixed file is picked up next time.
+		const bool bHasGeometry = LoadedMesh && std::any_of(LoadedMesh->Models.begin(), LoadedMesh->Models.end(), [](const Model& MeshModel)
+		{
+			return !MeshModel.Vertices.empty() && !MeshModel.Indices.empty();
+		});
+
+		if(!bHasGeometry)
+		{
+			BE_ERROR("{0}: mesh {1} has no geometry", DebugName, Path);
+			return nullptr;
+		}
+
+		LoadedMesh->SourcePath = PathKey;
+		LoadedMesh->ReloadSource = [PathKey, ChunkVertices, ChunkIndices]()
+		{
+			OBJLoader Loader(ChunkVertices, ChunkIndices);
+			return Loader.Load(PathKey);
+		};
+
+		const double LoadSeconds = SecondsSince(LoadStart);
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		// Another thread could have loaded the same content in the meantime, everyone has to end up with the same mesh
+		if(std::shared_ptr<StaticMesh> Existing = FindMesh(Hash))
+		{
+			RecordMeshHit(Existing, Hash);
+			return Existing;
+		}
+
+		Meshes[Hash] = MeshEntry{LoadedMesh, LoadSeconds};
+		Stats.MeshLoads++;
+		Stats.LoadSeconds += LoadSeconds;
+
+		return LoadedMesh;
+	}
+
+	std::shared_ptr<VulkanCore::Texture> AssetRegistry::AcquireTexture(const VulkanCore::TextureCreateInfo& CreateInfo, const void* Payload, size_t PayloadSize,
+																	   const TextureFactory& Create)
+	{
+		// The same texels make a different texture with another type, format, size or sample count, so those are part of the key
+		struct TextureKey
+		{
+			VkImageType Type;
+			VkFormat Format;
+			VkExtent3D Extents;
+			uint32_t NumMipLevels;
+			uint32_t LayerCount;
+			VkImageUsageFlags UsageFlags;
+			VkImageCreateFlags Flags;
+			VkSampleCountFlagBits MsaaSamples;
+		};
+
+		TextureKey Key{};
+		Key.Type = CreateInfo.Type;
+		Key.Format = CreateInfo.Format;
+		Key.Extents = CreateInfo.Extents;
+		Key.NumMipLevels = CreateInfo.NumMipLevels;
+		Key.LayerCount = CreateInfo.LayerCount;
+		Key.UsageFlags = CreateInfo.UsageFlags;
+		Key.Flags = CreateInfo.Flags;
+		Key.MsaaSamples = CreateInfo.MsaaSamples;
+
+		const auto HashStart = std::chrono::steady_clock::now();
+		const ContentHash KeyHash = HashContent(&Key, sizeof(TextureKey));
+		const ContentHash Hash = HashContent(Payload, PayloadSize, KeyHash.Low ^ KeyHash.High);
+		const double HashSeconds = SecondsSince(HashStart);
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+
+			Stats.BytesHashed += PayloadSize;
+			Stats.HashSeconds += HashSeconds;
+
+			auto Itr = Textures.find(Hash);
+			if(Itr != Textures.end())
+			{
+				if(std::shared_ptr<VulkanCore::Texture> Existing = Itr->second.Texture.lock())
+				{
+					Stats.TextureHits++;
+					Stats.SavedLoadSeconds += Itr->second.CreateSeconds;
+					Stats.SavedTextureBytes += Existing->GetDeviceSize();
+					return Existing;
+				}
+			}
+		}
+
+		const auto CreateStart = std::chrono::steady_clock::now();
+		std::shared_ptr<VulkanCore::Texture> CreatedTexture = Create();
+		const double CreateSeconds = SecondsSince(CreateStart);
+
+		if(!CreatedTexture)
+		{
+			return nullptr;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		auto Itr = Textures.find(Hash);
+		if(Itr != Textures.end())
+		{
+			if(std::shared_ptr<VulkanCore::Texture> Existing = Itr->second.Texture.lock())
+			{
+				Stats.TextureHits++;
+				return Existing;
+			}
+		}
+
+		Textures[Hash] = TextureEntry{CreatedTexture, CreateSeconds};
+		Stats.TextureCreates++;
+		Stats.LoadSeconds += CreateSeconds;
+
+		return CreatedTexture;
+	}
+
+	void AssetRegistry::SetMeshChunkLimits(uint32_t MaxVertices, uint32_t MaxIndices)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		MaxChunkVertices = MaxVertices;
+		MaxChunkIndices = MaxIndices;
+	}
+
+	void AssetRegistry::PurgeExpired()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		std::erase_if(Meshes, [](const auto& Entry) { return Entry.second.Mesh.expired(); });
+		std::erase_if(Textures, [](const auto& Entry) { return Entry.second.Texture.expired(); });
+		std::erase_if(Paths, [this](const auto& Entry) { return Meshes.find(Entry.second.Hash) == Meshes.end(); });
+	}
+
+	AssetRegistryStats AssetRegistry::GetStats() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		return Stats;
+	}
+
+	void AssetRegistry::LogStats() const
+	{
+		const AssetRegistryStats Current = GetStats();
+
+		BE_INFO("{0}: {1} meshes loaded, {2} reused, {3} textures created, {4} reused", DebugName, Current.MeshLoads, Current.MeshHits,
+				Current.TextureCreates, Current.TextureHits);
+		BE_INFO("{0}: hashed {1} MB in {2:.3f} ms, saved {3:.3f} ms of loading, {4} KB of mesh data and {5} KB of VRAM", DebugName,
+				Current.BytesHashed >> 20, Current.HashSeconds * 1000.0, Current.SavedLoadSeconds * 1000.0, Current.SavedMeshBytes >> 10,
+				Current.SavedTextureBytes >> 10);
+	}
+
+	std::shared_ptr<StaticMesh> AssetRegistry::FindMesh(const ContentHash& Hash)
+	{
+		auto Itr = Meshes.find(Hash);
+		return Itr != Meshes.end() ? Itr->second.Mesh.lock() : nullptr;
+	}
+
+	void AssetRegistry::RecordMeshHit(const std::shared_ptr<StaticMesh>& Mesh, const ContentHash& Hash)
+	{
+		Stats.MeshHits++;
+		Stats.SavedLoadSeconds += Meshes[Hash].LoadSeconds;
+		Stats.SavedMeshBytes += Mesh->TotalVertexSize + Mesh->TotalIndexSize;
+	}
+
+}
\ No newline at end of file
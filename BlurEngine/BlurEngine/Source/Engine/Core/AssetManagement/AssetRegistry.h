@@ -0,0 +1,123 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+#include "../Runtime/Model.h"
+#include "ObjLoader.h"
+
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace VulkanCore
+{
+	class Texture;
+	struct TextureCreateInfo;
+}
+
+namespace EngineCore
+{
+
+// 128 bit MurmurHash3 of an asset's bytes, two assets with the same hash are treated as identical
+struct ContentHash
+{
+	uint64_t Low = 0;
+	uint64_t High = 0;
+
+	bool operator==(const ContentHash& Other) const { return Low == Other.Low && High == Other.High; }
+};
+
+struct ContentHashHasher
+{
+	size_t operator()(const ContentHash& Hash) const { return (size_t)(Hash.Low ^ (Hash.High * 0x9E3779B97F4A7C15ull)); }
+};
+
+ContentHash HashContent(const void* Data, size_t Size, uint64_t Seed = 0);
+
+struct AssetRegistryStats
+{
+	uint32_t MeshLoads = 0;
+	uint32_t MeshHits = 0;
+	uint32_t TextureCreates = 0;
+	uint32_t TextureHits = 0;
+
+	uint64_t BytesHashed = 0;
+	double HashSeconds = 0.0;
+	double LoadSeconds = 0.0;
+
+	// What hits would have cost without deduplication, using the time and memory of the load they reused
+	double SavedLoadSeconds = 0.0;
+	uint64_t SavedMeshBytes = 0;
+	uint64_t SavedTextureBytes = 0;
+};
+
+using TextureFactory = std::function<std::shared_ptr<VulkanCore::Texture>()>;
+
+// Loads every asset once per unique content. Assets are keyed by a hash of their bytes, so the same file under a different
+// path or a byte-identical copy gets the mesh or texture that is already alive. The registry only keeps weak references,
+// the shared_ptr handed out is the reference count and an asset is freed as soon as its last user drops it.
+class AssetRegistry final
+{
+public:
+	MOVABLE_ONLY(AssetRegistry);
+
+	explicit AssetRegistry(const std::string& Name = "");
+
+	// Returns nullptr if the file can't be read. A path seen before is only hashed again if the file changed on disk.
+	std::shared_ptr<StaticMesh> AcquireMesh(const std::string& Path);
+
+	// Meshes loaded afterwards are split into models of at most this many vertices and indices, so every model fits into one range of
+	// the geometry pool they are drawn from. Meshes that are already alive keep their chunks.
+	void SetMeshChunkLimits(uint32_t MaxVertices, uint32_t MaxIndices);
+
+	// Payload is the cooked texel data the texture is filled with. Create is only called if no live texture has the same payload and
+	// create info, it has to upload the payload itself.
+	std::shared_ptr<VulkanCore::Texture> AcquireTexture(const VulkanCore::TextureCreateInfo& CreateInfo, const void* Payload, size_t PayloadSize,
+														const TextureFactory& Create);
+
+	// Forgets assets nobody is using anymore, lookups skip them either way
+	void PurgeExpired();
+
+	AssetRegistryStats GetStats() const;
+	void LogStats() const;
+
+private:
+	struct MeshEntry
+	{
+		std::weak_ptr<StaticMesh> Mesh;
+		double LoadSeconds = 0.0;
+	};
+
+	struct TextureEntry
+	{
+		std::weak_ptr<VulkanCore::Texture> Texture;
+		double CreateSeconds = 0.0;
+	};
+
+	struct PathEntry
+	{
+		ContentHash Hash;
+		std::filesystem::file_time_type WriteTime;
+		uintmax_t FileSize = 0;
+	};
+
+	std::shared_ptr<StaticMesh> FindMesh(const ContentHash& Hash);
+	void RecordMeshHit(const std::shared_ptr<StaticMesh>& Mesh, const ContentHash& Hash);
+
+private:
+	std::unordered_map<ContentHash, MeshEntry, ContentHashHasher> Meshes;
+	std::unordered_map<ContentHash, TextureEntry, ContentHashHasher> Textures;
+	std::unordered_map<std::string, PathEntry> Paths;
+
+	AssetRegistryStats Stats;
+
+	uint32_t MaxChunkVertices = OBJLoader::DEFAULT_MAX_CHUNK_VERTICES;
+	uint32_t MaxChunkIndices = OBJLoader::DEFAULT_MAX_CHUNK_INDICES;
+
+	mutable std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <tiny_obj_loader.h>
 
 #include <functional>
+#include <istream>
+#include <streambuf>
 #include <unordered_map>
 
 namespace std
@@ -49,11 +51,46 @@ namespace std
 
 namespace EngineCore
 {
+
+	// Read-only view of a buffer as a stream, so parsing from memory doesn't copy the file into a string first
+	class MemoryStreamBuffer final : public std::streambuf
+	{
+	public:
+		explicit MemoryStreamBuffer(const std::vector<char>& Buffer)
+		{
+			char* Begin = const_cast<char*>(Buffer.data());
+			setg(Begin, Begin, Begin + Buffer.size());
+		}
+	};
+
+	OBJLoader::OBJLoader(uint32_t InMaxChunkVertices, uint32_t InMaxChunkIndices)
+		: MaxChunkVertices{InMaxChunkVertices}, MaxChunkIndices{InMaxChunkIndices}
+	{
+		// A chunk has to hold at least one triangle
+		ASSERT(MaxChunkVertices >= 3 && MaxChunkIndices >= 3, "OBJ loader chunks are too small to hold a triangle!");
+	}
 	
-	std::shared_ptr<EngineCore::StaticMesh> OBJLoader::Load(const std::string& Filepath)
+	std::shared_ptr<EngineCore::StaticMesh> OBJLoader::Load(const std::vector<char>& Buffer)
 	{
-		std::shared_ptr<StaticMesh> OutMesh = std::make_shared<StaticMesh>();
+		tinyobj::attrib_t Attributes;
+		std::vector<tinyobj::shape_t> Shapes;
+		std::vector<tinyobj::material_t> Materials;
+		std::string Warn, Err;
 
+		// Parses straight out of the buffer, materials are ignored so there is no need for a material reader
+		MemoryStreamBuffer StreamBuffer(Buffer);
+		std::istream Stream(&StreamBuffer);
+
+		if (!tinyobj::LoadObj(&Attributes, &Shapes, &Materials, &Warn, &Err, &Stream))
+		{
+			BE_ERROR("{0}", Warn + Err);
+		}
+
+		return BuildMesh(Attributes, Shapes, "");
+	}
+
+	std::shared_ptr<EngineCore::StaticMesh> OBJLoader::Load(const std::string& Filepath)
+	{
 		tinyobj::attrib_t Attributes; // stores position, color, normal, uv, etc
 		std::vector<tinyobj::shape_t> Shapes; // stores the index values for each face element
 		std::vector<tinyobj::material_t> Materials; // .obj files can define specific materials per face, we currently ignore this
@@ -64,14 +101,40 @@ namespace EngineCore
 			BE_ERROR("{0}", Warn + Err);
 		}
 
+		std::shared_ptr<StaticMesh> OutMesh = BuildMesh(Attributes, Shapes, Filepath);
+
+		// Reloaded with the same chunk limits, otherwise the models wouldn't line up with the ones on the GPU
+		OutMesh->ReloadSource = [Filepath, ChunkVertices = MaxChunkVertices, ChunkIndices = MaxChunkIndices]()
+		{
+			OBJLoader Loader(ChunkVertices, ChunkIndices);
+			return Loader.Load(Filepath);
+		};
+
+		return OutMesh;
+	}
+
+	std::shared_ptr<StaticMesh> OBJLoader::BuildMesh(const tinyobj::attrib_t& Attributes, const std::vector<tinyobj::shape_t>& Shapes, const std::string& SourcePath)
+	{
+		std::shared_ptr<StaticMesh> OutMesh = std::make_shared<StaticMesh>();
+		OutMesh->SourcePath = SourcePath;
+
 		Model NewModel;
 		std::unordered_map<EngineCore::Vertex, uint32_t> UniqueVerticies{};
 
 		// The load function already triangulates faces; at this point it can be assumed that there are 3 vertices on each face
 		for(auto Itr = Shapes.begin(); Itr != Shapes.end(); Itr++)
 		{
+			size_t Corner = 0;
 			for(const tinyobj::index_t Index : Itr._Ptr->mesh.indices)
 			{
+				// Chunks are only cut between triangles, deduplication starts over in every chunk so its indices stay local
+				const bool bTriangleStart = Corner++ % 3 == 0;
+				if(bTriangleStart && (NewModel.Vertices.size() + 3 > MaxChunkVertices || NewModel.Indices.size() + 3 > MaxChunkIndices))
+				{
+					FinishChunk(*OutMesh, NewModel);
+					UniqueVerticies.clear();
+				}
+
 				Vertex NewVertex{};
 
 				if(Index.vertex_index >= 0)
@@ -116,19 +179,37 @@ namespace EngineCore
 			}
 		}
 
-		CalculateTangentBasis(NewModel);
-
-		NewModel.Extents = (NewModel.MaxAABB - NewModel.MinAABB) * 0.5f;
-		NewModel.Center = NewModel.MinAABB + NewModel.Extents;
+		if(!NewModel.Indices.empty() || OutMesh->Models.empty())
+		{
+			FinishChunk(*OutMesh, NewModel);
+		}
 
-		OutMesh->Models.push_back(NewModel);
-		OutMesh->IndexCount += (uint32_t)NewModel.Indices.size();
-		OutMesh->TotalVertexSize += sizeof(Vertex) * (uint32_t)OutMesh->Models.back().Vertices.size();
-		OutMesh->TotalIndexSize += sizeof(uint32_t) * (uint32_t)OutMesh->Models.back().Indices.size();
+#if _DEBUG
+		if(OutMesh->Models.size() > 1)
+		{
+			BE_INFO("{0} was split into {1} chunks ({2} indices)", SourcePath.empty() ? "OBJ buffer" : SourcePath, OutMesh->Models.size(), OutMesh->IndexCount);
+		}
+#endif
 		
 		return OutMesh;
 	}
 
+	void OBJLoader::FinishChunk(StaticMesh& OutMesh, Model& OutModel)
+	{
+		CalculateTangentBasis(OutModel);
+
+		OutModel.Extents = (OutModel.MaxAABB - OutModel.MinAABB) * 0.5f;
+		OutModel.Center = OutModel.MinAABB + OutModel.Extents;
+
+		OutMesh.IndexCount += OutModel.Indices.size();
+		OutMesh.TotalVertexSize += sizeof(Vertex) * (uint64_t)OutModel.Vertices.size();
+		OutMesh.TotalIndexSize += sizeof(uint32_t) * (uint64_t)OutModel.Indices.size();
+
+		// Moved so the chunk's memory isn't held twice while the next one is built
+		OutMesh.Models.push_back(std::move(OutModel));
+		OutModel = Model{};
+	}
+
 	void OBJLoader::CalculateAABB(Model& OutModel, const Vertex& InVertex)
 	{
 		if (InVertex.Position.x < OutModel.MinAABB.x)
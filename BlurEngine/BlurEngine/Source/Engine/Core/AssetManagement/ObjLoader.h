@@ -3,19 +3,42 @@
 #include "VulkanCommon.h"
 #include "../Runtime/Model.h"
 
+namespace tinyobj
+{
+	struct attrib_t;
+	struct shape_t;
+}
+
 namespace EngineCore
 {
 	
+// Splits meshes into models of at most MaxChunkVertices vertices and MaxChunkIndices indices while loading, so very large meshes
+// never need a single pool range, upload or draw for all of their geometry. tinyobj parses the whole file up front, the parsed
+// attributes of the entire file are still in memory while the chunks are built.
 class OBJLoader
 {
 public:
+	explicit OBJLoader(uint32_t InMaxChunkVertices = DEFAULT_MAX_CHUNK_VERTICES, uint32_t InMaxChunkIndices = DEFAULT_MAX_CHUNK_INDICES);
+
+	// Meshes loaded from a buffer have no SourcePath or ReloadSource, whoever read the buffer sets them if the CPU data should be reloadable
 	std::shared_ptr<StaticMesh> Load(const std::vector<char>& Buffer);
 	std::shared_ptr<StaticMesh> Load(const std::string& Filepath);
 	// TODO: Multithreaded loading;
 
+public:
+	static constexpr uint32_t DEFAULT_MAX_CHUNK_VERTICES = 256 * 1024;
+	static constexpr uint32_t DEFAULT_MAX_CHUNK_INDICES = 1024 * 1024;
+
 private:
+	std::shared_ptr<StaticMesh> BuildMesh(const tinyobj::attrib_t& Attributes, const std::vector<tinyobj::shape_t>& Shapes, const std::string& SourcePath);
 	void CalculateAABB(Model& OutModel, const Vertex& InVertex);
 	void CalculateTangentBasis(Model& OutModel);
+	// Finishes the model and adds it to the mesh, OutModel is left empty for the next chunk
+	void FinishChunk(StaticMesh& OutMesh, Model& OutModel);
+
+private:
+	uint32_t MaxChunkVertices;
+	uint32_t MaxChunkIndices;
 };
 
 }
\ No newline at end of file
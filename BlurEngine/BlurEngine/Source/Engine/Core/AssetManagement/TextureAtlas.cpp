@@ -0,0 +1,329 @@
+#include "TextureAtlas.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace EngineCore
+{
+
+	void SkylinePacker::Init(uint32_t InWidth, uint32_t InHeight)
+	{
+		Width = InWidth;
+		Height = InHeight;
+		UsedArea = 0;
+
+		Skyline.clear();
+		Skyline.push_back({0, 0, Width});
+	}
+
+	bool SkylinePacker::Pack(uint32_t RectWidth, uint32_t RectHeight, uint32_t& OutX, uint32_t& OutY)
+	{
+		size_t BestIndex = SIZE_MAX;
+		uint32_t BestY = UINT32_MAX;
+		uint32_t BestBottom = UINT32_MAX;
+		uint32_t BestWidth = UINT32_MAX;
+
+		// Pick the placement with the lowest top edge, ties go to the narrowest segment to leave wide gaps for wide rects
+		for(size_t Index = 0; Index < Skyline.size(); Index++)
+		{
+			const uint32_t Y = FindPlacement(Index, RectWidth, RectHeight);
+			if(Y == UINT32_MAX)
+			{
+				continue;
+			}
+
+			const uint32_t Bottom = Y + RectHeight;
+			if(Bottom < BestBottom || (Bottom == BestBottom && Skyline[Index].Width < BestWidth))
+			{
+				BestIndex = Index;
+				BestY = Y;
+				BestBottom = Bottom;
+				BestWidth = Skyline[Index].Width;
+			}
+		}
+
+		if(BestIndex == SIZE_MAX)
+		{
+			return false;
+		}
+
+		OutX = Skyline[BestIndex].X;
+		OutY = BestY;
+
+		Skyline.insert(Skyline.begin() + BestIndex, SkylineNode{OutX, BestBottom, RectWidth});
+
+		// Cut the segments now covered by the new one
+		for(size_t Index = BestIndex + 1; Index < Skyline.size();)
+		{
+			const SkylineNode& Previous = Skyline[Index - 1];
+			SkylineNode& Node = Skyline[Index];
+
+			const uint32_t PreviousEnd = Previous.X + Previous.Width;
+			if(Node.X >= PreviousEnd)
+			{
+				break;
+			}
+
+			const uint32_t Overlap = PreviousEnd - Node.X;
+			if(Node.Width > Overlap)
+			{
+				Node.X += Overlap;
+				Node.Width -= Overlap;
+				break;
+			}
+
+			Skyline.erase(Skyline.begin() + Index);
+		}
+
+		for(size_t Index = 0; Index + 1 < Skyline.size();)
+		{
+			if(Skyline[Index].Y == Skyline[Index + 1].Y)
+			{
+				Skyline[Index].Width += Skyline[Index + 1].Width;
+				Skyline.erase(Skyline.begin() + Index + 1);
+			}
+			else
+			{
+				Index++;
+			}
+		}
+
+		UsedArea += (uint64_t)RectWidth * RectHeight;
+		return true;
+	}
+
+	uint32_t SkylinePacker::FindPlacement(size_t NodeIndex, uint32_t RectWidth, uint32_t RectHeight) const
+	{
+		if(Skyline[NodeIndex].X + RectWidth > Width)
+		{
+			return UINT32_MAX;
+		}
+
+		uint32_t Y = 0;
+		uint32_t RemainingWidth = RectWidth;
+		for(size_t Index = NodeIndex; RemainingWidth > 0; Index++)
+		{
+			Y = std::max(Y, Skyline[Index].Y);
+			if(Y + RectHeight > Height)
+			{
+				return UINT32_MAX;
+			}
+
+			RemainingWidth -= std::min(RemainingWidth, Skyline[Index].Width);
+		}
+
+		return Y;
+	}
+
+	TextureAtlas::TextureAtlas(uint32_t InPageSize, uint32_t InPadding, uint32_t InMipLevels, uint32_t InMaxPages, const std::string& Name)
+		: PageSize{InPageSize}, MipLevels{InMipLevels}, MaxPages{InMaxPages}, DebugName{Name}
+	{
+		ASSERT(MipLevels > 0, "Texture atlas needs at least one mip level");
+
+		MipAlignment = 1u << (MipLevels - 1);
+		Gutter = InPadding * MipAlignment;
+
+		ASSERT(MipAlignment <= PageSize, "Texture atlas has more mip levels than its page size allows");
+	}
+
+	uint32_t TextureAtlas::AddTexture(const AtlasSource& Source)
+	{
+		if(!CanAtlas(Source.Width, Source.Height))
+		{
+			return INVALID_ENTRY;
+		}
+
+		return PlaceEntry(Source);
+	}
+
+	std::vector<uint32_t> TextureAtlas::AddTextures(const std::vector<AtlasSource>& Sources)
+	{
+		std::vector<uint32_t> Results(Sources.size(), INVALID_ENTRY);
+
+		// Tallest first, skyline packing wastes the least space when rows are filled with similar heights
+		std::vector<size_t> PackOrder(Sources.size());
+		std::iota(PackOrder.begin(), PackOrder.end(), 0);
+		std::stable_sort(PackOrder.begin(), PackOrder.end(), [&Sources](size_t A, size_t B)
+		{
+			if(Sources[A].Height != Sources[B].Height)
+			{
+				return Sources[A].Height > Sources[B].Height;
+			}
+
+			return Sources[A].Width > Sources[B].Width;
+		});
+
+		for(const size_t SourceIndex : PackOrder)
+		{
+			Results[SourceIndex] = AddTexture(Sources[SourceIndex]);
+		}
+
+#if _DEBUG
+		for(uint32_t Page = 0; Page < GetPageCount(); Page++)
+		{
+			BE_INFO("{0}: page {1} is {2:.1f}% occupied", DebugName, Page, GetPageOccupancy(Page) * 100.0f);
+		}
+#endif
+
+		return Results;
+	}
+
+	bool TextureAtlas::CanAtlas(uint32_t Width, uint32_t Height) const
+	{
+		// Anything taking up more than half a page is cheaper to keep as its own texture
+		const uint32_t MaxEntrySize = PageSize / 2;
+		return Width > 0 && Height > 0 && AlignToMip(Width + 2 * Gutter) <= MaxEntrySize && AlignToMip(Height + 2 * Gutter) <= MaxEntrySize;
+	}
+
+	void TextureAtlas::ApplyToMaterial(uint32_t EntryIndex, MaterialTextureSlot Slot, Material& OutMaterial) const
+	{
+		ASSERT(EntryIndex < Entries.size(), "Invalid atlas entry!");
+
+		const AtlasEntry& Entry = Entries[EntryIndex];
+		const AtlasPage& Page = Pages[Entry.Page];
+
+		switch(Slot)
+		{
+		case MaterialTextureSlot::BaseColor:
+			OutMaterial.BaseColorIDs.x = (float)Page.TextureID;
+			OutMaterial.BaseColorIDs.y = (float)Page.SamplerID;
+			OutMaterial.BaseColorUVTransform = Entry.UVTransform;
+			break;
+		case MaterialTextureSlot::Metallic:
+			OutMaterial.MetallicData.x = (float)Page.TextureID;
+			OutMaterial.MetallicData.y = (float)Page.SamplerID;
+			OutMaterial.MetallicUVTransform = Entry.UVTransform;
+			break;
+		case MaterialTextureSlot::Normal:
+			OutMaterial.NormalIDs.x = (float)Page.TextureID;
+			OutMaterial.NormalIDs.y = (float)Page.SamplerID;
+			OutMaterial.NormalUVTransform = Entry.UVTransform;
+			break;
+		case MaterialTextureSlot::Emissive:
+			OutMaterial.EmissiveIDs.x = (float)Page.TextureID;
+			OutMaterial.EmissiveIDs.y = (float)Page.SamplerID;
+			OutMaterial.EmissiveUVTransform = Entry.UVTransform;
+			break;
+		}
+	}
+
+	void TextureAtlas::SetPageIDs(uint32_t Page, int32_t TextureID, int32_t SamplerID)
+	{
+		ASSERT(Page < Pages.size(), "Invalid atlas page!");
+
+		Pages[Page].TextureID = TextureID;
+		Pages[Page].SamplerID = SamplerID;
+	}
+
+	bool TextureAtlas::ConsumeDirtyRegion(uint32_t Page, AtlasRect& OutRegion)
+	{
+		ASSERT(Page < Pages.size(), "Invalid atlas page!");
+
+		if(!Pages[Page].bDirty)
+		{
+			return false;
+		}
+
+		OutRegion = Pages[Page].DirtyRegion;
+		Pages[Page].bDirty = false;
+		return true;
+	}
+
+	uint32_t TextureAtlas::CreatePage()
+	{
+		AtlasPage NewPage;
+		NewPage.Packer.Init(PageSize, PageSize);
+		NewPage.Pixels.assign((size_t)PageSize * PageSize * BYTES_PER_PIXEL, 0);
+
+		Pages.emplace_back(std::move(NewPage));
+		return (uint32_t)Pages.size() - 1;
+	}
+
+	uint32_t TextureAtlas::PlaceEntry(const AtlasSource& Source)
+	{
+		ASSERT(Source.Pixels != nullptr, "Atlas source has no pixel data!");
+
+		AtlasRect PaddedRect;
+		PaddedRect.Width = AlignToMip(Source.Width + 2 * Gutter);
+		PaddedRect.Height = AlignToMip(Source.Height + 2 * Gutter);
+
+		uint32_t PageIndex = 0;
+		while(PageIndex < (uint32_t)Pages.size() && !Pages[PageIndex].Packer.Pack(PaddedRect.Width, PaddedRect.Height, PaddedRect.X, PaddedRect.Y))
+		{
+			PageIndex++;
+		}
+
+		if(PageIndex == (uint32_t)Pages.size())
+		{
+			if(Pages.size() >= MaxPages)
+			{
+				BE_WARN("{0}: every page is full, texture of size {1} x {2} won't be atlased", DebugName, Source.Width, Source.Height);
+				return INVALID_ENTRY;
+			}
+
+			PageIndex = CreatePage();
+			const bool bPacked = Pages[PageIndex].Packer.Pack(PaddedRect.Width, PaddedRect.Height, PaddedRect.X, PaddedRect.Y);
+			ASSERT(bPacked, "Texture doesn't fit into an empty atlas page!");
+		}
+
+		AtlasPage& Page = Pages[PageIndex];
+		CopyWithGutter(Page, Source, PaddedRect);
+
+		AtlasEntry NewEntry;
+		NewEntry.Page = PageIndex;
+		NewEntry.Rect = {PaddedRect.X + Gutter, PaddedRect.Y + Gutter, Source.Width, Source.Height};
+
+		const float InvPageSize = 1.0f / (float)PageSize;
+		NewEntry.UVTransform = glm::vec4(Source.Width * InvPageSize, Source.Height * InvPageSize, NewEntry.Rect.X * InvPageSize, NewEntry.Rect.Y * InvPageSize);
+
+		Entries.emplace_back(NewEntry);
+		return (uint32_t)Entries.size() - 1;
+	}
+
+	void TextureAtlas::CopyWithGutter(AtlasPage& Page, const AtlasSource& Source, const AtlasRect& PaddedRect)
+	{
+		const size_t SourcePitch = (size_t)Source.Width * BYTES_PER_PIXEL;
+		const size_t PagePitch = (size_t)PageSize * BYTES_PER_PIXEL;
+
+		// The gutter repeats the closest edge texel, which is what clamp-to-edge sampling would return
+		for(uint32_t Row = 0; Row < PaddedRect.Height; Row++)
+		{
+			const uint32_t SourceRow = (uint32_t)std::clamp((int64_t)Row - (int64_t)Gutter, (int64_t)0, (int64_t)Source.Height - 1);
+			const uint8_t* SourceLine = Source.Pixels + SourceRow * SourcePitch;
+			uint8_t* PageLine = Page.Pixels.data() + (PaddedRect.Y + Row) * PagePitch + (size_t)PaddedRect.X * BYTES_PER_PIXEL;
+
+			for(uint32_t Column = 0; Column < Gutter; Column++)
+			{
+				memcpy(PageLine + (size_t)Column * BYTES_PER_PIXEL, SourceLine, BYTES_PER_PIXEL);
+			}
+
+			memcpy(PageLine + (size_t)Gutter * BYTES_PER_PIXEL, SourceLine, SourcePitch);
+
+			const uint8_t* LastTexel = SourceLine + SourcePitch - BYTES_PER_PIXEL;
+			for(uint32_t Column = Gutter + Source.Width; Column < PaddedRect.Width; Column++)
+			{
+				memcpy(PageLine + (size_t)Column * BYTES_PER_PIXEL, LastTexel, BYTES_PER_PIXEL);
+			}
+		}
+
+		if(!Page.bDirty)
+		{
+			Page.DirtyRegion = PaddedRect;
+			Page.bDirty = true;
+			return;
+		}
+
+		const uint32_t MinX = std::min(Page.DirtyRegion.X, PaddedRect.X);
+		const uint32_t MinY = std::min(Page.DirtyRegion.Y, PaddedRect.Y);
+		const uint32_t MaxX = std::max(Page.DirtyRegion.X + Page.DirtyRegion.Width, PaddedRect.X + PaddedRect.Width);
+		const uint32_t MaxY = std::max(Page.DirtyRegion.Y + Page.DirtyRegion.Height, PaddedRect.Y + PaddedRect.Height);
+		Page.DirtyRegion = {MinX, MinY, MaxX - MinX, MaxY - MinY};
+	}
+
+	uint32_t TextureAtlas::AlignToMip(uint32_t Value) const
+	{
+		return (Value + MipAlignment - 1) & ~(MipAlignment - 1);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "../Runtime/Model.h"
+
+#include <vector>
+
+namespace EngineCore
+{
+
+struct AtlasRect
+{
+	uint32_t X = 0;
+	uint32_t Y = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+};
+
+// Bottom-left skyline packer, keeps the top edge of the packed rects as a list of horizontal segments
+class SkylinePacker
+{
+public:
+	void Init(uint32_t InWidth, uint32_t InHeight);
+
+	// Returns false if the rect doesn't fit anywhere
+	bool Pack(uint32_t RectWidth, uint32_t RectHeight, uint32_t& OutX, uint32_t& OutY);
+
+	float GetOccupancy() const { return (float)UsedArea / ((float)Width * (float)Height); }
+
+private:
+	struct SkylineNode
+	{
+		uint32_t X;
+		uint32_t Y;
+		uint32_t Width;
+	};
+
+	// Returns the lowest Y a rect starting at the node can be placed at, or UINT32_MAX if it doesn't fit
+	uint32_t FindPlacement(size_t NodeIndex, uint32_t RectWidth, uint32_t RectHeight) const;
+
+	std::vector<SkylineNode> Skyline;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint64_t UsedArea = 0;
+};
+
+struct AtlasSource
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	const uint8_t* Pixels = nullptr; // RGBA8, tightly packed
+};
+
+struct AtlasEntry
+{
+	uint32_t Page = 0;
+	AtlasRect Rect; // Texels of the texture itself, without gutters
+	glm::vec4 UVTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f); // XY = scale, ZW = offset
+};
+
+enum class MaterialTextureSlot
+{
+	BaseColor,
+	Metallic,
+	Normal,
+	Emissive
+};
+
+// Packs small RGBA8 textures into shared pages so they can be bound as a single texture.
+// Every entry is surrounded by a gutter of its own edge texels that is wide enough to survive down to the last mip,
+// so bilinear filtering and mipmapping never bleed neighbouring entries into each other.
+class TextureAtlas
+{
+public:
+	TextureAtlas(uint32_t InPageSize, uint32_t InPadding, uint32_t InMipLevels, uint32_t InMaxPages, const std::string& Name = "");
+
+	// Packs a single texture into the first page it fits in, used for textures streamed in at runtime.
+	// Returns INVALID_ENTRY if the texture is too big to be worth atlasing or every page is full.
+	uint32_t AddTexture(const AtlasSource& Source);
+
+	// Packs a whole set of textures at once, sorting them first for a tighter packing. Used by the asset pipeline.
+	// Entries are returned in the same order as the sources.
+	std::vector<uint32_t> AddTextures(const std::vector<AtlasSource>& Sources);
+
+	bool CanAtlas(uint32_t Width, uint32_t Height) const;
+
+	// Points the material's texture at the atlas page and rewrites the UV transform to the entry's region
+	void ApplyToMaterial(uint32_t EntryIndex, MaterialTextureSlot Slot, Material& OutMaterial) const;
+
+	// Texture and sampler IDs the page was uploaded with
+	void SetPageIDs(uint32_t Page, int32_t TextureID, int32_t SamplerID);
+
+	const AtlasEntry& GetEntry(uint32_t EntryIndex) const { return Entries[EntryIndex]; }
+	uint32_t GetPageCount() const { return (uint32_t)Pages.size(); }
+	uint32_t GetPageSize() const { return PageSize; }
+	uint32_t GetMipLevels() const { return MipLevels; }
+	const std::vector<uint8_t>& GetPagePixels(uint32_t Page) const { return Pages[Page].Pixels; }
+	float GetPageOccupancy(uint32_t Page) const { return Pages[Page].Packer.GetOccupancy(); }
+
+	// Returns the region of the page that changed since the last call, false if nothing changed
+	bool ConsumeDirtyRegion(uint32_t Page, AtlasRect& OutRegion);
+
+public:
+	static constexpr uint32_t INVALID_ENTRY = UINT32_MAX;
+	static constexpr uint32_t BYTES_PER_PIXEL = 4;
+
+private:
+	struct AtlasPage
+	{
+		SkylinePacker Packer;
+		std::vector<uint8_t> Pixels;
+
+		int32_t TextureID = -1;
+		int32_t SamplerID = -1;
+
+		bool bDirty = false;
+		AtlasRect DirtyRegion;
+	};
+
+	uint32_t CreatePage();
+	uint32_t PlaceEntry(const AtlasSource& Source);
+	void CopyWithGutter(AtlasPage& Page, const AtlasSource& Source, const AtlasRect& PaddedRect);
+
+	uint32_t AlignToMip(uint32_t Value) const;
+
+private:
+	uint32_t PageSize = 0;
+	uint32_t MipLevels = 1;
+	uint32_t MaxPages = 1;
+	// Gutter on each side of an entry in texels of mip 0
+	uint32_t Gutter = 0;
+	// Entries start and end on multiples of this so their edges line up with texels in every mip
+	uint32_t MipAlignment = 1;
+
+	std::vector<AtlasPage> Pages;
+	std::vector<AtlasEntry> Entries;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
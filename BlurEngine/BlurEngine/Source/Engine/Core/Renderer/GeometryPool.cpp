@@ -0,0 +1,480 @@
+#include "GeometryPool.h"
+#include "../VulkanCore/Context.h"
+#include "../VulkanCore/Buffer.h"
+#include "../VulkanCore/Pipeline.h"
+#include "../VulkanCore/StagingRing.h"
+#include "../VulkanCore/BarrierBuilder.h"
+#include "../VulkanCore/Defragmenter.h"
+
+#include <algorithm>
+#include <array>
+
+// Each pool is a single buffer bound as one storage buffer, so it can't be larger than one binding or one allocation allows
+static uint32_t ClampPoolSize(const VulkanCore::Context& DeviceContext, uint32_t Count, VkDeviceSize ElementSize, const char* PoolName)
+{
+	VkPhysicalDeviceMaintenance3Properties Maintenance3Properties{};
+	Maintenance3Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_3_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 Properties{};
+	Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	Properties.pNext = &Maintenance3Properties;
+	vkGetPhysicalDeviceProperties2(DeviceContext.GetPhysicalDevice().GetVkPhysicalDevice(), &Properties);
+
+	const VkDeviceSize MaxSize = std::min<VkDeviceSize>(Properties.properties.limits.maxStorageBufferRange, Maintenance3Properties.maxMemoryAllocationSize);
+	if((VkDeviceSize)Count * ElementSize <= MaxSize)
+	{
+		return Count;
+	}
+
+	const uint32_t ClampedCount = (uint32_t)(MaxSize / ElementSize);
+	BE_WARN("Geometry pool {0} was asked for {1} elements, the device only allows {2}", PoolName, Count, ClampedCount);
+	return ClampedCount;
+}
+
+GeometryPool::FreeList::FreeList(uint32_t InCapacity)
+	: FreeCount{InCapacity}, Capacity{InCapacity}
+{
+	if(InCapacity > 0)
+	{
+		FreeRanges[0] = InCapacity;
+	}
+}
+
+uint32_t GeometryPool::FreeList::Allocate(uint32_t Count)
+{
+	for(auto Itr = FreeRanges.begin(); Itr != FreeRanges.end(); ++Itr)
+	{
+		if(Itr->second < Count)
+		{
+			continue;
+		}
+
+		const uint32_t Offset = Itr->first;
+		const uint32_t Remaining = Itr->second - Count;
+
+		FreeRanges.erase(Itr);
+		if(Remaining > 0)
+		{
+			FreeRanges[Offset + Count] = Remaining;
+		}
+
+		FreeCount -= Count;
+		return Offset;
+	}
+
+	return INVALID_OFFSET;
+}
+
+void GeometryPool::FreeList::Free(uint32_t Offset, uint32_t Count)
+{
+	if(Count == 0)
+	{
+		return;
+	}
+
+	FreeCount += Count;
+
+	auto Next = FreeRanges.lower_bound(Offset);
+
+	// Merge with the range right after
+	if(Next != FreeRanges.end() && Offset + Count == Next->first)
+	{
+		Count += Next->second;
+		Next = FreeRanges.erase(Next);
+	}
+
+	// Merge with the range right before
+	if(Next != FreeRanges.begin())
+	{
+		auto Previous = std::prev(Next);
+		if(Previous->first + Previous->second == Offset)
+		{
+			Previous->second += Count;
+			return;
+		}
+	}
+
+	FreeRanges[Offset] = Count;
+}
+
+GeometryPool::GeometryPool(const VulkanCore::Context& DeviceContext, VulkanCore::UploadScheduler& InUploads, uint32_t InMaxVertices, uint32_t InMaxIndices,
+						   uint32_t InMaxMaterials, uint32_t InMaxDraws, uint32_t InFramesInFlight, const std::string& Name)
+	: Uploads{InUploads}, VertexRanges{ClampPoolSize(DeviceContext, InMaxVertices, sizeof(EngineCore::Vertex), "vertices")},
+	  IndexRanges{ClampPoolSize(DeviceContext, InMaxIndices, sizeof(uint32_t), "indices")},
+	  MaterialRanges{ClampPoolSize(DeviceContext, InMaxMaterials, sizeof(EngineCore::Material), "materials")}, MaxDraws{InMaxDraws}, FramesInFlight{InFramesInFlight}, DebugName{"Geometry Pool: " + Name}
+{
+	// Every pool is filled through copies, transfer source lets the defragmenter move them
+	constexpr VkBufferUsageFlags PoolUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	// Vertices are pulled in the vertex shader, so the vertex pool is only ever read as a storage buffer
+	VertexBuffer = DeviceContext.CreateBuffer((VkDeviceSize)VertexRanges.GetFreeCount() * sizeof(EngineCore::Vertex), PoolUsage,
+											  VulkanCore::MemoryUsagePolicy::GPUOnly, DebugName + " Vertices");
+	VertexBuffer->SetMemoryCategory(VulkanCore::MemoryCategory::Meshes);
+
+	IndexBuffer = DeviceContext.CreateBuffer((VkDeviceSize)IndexRanges.GetFreeCount() * sizeof(uint32_t), PoolUsage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+											 VulkanCore::MemoryUsagePolicy::GPUOnly, DebugName + " Indices");
+	IndexBuffer->SetMemoryCategory(VulkanCore::MemoryCategory::Meshes);
+
+	IndirectBuffer = DeviceContext.CreateBuffer((VkDeviceSize)InMaxDraws * sizeof(EngineCore::IndirectDrawData), PoolUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+												VulkanCore::MemoryUsagePolicy::GPUOnly, DebugName + " Draws");
+	IndirectBuffer->SetMemoryCategory(VulkanCore::MemoryCategory::Meshes);
+
+	MaterialBuffer = DeviceContext.CreateBuffer((VkDeviceSize)MaterialRanges.GetFreeCount() * sizeof(EngineCore::Material), PoolUsage,
+												VulkanCore::MemoryUsagePolicy::GPUOnly, DebugName + " Materials");
+	MaterialBuffer->SetMemoryCategory(VulkanCore::MemoryCategory::Meshes);
+}
+
+uint32_t GeometryPool::AddMesh(std::shared_ptr<EngineCore::StaticMesh> Mesh, VulkanCore::UploadPriority Priority)
+{
+	ASSERT(Mesh, "Trying to add a null mesh to the geometry pool!");
+
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	// The same asset is only uploaded once, later registrations share its ranges and draws
+	auto ExistingItr = MeshIDs.find(Mesh.get());
+	if(ExistingItr != MeshIDs.end())
+	{
+		Meshes[ExistingItr->second].RefCount++;
+		return ExistingItr->second;
+	}
+
+	// A mesh coming back after being evicted could have dropped its vertices and indices
+	if(!Mesh->RequireCPUData())
+	{
+		return INVALID_MESH;
+	}
+
+	uint64_t VertexCount = 0;
+	uint64_t IndexCount = 0;
+	for(const EngineCore::Model& MeshModel : Mesh->Models)
+	{
+		VertexCount += MeshModel.Vertices.size();
+		IndexCount += MeshModel.Indices.size();
+	}
+
+	ASSERT(VertexCount > 0 && IndexCount > 0, "Trying to add a mesh without any geometry to the geometry pool!");
+
+	// Each model gets its own range, so a mesh that was split into chunks doesn't need one contiguous block of the pool
+	std::vector<std::pair<uint32_t, uint32_t>> ModelRanges;
+	ModelRanges.reserve(Mesh->Models.size());
+
+	for(const EngineCore::Model& MeshModel : Mesh->Models)
+	{
+		const bool bFitsRange = MeshModel.Vertices.size() < FreeList::INVALID_OFFSET && MeshModel.Indices.size() < FreeList::INVALID_OFFSET;
+		const uint32_t ModelVertex = bFitsRange ? VertexRanges.Allocate((uint32_t)MeshModel.Vertices.size()) : FreeList::INVALID_OFFSET;
+		const uint32_t ModelIndex = bFitsRange && ModelVertex != FreeList::INVALID_OFFSET ? IndexRanges.Allocate((uint32_t)MeshModel.Indices.size()) : FreeList::INVALID_OFFSET;
+
+		if(ModelVertex == FreeList::INVALID_OFFSET || ModelIndex == FreeList::INVALID_OFFSET)
+		{
+			BE_ERROR("{0} can't fit a mesh with {1} vertices and {2} indices!", DebugName, VertexCount, IndexCount);
+
+			if(ModelVertex != FreeList::INVALID_OFFSET)
+			{
+				VertexRanges.Free(ModelVertex, (uint32_t)MeshModel.Vertices.size());
+			}
+
+			// Nothing was uploaded yet, so the ranges can be reused right away
+			for(size_t Index = 0; Index < ModelRanges.size(); Index++)
+			{
+				VertexRanges.Free(ModelRanges[Index].first, (uint32_t)Mesh->Models[Index].Vertices.size());
+				IndexRanges.Free(ModelRanges[Index].second, (uint32_t)Mesh->Models[Index].Indices.size());
+			}
+
+			return INVALID_MESH;
+		}
+
+		ModelRanges.emplace_back(ModelVertex, ModelIndex);
+	}
+
+	// Materials of a mesh are one block, so a draw only needs the block's offset added to its mesh local material index
+	const uint32_t MaterialCount = (uint32_t)Mesh->Materials.size();
+	const uint32_t FirstMaterial = MaterialCount > 0 ? MaterialRanges.Allocate(MaterialCount) : 0;
+	if(FirstMaterial == FreeList::INVALID_OFFSET)
+	{
+		BE_ERROR("{0} can't fit a mesh with {1} materials!", DebugName, Mesh->Materials.size());
+
+		for(size_t Index = 0; Index < ModelRanges.size(); Index++)
+		{
+			VertexRanges.Free(ModelRanges[Index].first, (uint32_t)Mesh->Models[Index].Vertices.size());
+			IndexRanges.Free(ModelRanges[Index].second, (uint32_t)Mesh->Models[Index].Indices.size());
+		}
+
+		return INVALID_MESH;
+	}
+
+	uint32_t MeshID = 0;
+	if(!FreeMeshIDs.empty())
+	{
+		MeshID = FreeMeshIDs.back();
+		FreeMeshIDs.pop_back();
+	}
+	else
+	{
+		MeshID = (uint32_t)Meshes.size();
+		Meshes.emplace_back();
+	}
+
+	ResidentMesh NewMesh;
+	NewMesh.RefCount = 1;
+	NewMesh.FirstMaterial = FirstMaterial;
+	NewMesh.MaterialCount = MaterialCount;
+	for(size_t Index = 0; Index < Mesh->Models.size(); Index++)
+	{
+		const EngineCore::Model& MeshModel = Mesh->Models[Index];
+
+		// Indices stay relative to their model, VertexOffset moves them into the model's part of the pool
+		EngineCore::IndirectDrawData DrawData{};
+		DrawData.IndexCount = (uint32_t)MeshModel.Indices.size();
+		DrawData.InstanceCount = 1;
+		DrawData.FirstIndex = ModelRanges[Index].second;
+		DrawData.VertexOffset = (int32_t)ModelRanges[Index].first;
+		DrawData.FirstInstance = 0;
+		DrawData.MeshID = MeshID;
+		// Negative means the model has no material, the shader falls back to a flat color
+		const bool bHasMaterial = MeshModel.MaterialIndex >= 0 && (uint32_t)MeshModel.MaterialIndex < MaterialCount;
+		DrawData.MaterialIndex = bHasMaterial ? (int32_t)(FirstMaterial + MeshModel.MaterialIndex) : -1;
+		NewMesh.Draws.push_back(DrawData);
+
+		NewMesh.Ranges.push_back({ModelRanges[Index].first, (uint32_t)MeshModel.Vertices.size(), ModelRanges[Index].second, (uint32_t)MeshModel.Indices.size()});
+	}
+
+	// Vertices and indices of every model are separate uploads, the scheduler interleaves them with everything else that is streaming
+	auto ScheduleUpload = [&](const void* Data, VkDeviceSize Size, const VulkanCore::Buffer& DstBuffer, VkDeviceSize DstOffset)
+	{
+		if(Size == 0)
+		{
+			return;
+		}
+
+		VulkanCore::UploadRequest Request;
+		Request.Data = Data;
+		Request.Size = Size;
+		Request.Owner = Mesh;
+		Request.DstBuffer = &DstBuffer;
+		Request.DstOffset = DstOffset;
+		Request.Priority = Priority;
+		Request.OnComplete = [this, MeshID](VulkanCore::UploadID ID) { OnUploadComplete(MeshID, ID); };
+
+		NewMesh.PendingUploads.push_back(Uploads.Submit(std::move(Request)));
+	};
+
+	for(size_t Index = 0; Index < Mesh->Models.size(); Index++)
+	{
+		const EngineCore::Model& MeshModel = Mesh->Models[Index];
+		const PoolRange& Range = NewMesh.Ranges[Index];
+
+		ScheduleUpload(MeshModel.Vertices.data(), MeshModel.Vertices.size() * sizeof(EngineCore::Vertex), *VertexBuffer,
+					   (VkDeviceSize)Range.FirstVertex * sizeof(EngineCore::Vertex));
+		ScheduleUpload(MeshModel.Indices.data(), MeshModel.Indices.size() * sizeof(uint32_t), *IndexBuffer,
+					   (VkDeviceSize)Range.FirstIndex * sizeof(uint32_t));
+	}
+
+	// Materials aren't part of the CPU data a mesh releases, so the upload can read them for as long as it holds the mesh
+	ScheduleUpload(Mesh->Materials.data(), (VkDeviceSize)MaterialCount * sizeof(EngineCore::Material), *MaterialBuffer,
+				   (VkDeviceSize)FirstMaterial * sizeof(EngineCore::Material));
+
+	// The mesh is only drawn once all of it has been streamed to the GPU
+	NewMesh.bUploaded = NewMesh.PendingUploads.empty();
+	MeshIDs[Mesh.get()] = MeshID;
+	NewMesh.Mesh = std::move(Mesh);
+	Meshes[MeshID] = std::move(NewMesh);
+
+	return MeshID;
+}
+
+void GeometryPool::RemoveMesh(uint32_t MeshID)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	if(MeshID >= Meshes.size() || !Meshes[MeshID].Mesh)
+	{
+		BE_ERROR("{0}: trying to remove mesh {1} which isn't in the pool!", DebugName, MeshID);
+		return;
+	}
+
+	ResidentMesh& Removed = Meshes[MeshID];
+	if(--Removed.RefCount > 0)
+	{
+		return;
+	}
+
+	// Copies already in the staging ring still land in the ranges, retiring covers them like it covers frames in flight
+	for(VulkanCore::UploadID ID : Removed.PendingUploads)
+	{
+		Uploads.Cancel(ID);
+	}
+
+	Removed.PendingUploads.clear();
+
+	MeshIDs.erase(Removed.Mesh.get());
+	Removed.Mesh = nullptr;
+
+	RetiredMeshes.push_back({MeshID, CurrentFrame});
+	bDrawsDirty = true;
+}
+
+void GeometryPool::BeginFrame()
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	CurrentFrame++;
+
+	// Same rule as the bindless heap, the last frame that drew the mesh is done once we are FramesInFlight frames past it
+	while(!RetiredMeshes.empty() && RetiredMeshes.front().RetiredFrame + FramesInFlight <= CurrentFrame)
+	{
+		ResidentMesh& Retired = Meshes[RetiredMeshes.front().MeshID];
+		for(const PoolRange& Range : Retired.Ranges)
+		{
+			VertexRanges.Free(Range.FirstVertex, Range.VertexCount);
+			IndexRanges.Free(Range.FirstIndex, Range.IndexCount);
+		}
+
+		MaterialRanges.Free(Retired.FirstMaterial, Retired.MaterialCount);
+
+		Retired = ResidentMesh{};
+
+		FreeMeshIDs.push_back(RetiredMeshes.front().MeshID);
+		RetiredMeshes.pop_front();
+	}
+}
+
+void GeometryPool::UpdateDrawCommands(VulkanCore::StagingRing& DrawUploads, VulkanCore::BarrierBuilder& Barriers)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	if(!bDrawsDirty)
+	{
+		return;
+	}
+
+	std::vector<EngineCore::IndirectDrawData> Draws;
+	for(const ResidentMesh& Resident : Meshes)
+	{
+		if(Resident.Mesh && Resident.bUploaded)
+		{
+			Draws.insert(Draws.end(), Resident.Draws.begin(), Resident.Draws.end());
+		}
+	}
+
+	if(Draws.size() > MaxDraws)
+	{
+		BE_WARN("{0}: {1} draws don't fit into the draw buffer, only the first {2} are drawn", DebugName, Draws.size(), MaxDraws);
+		Draws.resize(MaxDraws);
+	}
+
+	// Only the runs of draws that differ from what the buffer already holds are copied, runs are counted in draws
+	std::vector<VulkanCore::BufferRange> ChangedRuns;
+
+	for(uint32_t DrawIndex = 0; DrawIndex < Draws.size(); DrawIndex++)
+	{
+		const bool bChanged = DrawIndex >= UploadedDraws.size() ||
+							  memcmp(&Draws[DrawIndex], &UploadedDraws[DrawIndex], sizeof(EngineCore::IndirectDrawData)) != 0;
+		if(!bChanged)
+		{
+			continue;
+		}
+
+		// Runs separated by a few unchanged draws are merged, one larger copy is cheaper than several tiny ones
+		if(!ChangedRuns.empty() && DrawIndex <= ChangedRuns.back().Offset + ChangedRuns.back().Size + DRAW_RUN_MERGE_GAP)
+		{
+			ChangedRuns.back().Size = DrawIndex + 1 - ChangedRuns.back().Offset;
+		}
+		else
+		{
+			ChangedRuns.push_back({DrawIndex, 1});
+		}
+	}
+
+	if(!ChangedRuns.empty())
+	{
+		std::vector<VulkanCore::StagingUploadRegion> RunUploads;
+		RunUploads.reserve(ChangedRuns.size());
+		for(const VulkanCore::BufferRange& Run : ChangedRuns)
+		{
+			RunUploads.push_back({&Draws[Run.Offset], Run.Size * sizeof(EngineCore::IndirectDrawData), Run.Offset * sizeof(EngineCore::IndirectDrawData)});
+		}
+
+		// Either every run is uploaded or the old commands stay untouched
+		if(!DrawUploads.Upload(RunUploads, *IndirectBuffer))
+		{
+			// Keeps drawing the old commands and tries again next frame
+			return;
+		}
+
+		// Frames still in flight read the draw buffer we are about to overwrite
+		Barriers.BufferBarrier(IndirectBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE,
+							   VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+							   VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	}
+
+	DrawCount = (uint32_t)Draws.size();
+	UploadedDraws = std::move(Draws);
+	bDrawsDirty = false;
+}
+
+void GeometryPool::OnUploadComplete(uint32_t MeshID, VulkanCore::UploadID ID)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	// The mesh could have been removed and its ID reused since the upload was scheduled
+	if(MeshID >= Meshes.size() || !Meshes[MeshID].Mesh)
+	{
+		return;
+	}
+
+	ResidentMesh& Resident = Meshes[MeshID];
+	auto Itr = std::find(Resident.PendingUploads.begin(), Resident.PendingUploads.end(), ID);
+	if(Itr == Resident.PendingUploads.end())
+	{
+		return;
+	}
+
+	Resident.PendingUploads.erase(Itr);
+	if(!Resident.PendingUploads.empty())
+	{
+		return;
+	}
+
+	Resident.bUploaded = true;
+	bDrawsDirty = true;
+
+	// Everything was copied into the staging ring, the pool only needs the draws from here on. Registrations sharing the mesh never
+	// schedule uploads of their own, so nothing else in the pool still reads its vertices and indices.
+	EngineCore::StaticMesh& Mesh = *Resident.Mesh;
+	if(Mesh.CPUResidency == EngineCore::MeshCPUResidency::ReleaseAfterUpload && Mesh.CanReloadCPUData())
+	{
+		Mesh.ReleaseCPUData();
+	}
+}
+
+void GeometryPool::BindBuffers(VulkanCore::Pipeline& TargetPipeline, uint32_t Set, uint32_t Binding, uint32_t SetIndex)
+{
+	// Order has to match VERTEX_INDEX, INDICES_INDEX, INDIRECT_DRAW_INDEX and MATERIAL_INDEX in CommonStructs.glsl
+	const std::array<std::shared_ptr<VulkanCore::Buffer>, 4> Buffers = {VertexBuffer, IndexBuffer, IndirectBuffer, MaterialBuffer};
+	TargetPipeline.BindResource(Set, Binding, SetIndex, Buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+void GeometryPool::RegisterForDefragmentation(VulkanCore::Defragmenter& MemoryDefragmenter) const
+{
+	// The pools are the largest allocations in the scene, moving them is what lets whole memory blocks be freed
+	MemoryDefragmenter.Register(VertexBuffer);
+	MemoryDefragmenter.Register(IndexBuffer);
+	MemoryDefragmenter.Register(IndirectBuffer);
+	MemoryDefragmenter.Register(MaterialBuffer);
+}
+
+bool GeometryPool::OwnsBuffer(const VulkanCore::Buffer* InBuffer) const
+{
+	return InBuffer == VertexBuffer.get() || InBuffer == IndexBuffer.get() || InBuffer == IndirectBuffer.get() || InBuffer == MaterialBuffer.get();
+}
+
+void GeometryPool::Draw(VkCommandBuffer CmdBuffer) const
+{
+	if(DrawCount == 0)
+	{
+		return;
+	}
+
+	vkCmdBindIndexBuffer(CmdBuffer, IndexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	vkCmdDrawIndexedIndirect(CmdBuffer, IndirectBuffer->GetVkBuffer(), 0, DrawCount, sizeof(EngineCore::IndirectDrawData));
+}
\ No newline at end of file
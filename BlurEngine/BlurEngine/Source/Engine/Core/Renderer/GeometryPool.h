@@ -0,0 +1,162 @@
+#pragma once
+
+#include "../VulkanCore/Utility.h"
+#include "../VulkanCore/VulkanCommon.h"
+
+#include "../VulkanCore/UploadScheduler.h"
+
+#include "../Runtime/Model.h"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace VulkanCore
+{
+	class Context;
+	class Buffer;
+	class Pipeline;
+	class StagingRing;
+	class BarrierBuilder;
+	class Defragmenter;
+}
+
+// Packs the vertices, indices and materials of every loaded StaticMesh into device local pools, so the whole
+// scene is drawn with a single set of bindings and one multi-draw-indirect. Pools are allocated once, meshes are placed with a
+// free list and loading or unloading meshes never reallocates them.
+class GeometryPool
+{
+public:
+	MOVABLE_ONLY(GeometryPool);
+
+	explicit GeometryPool(const VulkanCore::Context& DeviceContext, VulkanCore::UploadScheduler& InUploads, uint32_t InMaxVertices, uint32_t InMaxIndices,
+						  uint32_t InMaxMaterials, uint32_t InMaxDraws, uint32_t InFramesInFlight, const std::string& Name = "");
+
+	// Places the mesh into the pools. Returns the mesh ID or INVALID_MESH if the pools are full.
+	// Geometry is streamed by the upload scheduler over the next frames and the mesh is drawn once all of it is on the GPU.
+	// Released CPU data is loaded back first, and dropped again after the upload if the mesh's CPU residency asks for it.
+	// Adding a mesh that is already in the pool returns its ID and shares its ranges, every AddMesh needs its own RemoveMesh.
+	uint32_t AddMesh(std::shared_ptr<EngineCore::StaticMesh> Mesh, VulkanCore::UploadPriority Priority = VulkanCore::UploadPriority::Visible);
+
+	// Once the last registration of the mesh is removed it stops being drawn right away, its pool ranges are reused once the GPU
+	// can't be reading them anymore
+	void RemoveMesh(uint32_t MeshID);
+
+	// Needs to be called once per frame after waiting on the frame's fence
+	void BeginFrame();
+
+	// Re-uploads the draw commands if meshes were added or removed or finished streaming. Barriers gets the barrier the copy has to wait on,
+	// it needs to be flushed before the staging ring records its copies.
+	void UpdateDrawCommands(VulkanCore::StagingRing& DrawUploads, VulkanCore::BarrierBuilder& Barriers);
+
+	// Writes the vertex, index, draw command and material buffers into the aliased storage buffer array used by CommonStructs.glsl
+	void BindBuffers(VulkanCore::Pipeline& TargetPipeline, uint32_t Set, uint32_t Binding, uint32_t SetIndex = 0);
+
+	// Lets the defragmenter move the pools, descriptors written by BindBuffers have to be written again once one of them moved
+	void RegisterForDefragmentation(VulkanCore::Defragmenter& MemoryDefragmenter) const;
+	bool OwnsBuffer(const VulkanCore::Buffer* InBuffer) const;
+
+	void Draw(VkCommandBuffer CmdBuffer) const;
+
+	uint32_t GetDrawCount() const { return DrawCount; }
+	uint32_t GetNumFreeVertices() const { return VertexRanges.GetFreeCount(); }
+	uint32_t GetNumFreeIndices() const { return IndexRanges.GetFreeCount(); }
+	uint32_t GetNumFreeMaterials() const { return MaterialRanges.GetFreeCount(); }
+	uint32_t GetVertexCapacity() const { return VertexRanges.GetCapacity(); }
+	uint32_t GetIndexCapacity() const { return IndexRanges.GetCapacity(); }
+
+public:
+	static constexpr uint32_t INVALID_MESH = UINT32_MAX;
+
+private:
+	// First fit allocator over element ranges, neighbouring free ranges are merged on free
+	class FreeList
+	{
+	public:
+		explicit FreeList(uint32_t InCapacity);
+
+		// Returns INVALID_OFFSET if there is no free range large enough
+		uint32_t Allocate(uint32_t Count);
+		void Free(uint32_t Offset, uint32_t Count);
+
+		uint32_t GetFreeCount() const { return FreeCount; }
+		uint32_t GetCapacity() const { return Capacity; }
+
+	public:
+		static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+	private:
+		// Offset -> count
+		std::map<uint32_t, uint32_t> FreeRanges;
+		uint32_t FreeCount = 0;
+		uint32_t Capacity = 0;
+	};
+
+	struct PoolRange
+	{
+		uint32_t FirstVertex = 0;
+		uint32_t VertexCount = 0;
+		uint32_t FirstIndex = 0;
+		uint32_t IndexCount = 0;
+	};
+
+	struct ResidentMesh
+	{
+		std::shared_ptr<EngineCore::StaticMesh> Mesh;
+
+		// One per model
+		std::vector<PoolRange> Ranges;
+		std::vector<EngineCore::IndirectDrawData> Draws;
+		// The mesh's materials, draws index them with FirstMaterial added to the model's material index
+		uint32_t FirstMaterial = 0;
+		uint32_t MaterialCount = 0;
+		// AddMesh calls sharing this entry
+		uint32_t RefCount = 0;
+		// Scheduled uploads that haven't completed yet, the mesh is drawn once this is empty
+		std::vector<VulkanCore::UploadID> PendingUploads;
+		bool bUploaded = false;
+	};
+
+	struct RetiredMesh
+	{
+		uint32_t MeshID;
+		uint64_t RetiredFrame;
+	};
+
+	// Changed draws at most this far apart are uploaded with a single copy
+	static constexpr uint32_t DRAW_RUN_MERGE_GAP = 4;
+
+	void OnUploadComplete(uint32_t MeshID, VulkanCore::UploadID ID);
+
+private:
+	VulkanCore::UploadScheduler& Uploads;
+
+	std::shared_ptr<VulkanCore::Buffer> VertexBuffer;
+	std::shared_ptr<VulkanCore::Buffer> IndexBuffer;
+	std::shared_ptr<VulkanCore::Buffer> IndirectBuffer;
+	std::shared_ptr<VulkanCore::Buffer> MaterialBuffer;
+
+	FreeList VertexRanges;
+	FreeList IndexRanges;
+	FreeList MaterialRanges;
+
+	uint32_t MaxDraws = 0;
+	uint32_t DrawCount = 0;
+	bool bDrawsDirty = false;
+	// What the draw buffer currently holds, new commands are diffed against it so unchanged draws aren't uploaded again
+	std::vector<EngineCore::IndirectDrawData> UploadedDraws;
+
+	uint32_t FramesInFlight = 0;
+	uint64_t CurrentFrame = 0;
+
+	std::vector<ResidentMesh> Meshes;
+	// Meshes that are in the pool by their asset, the asset registry hands the same StaticMesh to everyone loading it
+	std::unordered_map<const EngineCore::StaticMesh*, uint32_t> MeshIDs;
+	std::vector<uint32_t> FreeMeshIDs;
+	std::deque<RetiredMesh> RetiredMeshes;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
\ No newline at end of file
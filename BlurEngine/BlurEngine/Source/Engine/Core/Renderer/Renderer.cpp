@@ -4,10 +4,13 @@
 
 #include "../VulkanCore/ShaderModule.h" // Temporary
 
-#include "../AssetManagement/ObjLoader.h"
+#include "../AssetManagement/AssetRegistry.h"
 
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <array>
+
 std::filesystem::path Renderer::sShaderDirectory;
 std::filesystem::path Renderer::sModelDirectory;
 
@@ -29,6 +32,9 @@ void Renderer::Init(std::shared_ptr<Window> AppWindow)
 	VulkanCore::Context::EnableBufferDeviceAddressFeature();
 	VulkanCore::Context::EnableDynamicRenderingFeature();
 	VulkanCore::Context::EnableDynamicStateFeature();
+	VulkanCore::Context::EnableDescriptorBufferFeature();
+
+	VulkanCore::Context::SetPipelineCachePath(std::filesystem::current_path() / "Saved" / "PipelineCache.bin");
 
 	ActiveWindow = AppWindow;
 
@@ -49,16 +55,11 @@ void Renderer::Init(std::shared_ptr<Window> AppWindow)
 	
 	FramesInFlight = RenderingContext->GetSwapchain()->GetImageCount();
 
-	EngineCore::RingBuffer CameraBuffer(*RenderingContext.get(), RenderingContext->GetSwapchain()->GetImageCount(), sizeof(CameraUniforms));
-	MainCamera.Init(CameraBuffer);
+	FrameConstants = std::make_unique<VulkanCore::LinearUniformAllocator>(*RenderingContext.get(), FramesInFlight, FRAME_CONSTANTS_SIZE, sizeof(CameraUniforms), "Frame Constants");
 
 	Renderer::sModelDirectory = std::filesystem::current_path() / "Source/Resources/Models";
 	Renderer::sModelDirectory.make_preferred();
 
-	EngineCore::OBJLoader ObjLoader;
-	auto Teapot = ObjLoader.Load(Renderer::sModelDirectory.string() + "/teapot.obj");
-	SceneMeshes.push_back(Teapot);
-
 	Renderer::sShaderDirectory = std::filesystem::current_path() / "Source/Resources/Shaders";
 	Renderer::sShaderDirectory.make_preferred();
 
@@ -71,36 +72,29 @@ void Renderer::Init(std::shared_ptr<Window> AppWindow)
 	std::vector<VulkanCore::SetDescriptor> Sets;
 	VulkanCore::SetDescriptor Desc;
 
+	CameraDescriptorType = RenderingContext->IsDescriptorBufferEnabled() ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	const bool bDynamicCamera = CameraDescriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
 	Desc.SetIndex = CAMERA_SET;
-	Desc.Bindings = {VkDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)};
+	Desc.Bindings = {VkDescriptorSetLayoutBinding(0, CameraDescriptorType, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)};
 	Sets.push_back(Desc);
 
 	Desc.SetIndex = TEXTURES_SET;
-	Desc.Bindings = { VkDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) };
+	Desc.Bindings = { VkDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_BINDLESS_TEXTURES, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) };
 	Sets.push_back(Desc);
 
 	Desc.SetIndex = SAMPLER_SET;
-	Desc.Bindings = { VkDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLER, 1000, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) };
+	Desc.Bindings = { VkDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_SAMPLER, VulkanCore::Context::sSamplerTableSize, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) };
 	Sets.push_back(Desc);
 
 	Desc.SetIndex = STORAGE_BUFFER_SET;
 	Desc.Bindings = { VkDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT) };
 	Sets.push_back(Desc);
 
-	VulkanCore::TextureCreateInfo DepthTextureInfo;
-	DepthTextureInfo.Type = VK_IMAGE_TYPE_2D;
-	DepthTextureInfo.Format = VK_FORMAT_D24_UNORM_S8_UINT;
-	DepthTextureInfo.Flags = 0;
-	DepthTextureInfo.UsageFlags = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-	DepthTextureInfo.Extents = VkExtent3D{ RenderingContext->GetSwapchain()->GetExtent().width, RenderingContext->GetSwapchain()->GetExtent().height, 1 };
-	DepthTextureInfo.NumMipLevels = 1;
-	DepthTextureInfo.LayerCount = 1;
-	DepthTextureInfo.MemoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	DepthTextureInfo.bGenerateMips = false;
-	DepthTextureInfo.MsaaSamples = VK_SAMPLE_COUNT_1_BIT;
-	DepthTextureInfo.Name = "Depth Buffer";
-
-	std::shared_ptr<VulkanCore::Texture> DepthTexture = RenderingContext->CreateTexture(DepthTextureInfo);
+	RenderTargets = std::make_unique<VulkanCore::RenderTargetPool>(*RenderingContext.get(), "Render Targets");
+	CreateRenderTargets();
+
+	const std::shared_ptr<VulkanCore::Texture> DepthTexture = RenderTargets->GetTarget(DepthTargetHandle);
 
 	VulkanCore::RenderPassInitInfo PassInitInfo;
 	PassInitInfo.AttachmentTextures = { RenderingContext->GetSwapchain()->GetTexture(0), DepthTexture };
@@ -111,16 +105,7 @@ void Renderer::Init(std::shared_ptr<Window> AppWindow)
 
 	IndirectDrawPass = RenderingContext->CreateRenderPass({PassInitInfo}, VK_PIPELINE_BIND_POINT_GRAPHICS, {}, "Indirect Draw");
 
-	for(uint32_t i = 0; i < RenderingContext->GetSwapchain()->GetImageCount(); i++)
-	{
-		VulkanCore::FramebufferCreateInfo FramebufferInfo;
-		FramebufferInfo.Attachments = { RenderingContext->GetSwapchain()->GetTexture(i), DepthTexture };
-		FramebufferInfo.DepthAttachment = nullptr;
-		FramebufferInfo.StencilAttachment = nullptr;
-		FramebufferInfo.Name = "Swapchain Framebuffer " + std::to_string(i);
-
-		RenderingContext->GetSwapchain()->SetFramebuffer(RenderingContext->CreateFramebuffer(IndirectDrawPass->GetVkRenderPass(), FramebufferInfo), i);
-	}
+	CreateFramebuffers();
 
 	VulkanCore::GraphicsPipelineDescriptor GraphicsPipelineDesc{};
 	GraphicsPipelineDesc.SetDescriptors = Sets;
@@ -135,14 +120,133 @@ void Renderer::Init(std::shared_ptr<Window> AppWindow)
 	GraphicsPipelineDesc.DepthCompareOperation = VK_COMPARE_OP_LESS;
 
 	GraphicsPipeline = RenderingContext->CreateGraphicsPipeline(GraphicsPipelineDesc, IndirectDrawPass->GetVkRenderPass(), "Indirect Draw");
-	GraphicsPipeline->AllocateDescriptors({ {CAMERA_SET, 3}, {TEXTURES_SET, 1}, {SAMPLER_SET, 1}, {STORAGE_BUFFER_SET, 1} });
-	for(uint32_t i = 0; i < MainCamera.GetCameraBuffer()->GetRingSize(); i++)
+	GraphicsPipeline->AllocateDescriptors({ {CAMERA_SET, bDynamicCamera ? 1 : FramesInFlight}, {TEXTURES_SET, FramesInFlight}, {SAMPLER_SET, 1}, {STORAGE_BUFFER_SET, FramesInFlight} });
+
+	if(bDynamicCamera)
 	{
-		GraphicsPipeline->BindResource(CAMERA_SET, BINDING_0, i, MainCamera.GetCameraBuffer()->GetBuffer(i), 0, sizeof(CameraUniforms), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+		// Bound once, every frame only changes the dynamic offset
+		GraphicsPipeline->BindResource(CAMERA_SET, BINDING_0, 0, FrameConstants->GetBuffer(), 0, sizeof(CameraUniforms), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 	}
 
+	TextureHeap = std::make_unique<VulkanCore::BindlessTextureHeap>(GraphicsPipeline, TEXTURES_SET, BINDING_0, MAX_BINDLESS_TEXTURES, FramesInFlight, "Scene Textures");
+
+	VulkanCore::SamplerCreateInfo DefaultSamplerInfo;
+	DefaultSamplerInfo.MinFilter = VK_FILTER_LINEAR;
+	DefaultSamplerInfo.MagFilter = VK_FILTER_LINEAR;
+	DefaultSamplerInfo.AddressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	DefaultSamplerInfo.AddressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	DefaultSamplerInfo.AddressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	DefaultSamplerInfo.MaxLod = VK_LOD_CLAMP_NONE;
+	DefaultSamplerInfo.Name = "Default Linear Sampler";
+
+	// First sampler requested, so it always sits in slot 0 of the sampler table
+	RenderingContext->GetSamplerCache()->RequestSampler(DefaultSamplerInfo);
+
 	const uint32_t ImageCount = RenderingContext->GetSwapchain()->GetImageCount();
-	GraphicsCommandManager = RenderingContext->CreateGraphicsCommandQueue(ImageCount, ImageCount, -1, "Graphics Command Manager");
+	GraphicsCommandManager = RenderingContext->CreateGraphicsCommandQueue(1, ImageCount, -1, "Graphics Command Manager");
+
+#ifdef BE_MEMORY_PLACEMENT_BENCHMARK
+	// Define in the project's preprocessor definitions to log how fast each kind of host visible memory is on this device
+	VulkanCore::MemoryPlacement::RunBenchmark(*RenderingContext.get(), *GraphicsCommandManager);
+#endif
+
+	RenderingContext->GetMemoryTracker()->SetPressureThreshold(MEMORY_PRESSURE_THRESHOLD);
+	MemoryDefragmenter = std::make_unique<VulkanCore::Defragmenter>(*RenderingContext.get(), FramesInFlight, VulkanCore::DefragmentationBudget{}, "Scene");
+	MemoryDefragmenter->AddRelocationCallback([this](const VulkanCore::RelocationEvent& Event)
+	{
+		// Moved textures have a new image view that the bindless slots need to point at, each frame's set is written once its frame comes around
+		if(Event.MovedTexture)
+		{
+			TextureHeap->RewriteTexture(Event.MovedTexture.get());
+		}
+
+		// Frames still in flight read the old pools through their own set, so each set is rewritten once its frame comes around.
+		// Device addresses of moved buffers are queried again the next time they're asked for.
+		if(Event.MovedBuffer && SceneGeometry->OwnsBuffer(Event.MovedBuffer.get()))
+		{
+			std::fill(StaleGeometrySets.begin(), StaleGeometrySets.end(), true);
+		}
+	});
+	TextureHeap->SetDefragmenter(MemoryDefragmenter.get());
+
+	RenderingContext->GetMemoryTracker()->SetPressureCallback([this](const VulkanCore::MemoryPressureEvent& Event)
+	{
+		if(!(Event.Heap.Flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+		{
+			return;
+		}
+
+		if(Event.bUnderPressure)
+		{
+			RenderingContext->GetMemoryTracker()->LogUsage();
+			RenderingContext->GetDescriptorAllocator()->LogStats();
+			Assets->LogStats();
+			MemoryDefragmenter->Start();
+
+			// Shrinks the resident textures by however much the heap is over the threshold, least recently used ones go first.
+			// Evicting meshes would only free ranges in the geometry pool, the pool's memory stays allocated.
+			const VkDeviceSize PressureLimit = (VkDeviceSize)((double)Event.Heap.Budget * MEMORY_PRESSURE_THRESHOLD);
+			const VkDeviceSize Overshoot = Event.Heap.Usage > PressureLimit ? Event.Heap.Usage - PressureLimit : 0;
+			const VkDeviceSize ResidentBytes = SceneResidency->GetResidentTextureBytes();
+			SceneResidency->SetTextureBudget(std::min(SceneResidency->GetTextureBudget(), ResidentBytes > Overshoot ? ResidentBytes - Overshoot : 0));
+		}
+		else
+		{
+			SceneResidency->SetTextureBudget(TEXTURE_RESIDENCY_BUDGET);
+		}
+	});
+
+	StagingUploads = std::make_unique<VulkanCore::StagingRing>(*RenderingContext.get(), *GraphicsCommandManager, STAGING_RING_SIZE, "Uploads");
+	GPUReadbacks = std::make_unique<VulkanCore::ReadbackRing>(*RenderingContext.get(), *GraphicsCommandManager, READBACK_RING_SIZE, "Readbacks");
+
+	Streaming = std::make_unique<VulkanCore::UploadScheduler>(VulkanCore::UploadBudgetSettings{}, "Streaming");
+
+	SceneGeometry = std::make_unique<GeometryPool>(*RenderingContext.get(), *Streaming, MAX_SCENE_VERTICES, MAX_SCENE_INDICES, MAX_SCENE_MATERIALS, MAX_SCENE_DRAWS, FramesInFlight, "Scene");
+
+	// The pools were clamped to what the device can bind and allocate, a chunk can take up at most a quarter of them so one mesh can't fill a pool
+	Assets = std::make_unique<EngineCore::AssetRegistry>("Scene");
+	Assets->SetMeshChunkLimits(std::min(EngineCore::OBJLoader::DEFAULT_MAX_CHUNK_VERTICES, SceneGeometry->GetVertexCapacity() / 4),
+							   std::min(EngineCore::OBJLoader::DEFAULT_MAX_CHUNK_INDICES, SceneGeometry->GetIndexCapacity() / 4));
+
+	auto Teapot = Assets->AcquireMesh(Renderer::sModelDirectory.string() + "/teapot.obj");
+	if(Teapot)
+	{
+		Teapot->CPUResidency = EngineCore::MeshCPUResidency::ReleaseAfterUpload;
+		SceneMeshes.push_back(Teapot);
+	}
+
+	SceneResidency = std::make_unique<ResidencyManager>(*SceneGeometry, *TextureHeap, TEXTURE_RESIDENCY_BUDGET, "Scene");
+
+	// Evicted textures are swapped for this until they are loaded back in
+	VulkanCore::TextureCreateInfo FallbackInfo;
+	FallbackInfo.Type = VK_IMAGE_TYPE_2D;
+	FallbackInfo.Format = VK_FORMAT_R8G8B8A8_UNORM;
+	FallbackInfo.UsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	FallbackInfo.Extents = VkExtent3D{1, 1, 1};
+	FallbackInfo.NumMipLevels = 1;
+	FallbackInfo.LayerCount = 1;
+	FallbackInfo.MemoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	FallbackInfo.bDedicatedMemory = false;
+	FallbackInfo.Name = "Fallback Texture";
+
+	const std::array<uint8_t, 4> FallbackTexel = {128, 128, 128, 255};
+	SceneResidency->SetFallbackTexture(LoadTexture(FallbackInfo, FallbackTexel.data(), FallbackTexel.size()));
+	for(const std::shared_ptr<EngineCore::StaticMesh>& Mesh : SceneMeshes)
+	{
+		const uint32_t Handle = SceneResidency->RegisterMesh(Mesh);
+		if(Handle != ResidencyManager::INVALID_HANDLE)
+		{
+			SceneMeshHandles.push_back(Handle);
+		}
+	}
+
+	SceneGeometry->RegisterForDefragmentation(*MemoryDefragmenter);
+
+	for(uint32_t SetIndex = 0; SetIndex < FramesInFlight; SetIndex++)
+	{
+		SceneGeometry->BindBuffers(*GraphicsPipeline, STORAGE_BUFFER_SET, BINDING_0, SetIndex);
+	}
+	StaleGeometrySets.assign(FramesInFlight, false);
 }
 
 void Renderer::Draw(float DeltaTime)
@@ -168,36 +272,140 @@ void Renderer::Draw(float DeltaTime)
 
 	VkCommandBuffer CmdBuffer = GraphicsCommandManager->BeginCmdBuffer();
 
-	constexpr VkClearValue ClearColor{ 0.0f, 0.0f, 0.0f, 0.0f };
+	RenderingContext->GetMemoryTracker()->Update();
+
+	TextureHeap->BeginFrame();
+	FrameConstants->BeginFrame(FrameIndex);
+	RenderingContext->GetDescriptorAllocator()->BeginFrame(FrameIndex);
+	GraphicsPipeline->ReleaseRetiredDescriptors(*GraphicsCommandManager);
+	RenderingContext->GetPipelineCache()->Update();
+	SceneGeometry->BeginFrame();
+	StagingUploads->Reclaim();
+	GPUReadbacks->Update();
+
+	// A bounded amount of defragmentation moves per frame. Runs before anything is queued on the staging ring, so this frame's
+	// uploads already target the moved buffers and are ordered after the copies by the flushed barriers.
+	MemoryDefragmenter->Update(CmdBuffer, FrameBarriers);
+	FrameBarriers.Flush(CmdBuffer);
+
+	if(StaleGeometrySets[FrameIndex])
+	{
+		SceneGeometry->BindBuffers(*GraphicsPipeline, STORAGE_BUFFER_SET, BINDING_0, FrameIndex);
+		StaleGeometrySets[FrameIndex] = false;
+	}
+
+	// There's no culling yet, so every mesh in the scene is used every frame
+	for(uint32_t Handle : SceneMeshHandles)
+	{
+		SceneResidency->MarkUsed(Handle);
+	}
+
+	SceneResidency->Update();
+
+	// Streams this frame's share of pending geometry, meshes that finish are picked up by the draw command update below
+	Streaming->BeginFrame(DeltaTime);
+	Streaming->Update(*StagingUploads);
+
+	// Draw commands are rewritten in place, so the copy has to wait for earlier frames to stop reading them
+	SceneGeometry->UpdateDrawCommands(*StagingUploads, FrameBarriers);
+	FrameBarriers.Flush(CmdBuffer);
+
+	// Uploads queued since last frame have to land before anything reads them
+	StagingUploads->RecordCopies(CmdBuffer, FrameBarriers,
+								 VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+								 VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_UNIFORM_READ_BIT);
+	FrameBarriers.Flush(CmdBuffer);
+
+	std::array<VkClearValue, 2> ClearValues{};
+	ClearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+	ClearValues[1].depthStencil = { 1.0f, 0 };
+
 	VkRenderPassBeginInfo RenderPassInfo{};
 	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	RenderPassInfo.renderPass = IndirectDrawPass->GetVkRenderPass();
 	RenderPassInfo.framebuffer = RenderingContext->GetSwapchain()->GetFramebuffer(SwapchainImageIndex)->GetVkFramebuffer();
 	RenderPassInfo.renderArea = RenderArea;
-	RenderPassInfo.clearValueCount = 1;
-	RenderPassInfo.pClearValues = &ClearColor;
+	RenderPassInfo.clearValueCount = (uint32_t)ClearValues.size();
+	RenderPassInfo.pClearValues = ClearValues.data();
 	RenderPassInfo.pNext = VK_NULL_HANDLE;
 
 	vkCmdBeginRenderPass(CmdBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+	// Samplers and textures added since last frame are written before the pending descriptor writes are flushed in Bind
+	RenderingContext->GetSamplerCache()->WriteSamplerTable(*GraphicsPipeline, SAMPLER_SET, BINDING_0);
+	TextureHeap->FlushWrites(FrameIndex);
+
+	const VulkanCore::LinearAllocation CameraConstants = FrameConstants->Write(MainCamera.GetUniforms());
+
+	const bool bDynamicCamera = CameraDescriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	if(!bDynamicCamera)
+	{
+		// The GPU is done with this frame's set, so it can point at the offset written this frame
+		GraphicsPipeline->BindResource(CAMERA_SET, BINDING_0, FrameIndex, FrameConstants->GetBuffer(), CameraConstants.Offset, sizeof(CameraUniforms),
+									   VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	}
+
 	GraphicsPipeline->Bind(CmdBuffer);
+	if(bDynamicCamera)
+	{
+		GraphicsPipeline->BindDescriptorSet(CmdBuffer, CAMERA_SET, 0, {&CameraConstants.Offset, 1});
+	}
+	else
+	{
+		GraphicsPipeline->BindDescriptorSet(CmdBuffer, CAMERA_SET, FrameIndex);
+	}
+	GraphicsPipeline->BindDescriptorSet(CmdBuffer, TEXTURES_SET, FrameIndex);
+	GraphicsPipeline->BindDescriptorSet(CmdBuffer, SAMPLER_SET, 0);
+	GraphicsPipeline->BindDescriptorSet(CmdBuffer, STORAGE_BUFFER_SET, FrameIndex);
+
+	VkViewport Viewport{};
+	Viewport.x = 0.0f;
+	Viewport.y = 0.0f;
+	Viewport.width = (float)RenderArea.extent.width;
+	Viewport.height = (float)RenderArea.extent.height;
+	Viewport.minDepth = 0.0f;
+	Viewport.maxDepth = 1.0f;
+
+	vkCmdSetViewport(CmdBuffer, 0, 1, &Viewport);
+	vkCmdSetScissor(CmdBuffer, 0, 1, &RenderArea);
+	vkCmdSetDepthTestEnable(CmdBuffer, VK_TRUE);
 
-	vkCmdDraw(CmdBuffer, 3, 1, 0, 0);
+	// Every mesh in the scene in a single multi-draw
+	SceneGeometry->Draw(CmdBuffer);
 
 	vkCmdEndRenderPass(CmdBuffer);
 
 	GraphicsCommandManager->EndCmdBuffer(CmdBuffer);
 
+	FrameConstants->FlushFrame();
+
 	constexpr VkPipelineStageFlags Flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	const VkSubmitInfo SubmitInfo = RenderingContext->GetSwapchain()->CreateSubmitInfo(&CmdBuffer, &Flags);
 	GraphicsCommandManager->Submit(&SubmitInfo);
 	GraphicsCommandManager->ToNextCmdBuffer();
+	FrameIndex = (FrameIndex + 1) % FramesInFlight;
 
 	RenderingContext->GetSwapchain()->Present();
 
 	ActiveWindow->SetFrameBufferResized(false);
 }
 
+std::shared_ptr<VulkanCore::Texture> Renderer::LoadTexture(const VulkanCore::TextureCreateInfo& CreateInfo, const void* Payload, size_t PayloadSize)
+{
+	// A texture with the same texels and create info that is still alive is handed out again instead of being created and uploaded twice
+	return Assets->AcquireTexture(CreateInfo, Payload, PayloadSize, [&]() -> std::shared_ptr<VulkanCore::Texture>
+	{
+		std::shared_ptr<VulkanCore::Texture> CreatedTexture = RenderingContext->CreateTexture(CreateInfo);
+		if(!StagingUploads->UploadTexture(Payload, PayloadSize, CreatedTexture))
+		{
+			BE_ERROR("No room in the staging ring to upload texture {0}", CreateInfo.Name);
+			return nullptr;
+		}
+
+		return CreatedTexture;
+	});
+}
+
 void Renderer::DeviceWaitIdle()
 {
 	vkDeviceWaitIdle(RenderingContext->GetDevice());
@@ -226,7 +434,43 @@ void Renderer::HandleWindowResized()
 	RenderArea.offset = { 0, 0 };
 	RenderArea.extent = RenderingContext->GetSwapchain()->GetExtent();
 
+	// The new swapchain images always need new framebuffers, the depth target keeps its memory if it still fits
+	CreateRenderTargets();
+	CreateFramebuffers();
+
 #if _DEBUG
 	BE_INFO("Window resized to: {0} x {1}", NewExtent.width, NewExtent.height);
 #endif
 }
+
+
+void Renderer::CreateRenderTargets()
+{
+	const VkExtent2D SwapchainExtent = RenderingContext->GetSwapchain()->GetExtent();
+
+	VulkanCore::RenderTargetDesc DepthDesc;
+	DepthDesc.Format = VK_FORMAT_D24_UNORM_S8_UINT;
+	DepthDesc.Extents = SwapchainExtent;
+	DepthDesc.UsageFlags = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	DepthDesc.MsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	DepthDesc.bTransient = true; // Cleared on load and never stored
+	DepthDesc.Name = "Depth Buffer";
+
+	RenderTargets->Reset();
+	DepthTargetHandle = RenderTargets->DeclareTarget(DepthDesc, INDIRECT_DRAW_PASS, INDIRECT_DRAW_PASS);
+	RenderTargets->Compile();
+}
+
+void Renderer::CreateFramebuffers()
+{
+	for(uint32_t i = 0; i < RenderingContext->GetSwapchain()->GetImageCount(); i++)
+	{
+		VulkanCore::FramebufferCreateInfo FramebufferInfo;
+		FramebufferInfo.Attachments = { RenderingContext->GetSwapchain()->GetTexture(i), RenderTargets->GetTarget(DepthTargetHandle) };
+		FramebufferInfo.DepthAttachment = nullptr;
+		FramebufferInfo.StencilAttachment = nullptr;
+		FramebufferInfo.Name = "Swapchain Framebuffer " + std::to_string(i);
+
+		RenderingContext->GetSwapchain()->SetFramebuffer(RenderingContext->CreateFramebuffer(IndirectDrawPass->GetVkRenderPass(), FramebufferInfo), i);
+	}
+}
\ No newline at end of file
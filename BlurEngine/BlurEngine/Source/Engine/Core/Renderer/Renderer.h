@@ -4,8 +4,20 @@
 #include "../VulkanCore/Context.h"
 #include "../VulkanCore/Pipeline.h"
 #include "../VulkanCore/CommandQueueManager.h"
+#include "../VulkanCore/BindlessTextureHeap.h"
+#include "../VulkanCore/RenderTargetPool.h"
+#include "../VulkanCore/StagingRing.h"
+#include "../VulkanCore/UploadScheduler.h"
+#include "../VulkanCore/ReadbackRing.h"
+#include "../VulkanCore/BarrierBuilder.h"
+#include "../VulkanCore/LinearUniformAllocator.h"
+#include "../VulkanCore/Defragmenter.h"
+
+#include "GeometryPool.h"
+#include "ResidencyManager.h"
 
 #include "../Runtime/Model.h"
+#include "../AssetManagement/AssetRegistry.h"
 #include "../Runtime/Camera.h"
 
 #include "Window.h"
@@ -29,12 +41,20 @@ public:
 
 	void HandleWindowResized();
 
+private:
+	void CreateRenderTargets();
+	void CreateFramebuffers();
+
+	// Payload is the mip 0 texels, textures are only created and uploaded once per unique payload and create info
+	std::shared_ptr<VulkanCore::Texture> LoadTexture(const VulkanCore::TextureCreateInfo& CreateInfo, const void* Payload, size_t PayloadSize);
+
 public:
 	static std::filesystem::path sShaderDirectory;
 	static std::filesystem::path sModelDirectory; // TODO: Should probably move these to some sort of asset manager
 
 private:
 	uint32_t FramesInFlight;
+	uint32_t FrameIndex = 0;
 
 	std::unique_ptr<VulkanCore::Context> RenderingContext;
 	std::shared_ptr<class Window> ActiveWindow;
@@ -43,10 +63,37 @@ private:
 
 	std::unique_ptr<VulkanCore::CommandQueueManager> GraphicsCommandManager;
 
+	std::unique_ptr<VulkanCore::StagingRing> StagingUploads;
+	// Geometry and other bulk data is streamed through here a budgeted amount per frame, so loading doesn't cause frame spikes
+	std::unique_ptr<VulkanCore::UploadScheduler> Streaming;
+	// Picking, GPU statistics and screenshots are read back through here without waiting on the GPU
+	std::unique_ptr<VulkanCore::ReadbackRing> GPUReadbacks;
+	VulkanCore::BarrierBuilder FrameBarriers;
+
+	// Per-view and per-object constants, bound with dynamic offsets
+	std::unique_ptr<VulkanCore::LinearUniformAllocator> FrameConstants;
+	// Descriptor buffers can't hold dynamic buffers, with them each frame's camera set is written with that frame's offset instead
+	VkDescriptorType CameraDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
+	std::unique_ptr<VulkanCore::BindlessTextureHeap> TextureHeap;
+
+	std::unique_ptr<VulkanCore::Defragmenter> MemoryDefragmenter;
+
+	std::unique_ptr<VulkanCore::RenderTargetPool> RenderTargets;
+	VulkanCore::RenderTargetHandle DepthTargetHandle;
+
 	std::shared_ptr<VulkanCore::RenderPass> IndirectDrawPass;
 	VkRect2D RenderArea;
 
+	// Meshes and textures are loaded through here so identical content is only loaded and uploaded once
+	std::unique_ptr<EngineCore::AssetRegistry> Assets;
+
 	std::vector<std::shared_ptr<EngineCore::StaticMesh>> SceneMeshes; // TODO: Temporary for now until we have some concept of a scene/level
+	std::unique_ptr<GeometryPool> SceneGeometry;
+	// One storage buffer set per frame in flight, a set is written again on its frame once the defragmenter moved one of the pools
+	std::vector<bool> StaleGeometrySets;
+	std::unique_ptr<ResidencyManager> SceneResidency;
+	std::vector<uint32_t> SceneMeshHandles;
 
 	EngineCore::Camera MainCamera;
 
@@ -58,4 +105,19 @@ private:
 	const uint32_t BINDING_1 = 1;
 	const uint32_t BINDING_2 = 2;
 	const uint32_t BINDING_3 = 3;
+
+	const uint32_t MAX_BINDLESS_TEXTURES = 1000;
+	const VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+	const VkDeviceSize READBACK_RING_SIZE = 16 * 1024 * 1024;
+	const VkDeviceSize FRAME_CONSTANTS_SIZE = 4 * 1024 * 1024;
+	// Geometry pools are allocated once at this size and never grow, the residency manager evicts meshes once they are full
+	const uint32_t MAX_SCENE_VERTICES = 1024 * 1024;
+	const uint32_t MAX_SCENE_INDICES = 4 * 1024 * 1024;
+	const uint32_t MAX_SCENE_MATERIALS = 4 * 1024;
+	const uint32_t MAX_SCENE_DRAWS = 16 * 1024;
+	const float MEMORY_PRESSURE_THRESHOLD = 0.9f;
+	const VkDeviceSize TEXTURE_RESIDENCY_BUDGET = 512 * 1024 * 1024;
+
+	// Pass indices used to declare render target lifetimes
+	const uint32_t INDIRECT_DRAW_PASS = 0;
 };
\ No newline at end of file
@@ -0,0 +1,380 @@
+#include "ResidencyManager.h"
+#include "GeometryPool.h"
+#include "../VulkanCore/Texture.h"
+#include "../VulkanCore/BindlessTextureHeap.h"
+
+ResidencyManager::ResidencyManager(GeometryPool& InGeometry, VulkanCore::BindlessTextureHeap& InTextureHeap, VkDeviceSize InTextureBudget, const std::string& Name)
+	: Geometry{InGeometry}, TextureHeap{InTextureHeap}, TextureBudget{InTextureBudget}, DebugName{"Residency Manager: " + Name}
+{
+}
+
+uint32_t ResidencyManager::RegisterMesh(std::shared_ptr<EngineCore::StaticMesh> Mesh, uint32_t Priority)
+{
+	ASSERT(Mesh, "Trying to register a null mesh for residency!");
+
+	const uint32_t MeshID = Geometry.AddMesh(Mesh, VulkanCore::UploadPriority::Visible);
+	if(MeshID == GeometryPool::INVALID_MESH)
+	{
+		return INVALID_HANDLE;
+	}
+
+	Resource NewResource;
+	NewResource.Type = ResourceType::Mesh;
+	NewResource.Size = GetMeshSize(*Mesh);
+	NewResource.Priority = Priority;
+	NewResource.VertexCount = (uint32_t)(Mesh->TotalVertexSize / sizeof(EngineCore::Vertex));
+	NewResource.IndexCount = (uint32_t)(Mesh->TotalIndexSize / sizeof(uint32_t));
+	NewResource.Mesh = std::move(Mesh);
+	NewResource.MeshID = MeshID;
+
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+	return AddResource(std::move(NewResource));
+}
+
+uint32_t ResidencyManager::RegisterTexture(uint32_t Slot, std::shared_ptr<VulkanCore::Texture> InTexture, TextureLoader Loader, uint32_t Priority)
+{
+	ASSERT(InTexture, "Trying to register a null texture for residency!");
+	ASSERT(TextureHeap.GetTexture(Slot) == InTexture, "Texture has to be in its bindless slot before it's registered for residency!");
+
+	if(!Loader)
+	{
+		BE_WARN("{0}: texture in slot {1} has no loader and will never be evicted", DebugName, Slot);
+	}
+
+	Resource NewResource;
+	NewResource.Type = ResourceType::Texture;
+	NewResource.Size = InTexture->GetDeviceSize();
+	NewResource.Priority = Priority;
+	NewResource.Loader = std::move(Loader);
+	NewResource.Slot = Slot;
+
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+	return AddResource(std::move(NewResource));
+}
+
+void ResidencyManager::SetFallbackTexture(std::shared_ptr<VulkanCore::Texture> InTexture)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+	FallbackTexture = std::move(InTexture);
+}
+
+void ResidencyManager::MarkUsed(uint32_t Handle)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	ASSERT(Handle < Resources.size(), "Invalid residency handle!");
+	Resource& Used = Resources[Handle];
+	Used.LastUsedFrame = CurrentFrame;
+
+	if(Used.bResident)
+	{
+		LRUOrder.splice(LRUOrder.end(), LRUOrder, Used.LRUEntry);
+	}
+	else if(!Used.bLoadFailed)
+	{
+		QueueRestore(Handle);
+	}
+}
+
+void ResidencyManager::RequestResident(uint32_t Handle, uint32_t Priority)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	ASSERT(Handle < Resources.size(), "Invalid residency handle!");
+	Resource& Requested = Resources[Handle];
+	Requested.bLoadFailed = false;
+
+	if(Requested.bResident)
+	{
+		return;
+	}
+
+	// An earlier request with a lower priority stays in the queue, it's skipped once the resource is resident
+	Requested.bRestoreQueued = true;
+	RestoreQueue.push({Priority, CurrentFrame, Handle});
+}
+
+void ResidencyManager::Update()
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+
+	// The budget could have been lowered since last frame
+	const bool bOverBudget = ResidentTextureBytes > TextureBudget && !EvictTexturesTo(TextureBudget);
+	if(bOverBudget && !bWarnedOverBudget)
+	{
+		BE_WARN("{0}: textures used this frame need {1} MB, which is over the {2} MB budget", DebugName, ResidentTextureBytes >> 20, TextureBudget >> 20);
+	}
+
+	bWarnedOverBudget = bOverBudget;
+
+	std::vector<RestoreRequest> Deferred;
+	VkDeviceSize RestoredBytes = 0;
+	uint32_t NumRestored = 0;
+
+	while(!RestoreQueue.empty())
+	{
+		const RestoreRequest Request = RestoreQueue.top();
+		RestoreQueue.pop();
+
+		Resource& Requested = Resources[Request.Handle];
+		if(Requested.bResident || !Requested.bRestoreQueued)
+		{
+			continue;
+		}
+
+		if(NumRestored > 0 && RestoredBytes + Requested.Size > MaxRestoreBytesPerFrame)
+		{
+			Deferred.push_back(Request);
+			break;
+		}
+
+		// Smaller requests further down the queue might still fit
+		if(!MakeRoomFor(Requested))
+		{
+			Deferred.push_back(Request);
+			continue;
+		}
+
+		if(!Restore(Request.Handle))
+		{
+			// Failed loads aren't retried, otherwise a mesh fails when the geometry pool is full and everything after it would fail too
+			if(Requested.Type == ResourceType::Mesh && !Requested.bLoadFailed)
+			{
+				Deferred.push_back(Request);
+				break;
+			}
+
+			continue;
+		}
+
+		RestoredBytes += Requested.Size;
+		NumRestored++;
+	}
+
+	for(const RestoreRequest& Request : Deferred)
+	{
+		RestoreQueue.push(Request);
+	}
+
+#if _DEBUG
+	if(NumRestored > 0)
+	{
+		BE_INFO("{0}: restored {1} resources ({2} KB), {3} MB of {4} MB of textures and {5} of {6} pool vertices resident", DebugName, NumRestored,
+				RestoredBytes >> 10, ResidentTextureBytes >> 20, TextureBudget >> 20, ResidentVertices, Geometry.GetVertexCapacity());
+	}
+#endif
+
+	CurrentFrame++;
+}
+
+void ResidencyManager::SetTextureBudget(VkDeviceSize Bytes)
+{
+	std::unique_lock<std::mutex> MutexLock(Mutex);
+	TextureBudget = Bytes;
+}
+
+bool ResidencyManager::IsResident(uint32_t Handle) const
+{
+	ASSERT(Handle < Resources.size(), "Invalid residency handle!");
+	return Resources[Handle].bResident;
+}
+
+uint32_t ResidencyManager::GetMeshID(uint32_t Handle) const
+{
+	ASSERT(Handle < Resources.size(), "Invalid residency handle!");
+	const Resource& Mesh = Resources[Handle];
+	return Mesh.Type == ResourceType::Mesh && Mesh.bResident ? Mesh.MeshID : GeometryPool::INVALID_MESH;
+}
+
+uint32_t ResidencyManager::AddResource(Resource&& NewResource)
+{
+	const uint32_t Handle = (uint32_t)Resources.size();
+	Resources.push_back(std::move(NewResource));
+	MakeResident(Handle);
+
+	return Handle;
+}
+
+void ResidencyManager::QueueRestore(uint32_t Handle)
+{
+	Resource& Requested = Resources[Handle];
+	if(Requested.bRestoreQueued)
+	{
+		return;
+	}
+
+	Requested.bRestoreQueued = true;
+	RestoreQueue.push({Requested.Priority, CurrentFrame, Handle});
+}
+
+bool ResidencyManager::EvictTexturesTo(VkDeviceSize TargetBytes)
+{
+	// Resources used this frame are at the back, so they are only reached once everything older was evicted
+	auto Itr = LRUOrder.begin();
+	while(ResidentTextureBytes > TargetBytes && Itr != LRUOrder.end())
+	{
+		const uint32_t Handle = *Itr;
+		++Itr;
+
+		if(Resources[Handle].Type == ResourceType::Texture && CanEvict(Resources[Handle]))
+		{
+			Evict(Handle);
+		}
+	}
+
+	return ResidentTextureBytes <= TargetBytes;
+}
+
+bool ResidencyManager::EvictMeshesTo(uint32_t TargetVertices, uint32_t TargetIndices)
+{
+	auto Itr = LRUOrder.begin();
+	while((ResidentVertices > TargetVertices || ResidentIndices > TargetIndices) && Itr != LRUOrder.end())
+	{
+		const uint32_t Handle = *Itr;
+		++Itr;
+
+		if(Resources[Handle].Type == ResourceType::Mesh && CanEvict(Resources[Handle]))
+		{
+			Evict(Handle);
+		}
+	}
+
+	return ResidentVertices <= TargetVertices && ResidentIndices <= TargetIndices;
+}
+
+bool ResidencyManager::CanEvict(const Resource& Candidate) const
+{
+	if(!Candidate.bResident || Candidate.LastUsedFrame >= CurrentFrame)
+	{
+		return false;
+	}
+
+	// Meshes need their vertices or a source to load them from, textures need something to put into their slot and a way to get back
+	if(Candidate.Type == ResourceType::Mesh)
+	{
+		return Candidate.Mesh->HasCPUData() || Candidate.Mesh->CanReloadCPUData();
+	}
+
+	return Candidate.Loader && FallbackTexture;
+}
+
+bool ResidencyManager::MakeRoomFor(const Resource& Requested)
+{
+	if(Requested.Type == ResourceType::Texture)
+	{
+		if(Requested.Size > TextureBudget)
+		{
+			return false;
+		}
+
+		return ResidentTextureBytes + Requested.Size <= TextureBudget || EvictTexturesTo(TextureBudget - Requested.Size);
+	}
+
+	const uint32_t MaxVertices = Geometry.GetVertexCapacity();
+	const uint32_t MaxIndices = Geometry.GetIndexCapacity();
+	if(Requested.VertexCount > MaxVertices || Requested.IndexCount > MaxIndices)
+	{
+		return false;
+	}
+
+	if(ResidentVertices + Requested.VertexCount <= MaxVertices && ResidentIndices + Requested.IndexCount <= MaxIndices)
+	{
+		return true;
+	}
+
+	return EvictMeshesTo(MaxVertices - Requested.VertexCount, MaxIndices - Requested.IndexCount);
+}
+
+void ResidencyManager::Evict(uint32_t Handle)
+{
+	Resource& Evicted = Resources[Handle];
+
+	// Both defer freeing until the frames still in flight are done with it
+	if(Evicted.Type == ResourceType::Mesh)
+	{
+		Geometry.RemoveMesh(Evicted.MeshID);
+		Evicted.MeshID = GeometryPool::INVALID_MESH;
+		ResidentVertices -= Evicted.VertexCount;
+		ResidentIndices -= Evicted.IndexCount;
+	}
+	else
+	{
+		TextureHeap.ReplaceTexture(Evicted.Slot, FallbackTexture);
+		ResidentTextureBytes -= Evicted.Size;
+	}
+
+	LRUOrder.erase(Evicted.LRUEntry);
+	Evicted.bResident = false;
+}
+
+bool ResidencyManager::Restore(uint32_t Handle)
+{
+	Resource& Restored = Resources[Handle];
+
+	if(Restored.Type == ResourceType::Mesh)
+	{
+		// Kept apart from a full staging ring, a mesh whose source is gone isn't retried every frame
+		if(!Restored.Mesh->RequireCPUData())
+		{
+			BE_ERROR("{0}: failed to reload the data of mesh {1}, it stays evicted", DebugName, Handle);
+			Restored.bLoadFailed = true;
+			Restored.bRestoreQueued = false;
+			return false;
+		}
+
+		// Resources that were only requested ahead of use stream behind the ones something is drawing right now
+		const VulkanCore::UploadPriority Priority = Restored.LastUsedFrame == CurrentFrame ? VulkanCore::UploadPriority::Visible : VulkanCore::UploadPriority::Prefetch;
+		const uint32_t MeshID = Geometry.AddMesh(Restored.Mesh, Priority);
+		if(MeshID == GeometryPool::INVALID_MESH)
+		{
+			return false;
+		}
+
+		Restored.MeshID = MeshID;
+	}
+	else
+	{
+		std::shared_ptr<VulkanCore::Texture> LoadedTexture = Restored.Loader();
+		if(!LoadedTexture)
+		{
+			BE_ERROR("{0}: failed to reload the texture in slot {1}, it stays on the fallback texture", DebugName, Restored.Slot);
+			Restored.bLoadFailed = true;
+			Restored.bRestoreQueued = false;
+			return false;
+		}
+
+		// Could be a different size if the source changed on disk
+		Restored.Size = LoadedTexture->GetDeviceSize();
+		TextureHeap.ReplaceTexture(Restored.Slot, std::move(LoadedTexture));
+	}
+
+	MakeResident(Handle);
+	return true;
+}
+
+void ResidencyManager::MakeResident(uint32_t Handle)
+{
+	Resource& Resident = Resources[Handle];
+
+	// Counts as used this frame, otherwise the next restore could evict it right away
+	Resident.LastUsedFrame = CurrentFrame;
+	Resident.bResident = true;
+	Resident.bRestoreQueued = false;
+	Resident.LRUEntry = LRUOrder.insert(LRUOrder.end(), Handle);
+
+	if(Resident.Type == ResourceType::Mesh)
+	{
+		ResidentVertices += Resident.VertexCount;
+		ResidentIndices += Resident.IndexCount;
+	}
+	else
+	{
+		ResidentTextureBytes += Resident.Size;
+	}
+}
+
+VkDeviceSize ResidencyManager::GetMeshSize(const EngineCore::StaticMesh& Mesh)
+{
+	// The geometry pool could already have released the vertices
+	return (VkDeviceSize)Mesh.TotalVertexSize + Mesh.TotalIndexSize;
+}
\ No newline at end of file
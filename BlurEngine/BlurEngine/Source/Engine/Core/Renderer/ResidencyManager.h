@@ -0,0 +1,161 @@
+#pragma once
+
+#include "../VulkanCore/Utility.h"
+#include "../VulkanCore/VulkanCommon.h"
+
+#include "../Runtime/Model.h"
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <queue>
+
+namespace VulkanCore
+{
+	class Texture;
+	class BindlessTextureHeap;
+}
+
+class GeometryPool;
+
+// Recreates an evicted texture, usually by loading it from disk again. Returns nullptr if the texture couldn't be loaded.
+using TextureLoader = std::function<std::shared_ptr<VulkanCore::Texture>()>;
+
+// Decides which meshes and textures stay in device memory. Every resource remembers the last frame it was used in, and once the
+// resident set grows past its budget the least recently used ones are evicted. Evicted meshes keep their CPU copy and are removed
+// from the geometry pool, evicted textures are destroyed and their bindless slot points at a fallback texture until they are loaded
+// again. Using an evicted resource queues it for restoring, restores are done highest priority first within a per-frame upload budget.
+// Only evicting a texture frees device memory, so only textures count against the byte budget. The geometry pool never shrinks,
+// meshes are budgeted against its vertex and index capacity instead.
+class ResidencyManager
+{
+public:
+	MOVABLE_ONLY(ResidencyManager);
+
+	explicit ResidencyManager(GeometryPool& InGeometry, VulkanCore::BindlessTextureHeap& InTextureHeap, VkDeviceSize InTextureBudget,
+							  const std::string& Name = "");
+
+	// Adds the mesh to the geometry pool and returns its handle, or INVALID_HANDLE if it didn't fit
+	uint32_t RegisterMesh(std::shared_ptr<EngineCore::StaticMesh> Mesh, uint32_t Priority = 0);
+
+	// The texture has to be in Slot already. Textures without a loader can't be evicted.
+	uint32_t RegisterTexture(uint32_t Slot, std::shared_ptr<VulkanCore::Texture> InTexture, TextureLoader Loader, uint32_t Priority = 0);
+
+	// Evicted textures are replaced with this in their slot
+	void SetFallbackTexture(std::shared_ptr<VulkanCore::Texture> InTexture);
+
+	// Marks the resource as used this frame, evicted resources are queued for restoring
+	void MarkUsed(uint32_t Handle);
+
+	// Queues an evicted resource for restoring ahead of anything with a lower priority
+	void RequestResident(uint32_t Handle, uint32_t Priority);
+
+	// Needs to be called once per frame before the upload scheduler and the geometry pool are updated. Evicts textures down to the budget,
+	// then restores queued resources that fit. Restored meshes used this frame are streamed as visible uploads, the rest as prefetches.
+	void Update();
+
+	// Device memory resident textures may use, lowering it is how the resident set reacts to memory pressure
+	void SetTextureBudget(VkDeviceSize Bytes);
+	// Bytes restored per frame, at least one resource is restored every frame so large ones can't starve
+	void SetMaxRestoreBytesPerFrame(VkDeviceSize Bytes) { MaxRestoreBytesPerFrame = Bytes; }
+
+	bool IsResident(uint32_t Handle) const;
+	uint32_t GetMeshID(uint32_t Handle) const;
+
+	VkDeviceSize GetTextureBudget() const { return TextureBudget; }
+	VkDeviceSize GetResidentTextureBytes() const { return ResidentTextureBytes; }
+
+public:
+	static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+private:
+	enum class ResourceType : uint8_t
+	{
+		Mesh,
+		Texture
+	};
+
+	struct Resource
+	{
+		ResourceType Type = ResourceType::Mesh;
+
+		VkDeviceSize Size = 0;
+		uint64_t LastUsedFrame = 0;
+		uint32_t Priority = 0;
+		bool bResident = false;
+		bool bRestoreQueued = false;
+
+		// Only valid while resident
+		std::list<uint32_t>::iterator LRUEntry;
+
+		std::shared_ptr<EngineCore::StaticMesh> Mesh;
+		uint32_t MeshID = 0;
+		// What the mesh takes up in the geometry pool
+		uint32_t VertexCount = 0;
+		uint32_t IndexCount = 0;
+
+		TextureLoader Loader;
+		uint32_t Slot = 0;
+		// Set when loading failed, the resource isn't requested again until RequestResident is called
+		bool bLoadFailed = false;
+	};
+
+	struct RestoreRequest
+	{
+		uint32_t Priority;
+		uint64_t RequestFrame;
+		uint32_t Handle;
+
+		// Highest priority first, older requests first within a priority
+		bool operator<(const RestoreRequest& Other) const
+		{
+			return Priority != Other.Priority ? Priority < Other.Priority : RequestFrame > Other.RequestFrame;
+		}
+	};
+
+	uint32_t AddResource(Resource&& NewResource);
+
+	void QueueRestore(uint32_t Handle);
+
+	// Both evict least recently used resources of their type that weren't used this frame until the targets are met. Return false if they couldn't get there.
+	bool EvictTexturesTo(VkDeviceSize TargetBytes);
+	bool EvictMeshesTo(uint32_t TargetVertices, uint32_t TargetIndices);
+	bool CanEvict(const Resource& Candidate) const;
+
+	// Evicts whatever the resource needs room for from its own budget
+	bool MakeRoomFor(const Resource& Requested);
+
+	void Evict(uint32_t Handle);
+	bool Restore(uint32_t Handle);
+
+	void MakeResident(uint32_t Handle);
+
+	static VkDeviceSize GetMeshSize(const EngineCore::StaticMesh& Mesh);
+
+private:
+	GeometryPool& Geometry;
+	VulkanCore::BindlessTextureHeap& TextureHeap;
+
+	std::shared_ptr<VulkanCore::Texture> FallbackTexture;
+
+	VkDeviceSize TextureBudget = 0;
+	VkDeviceSize ResidentTextureBytes = 0;
+
+	// Pool ranges of evicted meshes are only reused once the GPU is done with them, so the pool's own free counts lag behind evictions
+	uint32_t ResidentVertices = 0;
+	uint32_t ResidentIndices = 0;
+	VkDeviceSize MaxRestoreBytesPerFrame = 16 * 1024 * 1024;
+
+	uint64_t CurrentFrame = 0;
+	bool bWarnedOverBudget = false;
+
+	std::vector<Resource> Resources;
+
+	// Resident resources, least recently used at the front
+	std::list<uint32_t> LRUOrder;
+	std::priority_queue<RestoreRequest> RestoreQueue;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
\ No newline at end of file
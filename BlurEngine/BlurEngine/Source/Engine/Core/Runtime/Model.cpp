@@ -1,5 +1,6 @@
 #include "Model.h"
 #include "Utility.h"
+#include "Logger.h"
 
 #include <glm/gtc/packing.hpp>
 
@@ -36,4 +37,55 @@ namespace EngineCore
 		return Out;
 	}
 
+	void StaticMesh::ReleaseCPUData()
+	{
+		if(!bCPUDataResident)
+		{
+			return;
+		}
+
+		// swap instead of clear so the memory is actually given back
+		for(Model& MeshModel : Models)
+		{
+			std::vector<Vertex>().swap(MeshModel.Vertices);
+			std::vector<Vertex16Bit>().swap(MeshModel.Vertices16Bit);
+			std::vector<uint32_t>().swap(MeshModel.Indices);
+		}
+
+		bCPUDataResident = false;
+	}
+
+	bool StaticMesh::RequireCPUData()
+	{
+		if(bCPUDataResident)
+		{
+			return true;
+		}
+
+		if(!CanReloadCPUData())
+		{
+			BE_ERROR("Mesh CPU data was released and there is no source to load it back from!");
+			return false;
+		}
+
+		std::shared_ptr<StaticMesh> Reloaded = ReloadSource();
+
+		// The GPU copy was made from the old data, a source that changed on disk would no longer match the draws
+		if(!Reloaded || Reloaded->Models.size() != Models.size() || Reloaded->TotalVertexSize != TotalVertexSize || Reloaded->TotalIndexSize != TotalIndexSize)
+		{
+			BE_ERROR("Failed to reload mesh data from {0}, the source is missing or has changed", SourcePath);
+			return false;
+		}
+
+		for(size_t Index = 0; Index < Models.size(); Index++)
+		{
+			Models[Index].Vertices = std::move(Reloaded->Models[Index].Vertices);
+			Models[Index].Vertices16Bit = std::move(Reloaded->Models[Index].Vertices16Bit);
+			Models[Index].Indices = std::move(Reloaded->Models[Index].Indices);
+		}
+
+		bCPUDataResident = true;
+		return true;
+	}
+
 }
\ No newline at end of file
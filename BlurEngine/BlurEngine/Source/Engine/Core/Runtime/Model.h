@@ -3,7 +3,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 
+#include <functional>
+#include <memory>
 #include <vector>
+#include <string>
 
 namespace EngineCore
 {
@@ -58,6 +61,7 @@ struct Vertex
 };
 
 // TODO: Should probably move this to it's own file
+// Uploaded as is into the geometry pool's material buffer, the layout has to match Material in CommonStructs.glsl
 struct Material
 {
 	glm::vec4 BaseColorIDs = glm::vec4(-1, -1, 0, 0); // X = texture ID, Y = sampler ID, Z & W ignored for padding
@@ -65,7 +69,13 @@ struct Material
 	glm::vec2 NormalIDs = glm::vec2(-1, -1); // X = texture ID, Y = sampler ID
 	glm::vec2 EmissiveIDs = glm::vec2(-1, -1); // X = texture ID, Y = sampler ID
 
-	glm::vec4 BaseColor;
+	glm::vec4 BaseColor = glm::vec4(1.0f);
+
+	// XY = UV scale, ZW = UV offset. Identity unless the texture was packed into an atlas
+	glm::vec4 BaseColorUVTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	glm::vec4 MetallicUVTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	glm::vec4 NormalUVTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	glm::vec4 EmissiveUVTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
 };
 
 struct IndirectDrawData
@@ -73,7 +83,8 @@ struct IndirectDrawData
 	uint32_t IndexCount;
 	uint32_t InstanceCount;
 	uint32_t FirstIndex;
-	uint32_t VertexOffset;
+	// Signed to match VkDrawIndexedIndirectCommand
+	int32_t VertexOffset;
 	uint32_t FirstInstance;
 
 	uint32_t MeshID;
@@ -82,6 +93,8 @@ struct IndirectDrawData
 	// Can probably add things like model mat or other mesh specific things
 };
 
+// One draw worth of geometry. Large meshes are split into several models by the loader, so indices stay 32 bit and every
+// model fits into a single geometry pool range.
 struct Model
 {
 	std::vector<Vertex> Vertices = {};
@@ -97,6 +110,19 @@ struct Model
 	int32_t MaterialIndex = -1;
 };
 
+struct StaticMesh;
+
+// Loads a mesh again from wherever it came from, returns nullptr if the source is gone
+using MeshSourceLoader = std::function<std::shared_ptr<StaticMesh>()>;
+
+enum class MeshCPUResidency : uint8_t
+{
+	// Vertices and indices stay in memory for the lifetime of the mesh
+	KeepResident,
+	// Vertices and indices are dropped once they are copied to the GPU, bounds stay. They are loaded again through ReloadSource when needed.
+	ReleaseAfterUpload
+};
+
 struct StaticMesh
 {
 	std::vector<Model> Models;
@@ -104,9 +130,30 @@ struct StaticMesh
 
 	std::vector<IndirectDrawData> IndirectDrawDataSet;
 
-	uint32_t TotalVertexSize = 0;
-	uint32_t TotalIndexSize = 0;
-	uint32_t IndexCount = 0;
+	// Sizes in bytes, still valid after the CPU data was released
+	uint64_t TotalVertexSize = 0;
+	uint64_t TotalIndexSize = 0;
+	uint64_t IndexCount = 0;
+
+	// File the mesh was loaded from, only used for logging
+	std::string SourcePath;
+	// Set by the asset layer that loaded the mesh, CPU data can't be reloaded without it
+	MeshSourceLoader ReloadSource;
+	MeshCPUResidency CPUResidency = MeshCPUResidency::KeepResident;
+
+	bool HasCPUData() const { return bCPUDataResident; }
+	bool CanReloadCPUData() const { return static_cast<bool>(ReloadSource); }
+
+	// Frees the vertices and indices of every model. AABBs, extents and material indices are kept for culling.
+	// Callers have to be done with the data, nothing may still be reading it on another thread.
+	void ReleaseCPUData();
+
+	// Loads the vertices and indices back through ReloadSource if they were released, picking or re-cooking call this before
+	// touching them. Returns false if the source is missing or doesn't match the mesh anymore.
+	bool RequireCPUData();
+
+private:
+	bool bCPUDataResident = true;
 };
 
 }
\ No newline at end of file
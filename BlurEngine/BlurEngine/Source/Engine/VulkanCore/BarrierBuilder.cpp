@@ -0,0 +1,282 @@
+#include "BarrierBuilder.h"
+#include "Texture.h"
+
+#include <algorithm>
+
+namespace VulkanCore
+{
+
+	static constexpr VkAccessFlags2 WRITE_ACCESS_MASK = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+														VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+														VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+	// State of a subresource once a barrier to DstStages and DstAccess has executed
+	static SubresourceState GetStateAfterBarrier(const SubresourceState& Before, VkImageLayout NewLayout, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess)
+	{
+		SubresourceState After{NewLayout, DstStages, DstAccess, Before.WriteStages, Before.WriteAccess, DstStages, DstAccess};
+		if(BarrierBuilder::HasWriteAccess(DstAccess))
+		{
+			// Nothing has seen the new write yet
+			After.WriteStages = DstStages;
+			After.WriteAccess = DstAccess & WRITE_ACCESS_MASK;
+			After.VisibleStages = VK_PIPELINE_STAGE_2_NONE;
+			After.VisibleAccess = VK_ACCESS_2_NONE;
+		}
+
+		return After;
+	}
+
+	void BarrierBuilder::TransitionImage(Texture& InTexture, VkImageLayout NewLayout, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess,
+										 uint32_t BaseMip, uint32_t MipCount, uint32_t BaseLayer, uint32_t LayerCount)
+	{
+		const uint32_t LastMip = MipCount == VK_REMAINING_MIP_LEVELS ? InTexture.GetMipLevels() : std::min(BaseMip + MipCount, InTexture.GetMipLevels());
+		const uint32_t LastLayer = LayerCount == VK_REMAINING_ARRAY_LAYERS ? InTexture.GetLayerCount() : std::min(BaseLayer + LayerCount, InTexture.GetLayerCount());
+
+		ASSERT(BaseMip < LastMip && BaseLayer < LastLayer, "TransitionImage was provided an empty subresource range!");
+
+		for(uint32_t Layer = BaseLayer; Layer < LastLayer; Layer++)
+		{
+			for(uint32_t Mip = BaseMip; Mip < LastMip; Mip++)
+			{
+				const SubresourceState& Current = InTexture.GetSubresourceState(Mip, Layer);
+				const SubresourceKey Key{InTexture.GetVkImage(), Mip, Layer};
+
+				const auto PendingIt = PendingLookup.find(Key);
+				if(PendingIt != PendingLookup.end())
+				{
+					// Nothing has been recorded since the pending transition, so the intermediate layout is never used and the transition can be retargeted
+					PendingTransition& Transition = PendingTransitions[PendingIt->second];
+					const bool bSameUsage = Transition.NewLayout == NewLayout && !HasWriteAccess(Transition.DstAccess) && !HasWriteAccess(DstAccess);
+					Transition.NewLayout = NewLayout;
+					Transition.DstStages = bSameUsage ? Transition.DstStages | DstStages : DstStages;
+					Transition.DstAccess = bSameUsage ? Transition.DstAccess | DstAccess : DstAccess;
+
+					InTexture.SetSubresourceState(GetStateAfterBarrier(Current, NewLayout, Transition.DstStages, Transition.DstAccess), Mip, 1, Layer, 1);
+					continue;
+				}
+
+				PendingTransition Transition;
+				Transition.Image = InTexture.GetVkImage();
+				Transition.AspectMask = InTexture.GetFullAspectMask();
+				Transition.MipLevel = Mip;
+				Transition.Layer = Layer;
+				Transition.OldLayout = Current.Layout;
+				Transition.NewLayout = NewLayout;
+				Transition.SrcStages = Current.Stages;
+				// Only writes have to be made available, a write after read just needs the execution dependency
+				Transition.SrcAccess = Current.Access & WRITE_ACCESS_MASK;
+				Transition.DstStages = DstStages;
+				Transition.DstAccess = DstAccess;
+
+				SubresourceState NewState = GetStateAfterBarrier(Current, NewLayout, DstStages, DstAccess);
+
+				if(Current.Layout == NewLayout && !HasWriteAccess(Current.Access) && !HasWriteAccess(DstAccess))
+				{
+					// The readers are accumulated so the next write waits on all of them
+					NewState = Current;
+					NewState.Stages |= DstStages;
+					NewState.Access |= DstAccess;
+
+					// Read after read needs no barrier once the last write has been made visible to the new stages and accesses
+					const bool bWriteVisible = Current.WriteAccess == VK_ACCESS_2_NONE ||
+											   ((DstStages & ~Current.VisibleStages) == 0 && (DstAccess & ~Current.VisibleAccess) == 0);
+					if(bWriteVisible)
+					{
+						InTexture.SetSubresourceState(NewState, Mip, 1, Layer, 1);
+						continue;
+					}
+
+					// Waits on the writer and on the earlier readers, those chain this barrier after the one that made the write visible
+					Transition.SrcStages = Current.WriteStages | Current.Stages;
+					Transition.SrcAccess = Current.WriteAccess;
+					NewState.VisibleStages |= DstStages;
+					NewState.VisibleAccess |= DstAccess;
+				}
+
+				PendingLookup[Key] = PendingTransitions.size();
+				PendingTransitions.emplace_back(Transition);
+
+				InTexture.SetSubresourceState(NewState, Mip, 1, Layer, 1);
+			}
+		}
+	}
+
+	void BarrierBuilder::TransitionImage(Texture& InTexture, VkImageLayout NewLayout)
+	{
+		VkPipelineStageFlags2 DstStages;
+		VkAccessFlags2 DstAccess;
+		GetLayoutStageAndAccess(NewLayout, DstStages, DstAccess);
+
+		TransitionImage(InTexture, NewLayout, DstStages, DstAccess);
+	}
+
+	void BarrierBuilder::BufferBarrier(VkBuffer InBuffer, VkDeviceSize Offset, VkDeviceSize Size, VkPipelineStageFlags2 SrcStages, VkAccessFlags2 SrcAccess,
+									   VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess)
+	{
+		VkBufferMemoryBarrier2 Barrier{};
+		Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		Barrier.srcStageMask = SrcStages;
+		Barrier.srcAccessMask = SrcAccess & WRITE_ACCESS_MASK;
+		Barrier.dstStageMask = DstStages;
+		Barrier.dstAccessMask = DstAccess;
+		Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		Barrier.buffer = InBuffer;
+		Barrier.offset = Offset;
+		Barrier.size = Size;
+		Barrier.pNext = VK_NULL_HANDLE;
+
+		BufferBarriers.emplace_back(Barrier);
+	}
+
+	void BarrierBuilder::Flush(VkCommandBuffer CmdBuffer)
+	{
+		if(IsEmpty())
+		{
+			return;
+		}
+
+		// Sorted so neighbouring mips and layers with the same transition end up next to each other
+		std::sort(PendingTransitions.begin(), PendingTransitions.end(), [](const PendingTransition& A, const PendingTransition& B)
+		{
+			if(A.Image != B.Image)
+			{
+				return A.Image < B.Image;
+			}
+
+			return A.Layer != B.Layer ? A.Layer < B.Layer : A.MipLevel < B.MipLevel;
+		});
+
+		ImageBarriers.clear();
+
+		for(const PendingTransition& Transition : PendingTransitions)
+		{
+			VkImageMemoryBarrier2 Barrier{};
+			Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+			Barrier.srcStageMask = Transition.SrcStages;
+			Barrier.srcAccessMask = Transition.SrcAccess;
+			Barrier.dstStageMask = Transition.DstStages;
+			Barrier.dstAccessMask = Transition.DstAccess;
+			Barrier.oldLayout = Transition.OldLayout;
+			Barrier.newLayout = Transition.NewLayout;
+			Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			Barrier.image = Transition.Image;
+			Barrier.subresourceRange = {Transition.AspectMask, Transition.MipLevel, 1, Transition.Layer, 1};
+			Barrier.pNext = VK_NULL_HANDLE;
+
+			if(!ImageBarriers.empty())
+			{
+				// Extend the previous range to the next mip of the same layer
+				VkImageMemoryBarrier2& Previous = ImageBarriers.back();
+				const VkImageSubresourceRange& Range = Previous.subresourceRange;
+				if(HasSameTransition(Previous, Barrier) && Range.layerCount == 1 && Range.baseArrayLayer == Transition.Layer &&
+				   Range.baseMipLevel + Range.levelCount == Transition.MipLevel)
+				{
+					Previous.subresourceRange.levelCount++;
+					continue;
+				}
+			}
+
+			ImageBarriers.emplace_back(Barrier);
+		}
+
+		// Merge ranges covering the same mips of consecutive layers
+		std::vector<VkImageMemoryBarrier2> MergedBarriers;
+		MergedBarriers.reserve(ImageBarriers.size());
+		for(const VkImageMemoryBarrier2& Barrier : ImageBarriers)
+		{
+			bool bMerged = false;
+			for(auto It = MergedBarriers.rbegin(); It != MergedBarriers.rend() && It->image == Barrier.image; ++It)
+			{
+				VkImageSubresourceRange& Range = It->subresourceRange;
+				if(HasSameTransition(*It, Barrier) && Range.baseMipLevel == Barrier.subresourceRange.baseMipLevel &&
+				   Range.levelCount == Barrier.subresourceRange.levelCount && Range.baseArrayLayer + Range.layerCount == Barrier.subresourceRange.baseArrayLayer)
+				{
+					Range.layerCount++;
+					bMerged = true;
+					break;
+				}
+			}
+
+			if(!bMerged)
+			{
+				MergedBarriers.emplace_back(Barrier);
+			}
+		}
+		ImageBarriers.swap(MergedBarriers);
+
+		VkDependencyInfo DependencyInfo{};
+		DependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		DependencyInfo.imageMemoryBarrierCount = (uint32_t)ImageBarriers.size();
+		DependencyInfo.pImageMemoryBarriers = ImageBarriers.data();
+		DependencyInfo.bufferMemoryBarrierCount = (uint32_t)BufferBarriers.size();
+		DependencyInfo.pBufferMemoryBarriers = BufferBarriers.data();
+		DependencyInfo.pNext = VK_NULL_HANDLE;
+
+		vkCmdPipelineBarrier2(CmdBuffer, &DependencyInfo);
+
+		PendingTransitions.clear();
+		PendingLookup.clear();
+		ImageBarriers.clear();
+		BufferBarriers.clear();
+	}
+
+	void BarrierBuilder::GetLayoutStageAndAccess(VkImageLayout Layout, VkPipelineStageFlags2& OutStages, VkAccessFlags2& OutAccess)
+	{
+		switch(Layout)
+		{
+		case VK_IMAGE_LAYOUT_UNDEFINED:
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+			// Presentation waits on a semaphore, so nothing needs to be made visible
+			OutStages = VK_PIPELINE_STAGE_2_NONE;
+			OutAccess = VK_ACCESS_2_NONE;
+			break;
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			OutStages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+			OutAccess = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_STENCIL_ATTACHMENT_OPTIMAL:
+			OutStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+			OutAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL:
+			OutStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+			OutAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			OutStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+			OutAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			OutStages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+			OutAccess = VK_ACCESS_2_TRANSFER_READ_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			OutStages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+			OutAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			break;
+		default:
+			// General and less common layouts can be used by anything, callers that know better should pass explicit masks
+			OutStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			OutAccess = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+			break;
+		}
+	}
+
+	bool BarrierBuilder::HasWriteAccess(VkAccessFlags2 Access)
+	{
+		return (Access & WRITE_ACCESS_MASK) != 0;
+	}
+
+	bool BarrierBuilder::HasSameTransition(const VkImageMemoryBarrier2& A, const VkImageMemoryBarrier2& B)
+	{
+		return A.image == B.image && A.oldLayout == B.oldLayout && A.newLayout == B.newLayout &&
+			   A.srcStageMask == B.srcStageMask && A.srcAccessMask == B.srcAccessMask && A.dstStageMask == B.dstStageMask &&
+			   A.dstAccessMask == B.dstAccessMask && A.subresourceRange.aspectMask == B.subresourceRange.aspectMask;
+	}
+
+}
\ No newline at end of file
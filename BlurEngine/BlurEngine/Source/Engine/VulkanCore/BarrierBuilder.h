@@ -0,0 +1,90 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <unordered_map>
+
+namespace VulkanCore
+{
+
+class Texture;
+
+// Collects image and buffer transitions for a pass and records them with a single vkCmdPipelineBarrier2.
+// Source masks come from the state tracked in each texture, so only the stages and writes that actually happened are waited on.
+class BarrierBuilder final
+{
+public:
+	MOVABLE_ONLY(BarrierBuilder);
+
+	BarrierBuilder() = default;
+
+	// Transitions a subresource range of the texture to NewLayout for use in DstStages with DstAccess
+	void TransitionImage(Texture& InTexture, VkImageLayout NewLayout, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess,
+						 uint32_t BaseMip = 0, uint32_t MipCount = VK_REMAINING_MIP_LEVELS, uint32_t BaseLayer = 0, uint32_t LayerCount = VK_REMAINING_ARRAY_LAYERS);
+
+	// Same as above, the destination masks are derived from the layout
+	void TransitionImage(Texture& InTexture, VkImageLayout NewLayout);
+
+	void BufferBarrier(VkBuffer InBuffer, VkDeviceSize Offset, VkDeviceSize Size, VkPipelineStageFlags2 SrcStages, VkAccessFlags2 SrcAccess,
+					   VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess);
+
+	// Records every pending barrier, does nothing if there is nothing to wait on
+	void Flush(VkCommandBuffer CmdBuffer);
+
+	bool IsEmpty() const { return PendingTransitions.empty() && BufferBarriers.empty(); }
+
+	// Tightest stages and accesses that a layout is typically used with
+	static void GetLayoutStageAndAccess(VkImageLayout Layout, VkPipelineStageFlags2& OutStages, VkAccessFlags2& OutAccess);
+
+	static bool HasWriteAccess(VkAccessFlags2 Access);
+
+private:
+	struct PendingTransition
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageAspectFlags AspectMask = 0;
+		uint32_t MipLevel = 0;
+		uint32_t Layer = 0;
+
+		VkImageLayout OldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout NewLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 SrcStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 SrcAccess = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 DstStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 DstAccess = VK_ACCESS_2_NONE;
+	};
+
+	struct SubresourceKey
+	{
+		VkImage Image;
+		uint32_t MipLevel;
+		uint32_t Layer;
+
+		bool operator==(const SubresourceKey& Other) const
+		{
+			return Image == Other.Image && MipLevel == Other.MipLevel && Layer == Other.Layer;
+		}
+	};
+
+	struct SubresourceKeyHash
+	{
+		size_t operator()(const SubresourceKey& Key) const
+		{
+			size_t Seed = 0;
+			Util::HashCombine(Seed, Key.Image, Key.MipLevel, Key.Layer);
+			return Seed;
+		}
+	};
+
+	// True if both barriers only differ in the subresources they cover
+	static bool HasSameTransition(const VkImageMemoryBarrier2& A, const VkImageMemoryBarrier2& B);
+
+	std::vector<PendingTransition> PendingTransitions;
+	std::unordered_map<SubresourceKey, size_t, SubresourceKeyHash> PendingLookup;
+
+	std::vector<VkImageMemoryBarrier2> ImageBarriers;
+	std::vector<VkBufferMemoryBarrier2> BufferBarriers;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "BindlessTextureHeap.h"
+#include "Pipeline.h"
+#include "Texture.h"
+#include "Defragmenter.h"
+
+#include <algorithm>
+
+namespace VulkanCore
+{
+
+	BindlessTextureHeap::BindlessTextureHeap(std::shared_ptr<Pipeline> InPipeline, uint32_t InSet, uint32_t InBinding, uint32_t InCapacity,
+											 uint32_t InFramesInFlight, const std::string& Name)
+		: TargetPipeline{InPipeline}, Set{InSet}, Binding{InBinding}, Capacity{InCapacity}, FramesInFlight{InFramesInFlight}, 
+		  DebugName{"Bindless Texture Heap: " + Name}
+	{
+		ASSERT(TargetPipeline, "Bindless texture heap needs a valid pipeline to write descriptors to!");
+
+		Textures.resize(Capacity);
+		FreeSlots.reserve(Capacity);
+		PendingWrites.resize(FramesInFlight);
+
+		// Hand out low slots first so the populated part of the array stays compact
+		for(uint32_t Slot = Capacity; Slot > 0; Slot--)
+		{
+			FreeSlots.push_back(Slot - 1);
+		}
+	}
+
+	uint32_t BindlessTextureHeap::AllocateSlot(std::shared_ptr<Texture> InTexture)
+	{
+		ASSERT(InTexture, "Trying to allocate a bindless slot for a null texture!");
+
+		RegisterTexture(InTexture);
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(FreeSlots.empty())
+		{
+			BE_ERROR("{0} is out of free slots!", DebugName);
+			return INVALID_SLOT;
+		}
+
+		const uint32_t Slot = FreeSlots.back();
+		FreeSlots.pop_back();
+
+		Textures[Slot] = std::move(InTexture);
+		QueueWrite(Slot);
+		NumAllocatedSlots++;
+
+		return Slot;
+	}
+
+	void BindlessTextureHeap::FreeSlot(uint32_t Slot)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(Slot >= Capacity || !Textures[Slot])
+		{
+			BE_ERROR("{0}: trying to free slot {1} which isn't allocated!", DebugName, Slot);
+			return;
+		}
+
+		// Nothing reads a free slot, sets that haven't been written yet can keep whatever they had
+		for(std::vector<uint32_t>& SetWrites : PendingWrites)
+		{
+			SetWrites.erase(std::remove(SetWrites.begin(), SetWrites.end(), Slot), SetWrites.end());
+		}
+
+		RetiredSlots.push_back({Slot, CurrentFrame, std::move(Textures[Slot]), true});
+		Textures[Slot] = nullptr;
+		NumAllocatedSlots--;
+	}
+
+	void BindlessTextureHeap::ReplaceTexture(uint32_t Slot, std::shared_ptr<Texture> InTexture)
+	{
+		ASSERT(InTexture, "Trying to replace a bindless slot with a null texture!");
+
+		RegisterTexture(InTexture);
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(Slot >= Capacity || !Textures[Slot])
+		{
+			BE_ERROR("{0}: trying to replace the texture of slot {1} which isn't allocated!", DebugName, Slot);
+			return;
+		}
+
+		if(Textures[Slot] == InTexture)
+		{
+			return;
+		}
+
+		RetiredSlots.push_back({Slot, CurrentFrame, std::move(Textures[Slot]), false});
+		Textures[Slot] = std::move(InTexture);
+		QueueWrite(Slot);
+	}
+
+	void BindlessTextureHeap::SetDefragmenter(Defragmenter* InDefragmenter)
+	{
+		TextureDefragmenter = InDefragmenter;
+	}
+
+	void BindlessTextureHeap::RegisterTexture(const std::shared_ptr<Texture>& InTexture)
+	{
+		// Textures aliased into memory they don't own, like render targets, can't be moved
+		if(TextureDefragmenter && InTexture->GetAllocation() != nullptr)
+		{
+			TextureDefragmenter->Register(InTexture);
+		}
+	}
+
+	void BindlessTextureHeap::RewriteTexture(const Texture* InTexture)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		for(uint32_t Slot = 0; Slot < Capacity; Slot++)
+		{
+			if(Textures[Slot].get() == InTexture)
+			{
+				QueueWrite(Slot);
+			}
+		}
+	}
+
+	void BindlessTextureHeap::QueueWrite(uint32_t Slot)
+	{
+		for(std::vector<uint32_t>& SetWrites : PendingWrites)
+		{
+			if(std::find(SetWrites.begin(), SetWrites.end(), Slot) == SetWrites.end())
+			{
+				SetWrites.push_back(Slot);
+			}
+		}
+	}
+
+	void BindlessTextureHeap::BeginFrame()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		CurrentFrame++;
+
+		// A slot freed during frame N can still be read by the previous FramesInFlight submissions and frame N itself,
+		// all of which have been waited on once we are FramesInFlight frames past it
+		while(!RetiredSlots.empty() && RetiredSlots.front().RetiredFrame + FramesInFlight <= CurrentFrame)
+		{
+			if(RetiredSlots.front().bRecycleSlot)
+			{
+				FreeSlots.push_back(RetiredSlots.front().Slot);
+			}
+
+			RetiredSlots.pop_front();
+		}
+	}
+
+	void BindlessTextureHeap::FlushWrites(uint32_t SetIndex)
+	{
+		ASSERT(SetIndex < FramesInFlight, "Bindless texture heap has one set per frame in flight!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		std::vector<uint32_t>& SetWrites = PendingWrites[SetIndex];
+		if(SetWrites.empty())
+		{
+			return;
+		}
+
+		std::sort(SetWrites.begin(), SetWrites.end());
+
+		// Contiguous slots are written with a single descriptor write
+		size_t RunStart = 0;
+		for(size_t Index = 1; Index <= SetWrites.size(); Index++)
+		{
+			if(Index < SetWrites.size() && SetWrites[Index] == SetWrites[Index - 1] + 1)
+			{
+				continue;
+			}
+
+			const uint32_t FirstSlot = SetWrites[RunStart];
+			const size_t RunLength = Index - RunStart;
+
+			std::span<const std::shared_ptr<Texture>> RunTextures(Textures.begin() + FirstSlot, RunLength);
+			TargetPipeline->BindResource(Set, Binding, SetIndex, RunTextures, nullptr, FirstSlot);
+
+			RunStart = Index;
+		}
+
+		SetWrites.clear();
+	}
+
+	std::shared_ptr<Texture> BindlessTextureHeap::GetTexture(uint32_t Slot) const
+	{
+		ASSERT(Slot < Capacity, "Slot is outside of the bindless texture heap!");
+		return Textures[Slot];
+	}
+
+}
\ No newline at end of file
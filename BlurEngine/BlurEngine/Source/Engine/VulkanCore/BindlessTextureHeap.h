@@ -0,0 +1,99 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <deque>
+#include <mutex>
+
+namespace VulkanCore
+{
+
+class Pipeline;
+class Texture;
+class Defragmenter;
+
+// Manages the slots of a bindless texture array. Textures are written to their slot with update-after-bind,
+// so materials only need to store the slot index and switching materials doesn't require any descriptor binds.
+// The array has one set per frame in flight. A slot that changes is written into each set once that set's frame comes
+// around, so descriptors that submitted frames are still reading are never overwritten.
+class BindlessTextureHeap final
+{
+public:
+	MOVABLE_ONLY(BindlessTextureHeap);
+
+	explicit BindlessTextureHeap(std::shared_ptr<Pipeline> InPipeline, uint32_t InSet, uint32_t InBinding, uint32_t InCapacity, 
+								 uint32_t InFramesInFlight, const std::string& Name = "");
+
+	// Returns the slot the texture was placed in, or INVALID_SLOT if the heap is full
+	uint32_t AllocateSlot(std::shared_ptr<Texture> InTexture);
+
+	// The slot (and the texture it references) is kept alive until every frame that could still be using it has been retired
+	void FreeSlot(uint32_t Slot);
+
+	// Points an allocated slot at a different texture without changing the slot index. The previous texture is kept alive
+	// until every frame that could still be sampling it has been retired.
+	void ReplaceTexture(uint32_t Slot, std::shared_ptr<Texture> InTexture);
+
+	// Textures placed in the heap from now on are registered with the defragmenter, RewriteTexture has to be called for moved ones.
+	// Needs to be set before textures are added from other threads.
+	void SetDefragmenter(Defragmenter* InDefragmenter);
+
+	// Writes every slot referencing the texture again, needed after its image view changed. The previous view has to stay
+	// alive for FramesInFlight frames, until every set has been written.
+	void RewriteTexture(const Texture* InTexture);
+
+	// Needs to be called once per frame after waiting on the frame's fence, recycles slots the GPU is no longer using
+	void BeginFrame();
+
+	// Batches every slot the set hasn't seen yet into as few descriptor writes as possible. SetIndex is the current frame in
+	// flight, the set can't be in use by the GPU anymore.
+	void FlushWrites(uint32_t SetIndex);
+
+	std::shared_ptr<Texture> GetTexture(uint32_t Slot) const;
+
+	uint32_t GetCapacity() const { return Capacity; }
+	uint32_t GetNumAllocatedSlots() const { return NumAllocatedSlots; }
+
+public:
+	static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+private:
+	struct RetiredSlot
+	{
+		uint32_t Slot;
+		uint64_t RetiredFrame;
+		std::shared_ptr<Texture> RetiredTexture;
+		// False if only the texture was replaced and the slot itself is still in use
+		bool bRecycleSlot = true;
+	};
+
+	// Registers textures that own their memory with the defragmenter if there is one
+	void RegisterTexture(const std::shared_ptr<Texture>& InTexture);
+
+	// Queues the slot to be written into every set, expects the mutex to be held
+	void QueueWrite(uint32_t Slot);
+
+	std::shared_ptr<Pipeline> TargetPipeline;
+	Defragmenter* TextureDefragmenter = nullptr;
+	uint32_t Set = 0;
+	uint32_t Binding = 0;
+
+	uint32_t Capacity = 0;
+	uint32_t FramesInFlight = 0;
+	uint32_t NumAllocatedSlots = 0;
+
+	uint64_t CurrentFrame = 0;
+
+	std::vector<std::shared_ptr<Texture>> Textures;
+	std::vector<uint32_t> FreeSlots;
+	std::deque<RetiredSlot> RetiredSlots;
+	// Set index to the slots that still have to be written into that set
+	std::vector<std::vector<uint32_t>> PendingWrites;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
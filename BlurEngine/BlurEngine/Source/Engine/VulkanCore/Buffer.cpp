@@ -1,49 +1,123 @@
 #include "Buffer.h"
 #include "Context.h"
+#include "BarrierBuilder.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BE_STREAMING_STORES 1
+#endif
 
 namespace VulkanCore
 {
-	
-	Buffer::Buffer(const Context& DeviceContext, VmaAllocator InAllocator, VkDeviceSize Size, VkBufferUsageFlags Usage, 
-				   std::shared_ptr<Buffer> ActualBuffer, const std::string& Name)
-		: VulkanDevice{DeviceContext.GetDevice()}, Allocator{InAllocator}, DeviceSize{Size}, UsageFlags{Usage}, StagingBuffer{ActualBuffer}, DebugName{Name}
+
+	// Below this the fence and alignment handling cost more than the cache pollution they avoid
+	static constexpr size_t MIN_STREAMING_COPY_SIZE = 256;
+
+	// Every stage a buffer with these usages can be accessed in, the accesses are split into reads and writes
+	static void GetUsageScope(VkBufferUsageFlags Usage, VkPipelineStageFlags2& OutStages, VkAccessFlags2& OutReads, VkAccessFlags2& OutWrites)
 	{
-		ASSERT(StagingBuffer, "Actual buffer must not be null when creating a staging buffer!");
-		ASSERT(StagingBuffer->UsageFlags & VK_BUFFER_USAGE_TRANSFER_DST_BIT, "Actual buffer must be dst buffer when creating a staging buffer!");
-		ASSERT(StagingBuffer->AllocCreateInfo.usage == VMA_MEMORY_USAGE_GPU_ONLY,
-			   "Actual buffer must be GPU only when creating a staging buffer. Buffer will be uploaded from CPU to this GPU buffer");
+		constexpr VkPipelineStageFlags2 ShaderStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
 
-		VkBufferCreateInfo CreateInfo{};
-		CreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		CreateInfo.flags = {};
-		CreateInfo.size = DeviceSize;
-		CreateInfo.usage = Usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		CreateInfo.queueFamilyIndexCount = {};
-		CreateInfo.pQueueFamilyIndices = {};
-		CreateInfo.pNext = VK_NULL_HANDLE;
+		OutStages = 0;
+		OutReads = 0;
+		OutWrites = 0;
+
+		if(Usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+		{
+			OutStages |= VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+			OutReads |= VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+		}
 
-		AllocCreateInfo = { VMA_ALLOCATION_CREATE_MAPPED_BIT, VMA_MEMORY_USAGE_CPU_ONLY };
+		if(Usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+		{
+			OutStages |= VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+			OutReads |= VK_ACCESS_2_INDEX_READ_BIT;
+		}
 
-		VK_CHECK(vmaCreateBuffer(Allocator, &CreateInfo, &AllocCreateInfo, &VulkanBuffer, &Allocation, nullptr));
-		vmaGetAllocationInfo(Allocator, Allocation, &AllocationInfo);
+		if(Usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+		{
+			OutStages |= VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+			OutReads |= VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+		}
+
+		if(Usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT))
+		{
+			OutStages |= ShaderStages;
+			OutReads |= VK_ACCESS_2_UNIFORM_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		}
+
+		if(Usage & (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT))
+		{
+			OutStages |= ShaderStages;
+			OutReads |= VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+			OutWrites |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		}
 
-		DebugName = "Staging Buffer: " + DebugName;
+		if(Usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+		{
+			OutStages |= VK_PIPELINE_STAGE_2_COPY_BIT;
+			OutReads |= VK_ACCESS_2_TRANSFER_READ_BIT;
+		}
+
+		if(Usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+		{
+			OutStages |= VK_PIPELINE_STAGE_2_COPY_BIT;
+			OutWrites |= VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		}
 	}
 
+	static bool IsWriteCombinedMemory(VmaAllocator Allocator, VmaAllocation Allocation)
+	{
+		VkMemoryPropertyFlags MemoryFlags = 0;
+		vmaGetAllocationMemoryProperties(Allocator, Allocation, &MemoryFlags);
+		return (MemoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(MemoryFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+	}
+	
 	Buffer::Buffer(const Context& DeviceContext, VmaAllocator InAllocator, const VkBufferCreateInfo& CreateInfo, 
 				   const VmaAllocationCreateInfo& AllocInfo, const std::string& Name)
 		: VulkanDevice{DeviceContext.GetDevice()}, Allocator{InAllocator}, DeviceSize{CreateInfo.size}, UsageFlags{CreateInfo.usage}, 
 		  AllocCreateInfo{AllocInfo}, DebugName{Name} 
 	{
-		VK_CHECK(vmaCreateBuffer(Allocator, &CreateInfo, &AllocCreateInfo, &VulkanBuffer, &Allocation, nullptr));
+		// Descriptor buffers reference buffers by their device address, that includes buffers not created through the context
+		constexpr VkBufferUsageFlags DescriptorUsages = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+														VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+		VkBufferCreateInfo BufferInfo = CreateInfo;
+		if(DeviceContext.IsDescriptorBufferEnabled() && (BufferInfo.usage & DescriptorUsages))
+		{
+			BufferInfo.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+			UsageFlags = BufferInfo.usage;
+		}
+
+		VK_CHECK(vmaCreateBuffer(Allocator, &BufferInfo, &AllocCreateInfo, &VulkanBuffer, &Allocation, nullptr));
 		vmaGetAllocationInfo(Allocator, Allocation, &AllocationInfo);
 
+		MemoryCategory UsageCategory = MemoryCategory::Other;
+		if(UsageFlags & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+		{
+			UsageCategory = MemoryCategory::Meshes;
+		}
+		else if(UsageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+		{
+			UsageCategory = MemoryCategory::Uniforms;
+		}
+		else if((UsageFlags & ~VK_BUFFER_USAGE_TRANSFER_SRC_BIT) == 0)
+		{
+			UsageCategory = MemoryCategory::Staging;
+		}
+
+		TrackMemory(DeviceContext, UsageCategory);
+		bWriteCombined = IsWriteCombinedMemory(Allocator, Allocation);
+
 		DebugName = "Buffer: " + DebugName;
 	}
 
 	Buffer::~Buffer()
 	{
+		if(MemoryTracker)
+		{
+			MemoryTracker->UntrackAllocation(Category, AllocationInfo.size);
+		}
+
 		if(MappedMemory)
 		{
 			vmaUnmapMemory(Allocator, Allocation);
@@ -67,33 +141,81 @@ namespace VulkanCore
 		VK_CHECK(vmaFlushAllocation(Allocator, Allocation, Offset, Size));
 	}
 
-	void Buffer::UploadStagingBuffer(const VkCommandBuffer CmdBuffer, uint64_t SrcOffset, uint64_t DstOffset)
+	void Buffer::Invalidate(VkDeviceSize Offset, VkDeviceSize Size) const
 	{
-		VkBufferCopy CopyRegion{};
-		CopyRegion.srcOffset = SrcOffset;
-		CopyRegion.dstOffset = DstOffset;
-		CopyRegion.size = DeviceSize;
-
-		ASSERT(StagingBuffer != nullptr, "Staging buffer cannot be null when uploading to GPU!");
-		vkCmdCopyBuffer(CmdBuffer, VulkanBuffer, StagingBuffer->GetVkBuffer(), 1, &CopyRegion);
+		VK_CHECK(vmaInvalidateAllocation(Allocator, Allocation, Offset, Size));
 	}
 
 	void Buffer::CopyToBuffer(const void* Data, size_t Size)
 	{
-		if(!MappedMemory)
+		ASSERT(Size <= DeviceSize, "Trying to copy more data than fits into the buffer!");
+
+		void* Dst = Map();
+		if(bWriteCombined)
 		{
-			VK_CHECK(vmaMapMemory(Allocator, Allocation, &MappedMemory));
+			StreamCopy(Dst, Data, Size);
 		}
-		memcpy(MappedMemory, Data, Size);
+		else
+		{
+			memcpy(Dst, Data, Size);
+		}
+
+		// Per-frame memory isn't required to be coherent anymore, this is a no-op when it is
+		VK_CHECK(vmaFlushAllocation(Allocator, Allocation, 0, Size));
 	}
 
-	VkDeviceAddress Buffer::GetDeviceAddress()
+	void Buffer::StreamCopy(void* Dst, const void* Src, size_t Size)
 	{
-		if (StagingBuffer)
+#if BE_STREAMING_STORES
+		if(Size < MIN_STREAMING_COPY_SIZE)
+		{
+			memcpy(Dst, Src, Size);
+			return;
+		}
+
+		uint8_t* DstBytes = static_cast<uint8_t*>(Dst);
+		const uint8_t* SrcBytes = static_cast<const uint8_t*>(Src);
+
+		// Streaming stores need a 16 byte aligned destination, the source can stay unaligned
+		const size_t Misalignment = reinterpret_cast<uintptr_t>(DstBytes) & 15;
+		if(Misalignment != 0)
+		{
+			const size_t Head = 16 - Misalignment;
+			memcpy(DstBytes, SrcBytes, Head);
+			DstBytes += Head;
+			SrcBytes += Head;
+			Size -= Head;
+		}
+
+		// Four stores per iteration fill a whole 64 byte write-combining line
+		for(; Size >= 64; Size -= 64, DstBytes += 64, SrcBytes += 64)
 		{
-			return StagingBuffer->GetDeviceAddress();
+			const __m128i A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SrcBytes));
+			const __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SrcBytes + 16));
+			const __m128i C = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SrcBytes + 32));
+			const __m128i D = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SrcBytes + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(DstBytes), A);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(DstBytes + 16), B);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(DstBytes + 32), C);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(DstBytes + 48), D);
 		}
 
+		for(; Size >= 16; Size -= 16, DstBytes += 16, SrcBytes += 16)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i*>(DstBytes), _mm_loadu_si128(reinterpret_cast<const __m128i*>(SrcBytes)));
+		}
+
+		memcpy(DstBytes, SrcBytes, Size);
+
+		// Non-temporal stores are weakly ordered, they have to be visible before the flush or submit that follows
+		_mm_sfence();
+#else
+		memcpy(Dst, Src, Size);
+#endif
+	}
+
+	VkDeviceAddress Buffer::GetDeviceAddress()
+	{
 #if defined(VK_KHR_buffer_device_address)
 		if(!BufferDeviceAddress)
 		{
@@ -111,6 +233,104 @@ namespace VulkanCore
 #endif
 	}
 
+	bool Buffer::IsHostVisible() const
+	{
+		VkMemoryPropertyFlags MemoryFlags = 0;
+		vmaGetAllocationMemoryProperties(Allocator, Allocation, &MemoryFlags);
+		return (MemoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+	}
+
+	bool Buffer::CanRelocate() const
+	{
+		constexpr VkBufferUsageFlags CopyUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		return GetMappedMemory() == nullptr && BufferViews.empty() && (UsageFlags & CopyUsage) == CopyUsage;
+	}
+
+	VkBuffer Buffer::Relocate(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers, VmaAllocation DstAllocation)
+	{
+		ASSERT(CanRelocate(), "Trying to relocate a buffer that can't be moved!");
+
+		VkBufferCreateInfo CreateInfo{};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		CreateInfo.size = DeviceSize;
+		CreateInfo.usage = UsageFlags;
+		CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		CreateInfo.pNext = VK_NULL_HANDLE;
+
+		VkBuffer NewBuffer = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateBuffer(VulkanDevice, &CreateInfo, nullptr, &NewBuffer));
+		VK_CHECK(vmaBindBufferMemory(Allocator, DstAllocation, NewBuffer));
+
+		// Only the stages the buffer's usage allows can have touched it
+		VkPipelineStageFlags2 UsageStages = 0;
+		VkAccessFlags2 UsageReads = 0;
+		VkAccessFlags2 UsageWrites = 0;
+		GetUsageScope(UsageFlags, UsageStages, UsageReads, UsageWrites);
+
+		// Whatever last wrote the buffer has to finish before it is copied
+		Barriers.BufferBarrier(VulkanBuffer, 0, VK_WHOLE_SIZE, UsageStages, UsageWrites, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+		Barriers.Flush(CmdBuffer);
+
+		VkBufferCopy CopyRegion{};
+		CopyRegion.srcOffset = 0;
+		CopyRegion.dstOffset = 0;
+		CopyRegion.size = DeviceSize;
+		vkCmdCopyBuffer(CmdBuffer, VulkanBuffer, NewBuffer, 1, &CopyRegion);
+
+		Barriers.BufferBarrier(NewBuffer, 0, VK_WHOLE_SIZE, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+							   UsageStages, UsageReads | UsageWrites);
+
+		// Points at the new memory until the pass ends, RefreshAllocationInfo picks up the final state after that
+		vmaGetAllocationInfo(Allocator, DstAllocation, &AllocationInfo);
+		MappedMemory = nullptr;
+
+		BufferDeviceAddress = 0;
+		return std::exchange(VulkanBuffer, NewBuffer);
+	}
+
+	void Buffer::RefreshAllocationInfo()
+	{
+		vmaGetAllocationInfo(Allocator, Allocation, &AllocationInfo);
+	}
+
+	void Buffer::SetMemoryCategory(MemoryCategory NewCategory)
+	{
+		if(MemoryTracker && NewCategory != Category)
+		{
+			MemoryTracker->UntrackAllocation(Category, AllocationInfo.size);
+			MemoryTracker->TrackAllocation(NewCategory, AllocationInfo.size);
+		}
+
+		Category = NewCategory;
+	}
+
+	void* Buffer::Map()
+	{
+		if(AllocationInfo.pMappedData)
+		{
+			return AllocationInfo.pMappedData;
+		}
+
+		if(!MappedMemory)
+		{
+			VK_CHECK(vmaMapMemory(Allocator, Allocation, &MappedMemory));
+		}
+
+		return MappedMemory;
+	}
+
+
+	void Buffer::TrackMemory(const Context& DeviceContext, MemoryCategory InCategory)
+	{
+		Category = InCategory;
+		MemoryTracker = DeviceContext.GetMemoryTracker();
+
+		if(MemoryTracker)
+		{
+			MemoryTracker->TrackAllocation(Category, AllocationInfo.size);
+		}
+	}
+
 	VkBufferView Buffer::RequestBufferView(VkFormat ViewFormat)
 	{
 		auto Itr = BufferViews.find(ViewFormat);
@@ -3,24 +3,30 @@
 #include "VulkanCommon.h"
 #include "Utility.h"
 
+#include "MemoryBudgetTracker.h"
+
 #include <vma/vk_mem_alloc.h>
 
 #include <unordered_map>
+#include <vector>
 
 namespace VulkanCore
 {
 
 class Context;
+class BarrierBuilder;
+
+struct BufferRange
+{
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+};
 
 class Buffer final
 {
 public:
 	MOVABLE_ONLY(Buffer);
 
-	// For staging buffer
-	explicit Buffer(const Context& DeviceContext, VmaAllocator InAllocator, VkDeviceSize Size, VkBufferUsageFlags Usage, 
-					std::shared_ptr<Buffer> ActualBuffer, const std::string& Name = "");
-
 	explicit Buffer(const Context& DeviceContext, VmaAllocator InAllocator, const VkBufferCreateInfo& CreateInfo, 
 					const VmaAllocationCreateInfo& AllocInfo, const std::string& Name = "");
 
@@ -28,17 +34,48 @@ public:
 
 	void Upload(VkDeviceSize Offset = 0) const;
 	void Upload(VkDeviceSize Offset, VkDeviceSize Size) const;
-	// Uploads staging buffer to the GPU
-	void UploadStagingBuffer(const VkCommandBuffer CmdBuffer, uint64_t SrcOffset = 0, uint64_t DstOffset = 0);
+	// Makes GPU writes to the range visible to mapped reads, does nothing on coherent memory
+	void Invalidate(VkDeviceSize Offset, VkDeviceSize Size) const;
 
+	// Writes Data to the start of the buffer and flushes only that range
 	void CopyToBuffer(const void* Data, size_t Size);
 
+	// Copies with non-temporal stores, which skip the cache and fill whole write-combining lines instead of reading them first.
+	// Only worth it for memory that is written but never read on the CPU, falls back to memcpy for small copies.
+	static void StreamCopy(void* Dst, const void* Src, size_t Size);
+
 	VkDeviceSize GetSize() const { return DeviceSize; }
 	VkBuffer GetVkBuffer() const {return VulkanBuffer; }
 	VkDeviceAddress GetDeviceAddress();
+	// Only valid for buffers created with VMA_ALLOCATION_CREATE_MAPPED_BIT or after CopyToBuffer has mapped them
+	void* GetMappedMemory() const { return AllocationInfo.pMappedData ? AllocationInfo.pMappedData : MappedMemory; }
 
 	VkBufferView RequestBufferView(VkFormat ViewFormat);
 
+	VmaAllocation GetAllocation() const { return Allocation; }
+	// False if the memory can't be mapped and the buffer has to be filled through a copy
+	bool IsHostVisible() const;
+	// Host visible but not cached, CPU reads are uncached and writes go through write-combining buffers
+	bool IsWriteCombined() const { return bWriteCombined; }
+
+	// Only GPU-only buffers without views that can be copied from and to can be moved by the defragmenter, the CPU could still be
+	// writing to mapped ones
+	bool CanRelocate() const;
+
+	// Creates a new VkBuffer in DstAllocation and records a copy of the contents into it. The buffer uses the new VkBuffer right away,
+	// the old one is returned and has to be destroyed once the GPU is done with it.
+	VkBuffer Relocate(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers, VmaAllocation DstAllocation);
+	// Called once the defragmentation pass ended and the buffer's allocation refers to the memory it was moved to
+	void RefreshAllocationInfo();
+
+	// Moves the buffer's memory to another category in the memory tracker. The category is guessed from the usage flags otherwise.
+	void SetMemoryCategory(MemoryCategory NewCategory);
+	MemoryCategory GetMemoryCategory() const { return Category; }
+
+private:
+	void TrackMemory(const Context& DeviceContext, MemoryCategory InCategory);
+	void* Map();
+
 private:
 	VkDevice VulkanDevice = VK_NULL_HANDLE;
 
@@ -51,13 +88,17 @@ private:
 	VkBufferUsageFlags UsageFlags;
 
 	VkBuffer VulkanBuffer = VK_NULL_HANDLE;
-	std::shared_ptr<Buffer> StagingBuffer = nullptr;
 
 	mutable VkDeviceAddress BufferDeviceAddress = 0;
 	mutable void* MappedMemory = nullptr;
 
 	std::unordered_map<VkFormat, VkBufferView> BufferViews;
 
+	bool bWriteCombined = false;
+
+	MemoryBudgetTracker* MemoryTracker = nullptr;
+	MemoryCategory Category = MemoryCategory::Other;
+
 	std::string DebugName;
 };
 
@@ -7,48 +7,23 @@ namespace VulkanCore
 	
 	CommandQueueManager::CommandQueueManager(const Context& DeviceContext, uint32_t Count, uint32_t NumConcurrentCommands, uint32_t QueueFamilyIdx, VkQueue Queue, 
 											 VkCommandPoolCreateFlags Flags, const std::string& Name)
-		: VulkanDevice{DeviceContext.GetDevice()}, CommandsInFlight{NumConcurrentCommands}, QueueFamilyIndex{QueueFamilyIdx}, VulkanQueue{Queue}
+		: CommandsInFlight{NumConcurrentCommands}, QueueFamilyIndex{QueueFamilyIdx}, InitialBuffersPerPool{std::max(Count, 1u)}, PoolFlags{Flags},
+		  VulkanQueue{Queue}, VulkanDevice{DeviceContext.GetDevice()}, SyncFences{DeviceContext.GetFencePool()}
 	{
 		Fences.reserve(CommandsInFlight);
 		IsSubmittedQueue.reserve(CommandsInFlight);
+		CommandPools.resize(CommandsInFlight);
 		BuffersToDispose.resize(CommandsInFlight);
 		Deallocators.resize(CommandsInFlight);
-
-		VkCommandPoolCreateInfo CmdPoolInfo{};
-		CmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		CmdPoolInfo.flags = Flags;
-		CmdPoolInfo.queueFamilyIndex = QueueFamilyIndex;
-		CmdPoolInfo.pNext = VK_NULL_HANDLE;
-
-		VK_CHECK(vkCreateCommandPool(VulkanDevice, &CmdPoolInfo, nullptr, &CommandPool));
-
-		VkCommandBufferAllocateInfo CmdBufferInfo{};
-		CmdBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		CmdBufferInfo.commandPool = CommandPool;
-		CmdBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		CmdBufferInfo.commandBufferCount = 1;
-		CmdBufferInfo.pNext = VK_NULL_HANDLE;
-
-		for(uint32_t Index = 0; Index < Count; Index++)
-		{
-			VkCommandBuffer CmdBuffer;
-			VK_CHECK(vkAllocateCommandBuffers(VulkanDevice, &CmdBufferInfo, &CmdBuffer));
-			CommandBuffers.push_back(CmdBuffer);
-		}
+		FenceSubmitIndices.resize(CommandsInFlight, 0);
 
 		for(uint32_t Index = 0; Index < CommandsInFlight; Index++)
 		{
-			VkFence Fence;
-
-			VkFenceCreateInfo FenceInfo{};
-			FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-			FenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-			FenceInfo.pNext = VK_NULL_HANDLE;
-
-			VK_CHECK(vkCreateFence(VulkanDevice, &FenceInfo, nullptr, &Fence));
-
-			Fences.push_back(std::move(Fence));
+			Fences.push_back(SyncFences->Acquire());
 			IsSubmittedQueue.push_back(false);
+
+			// The creating thread records most of the work, its pools are created up front so the first frames don't
+			GetThreadPool(Index);
 		}
 
 		DebugName = "Command Queue Manager: " + Name;
@@ -56,64 +31,51 @@ namespace VulkanCore
 
 	CommandQueueManager::~CommandQueueManager()
 	{
-		for(uint32_t Index = 0; Index < CommandsInFlight; Index++)
+		if(VulkanDevice == VK_NULL_HANDLE)
 		{
-			vkDestroyFence(VulkanDevice, Fences[Index], nullptr);
+			return;
 		}
 
-		for(size_t Index = 0; Index < CommandBuffers.size(); Index++)
+		WaitForAllSubmissions();
+
+		for(VkFence Fence : Fences)
 		{
-			vkFreeCommandBuffers(VulkanDevice, CommandPool, 1, &CommandBuffers[Index]);
+			SyncFences->Release(Fence);
 		}
 
-		vkDestroyCommandPool(VulkanDevice, CommandPool, nullptr);
+		// Destroying a pool frees every buffer allocated from it
+		for(const std::vector<ThreadCommandPool>& SlotPools : CommandPools)
+		{
+			for(const ThreadCommandPool& ThreadPool : SlotPools)
+			{
+				vkDestroyCommandPool(VulkanDevice, ThreadPool.Pool, nullptr);
+			}
+		}
 	}
 
 	void CommandQueueManager::Submit(const VkSubmitInfo* SubmitInfo)
 	{
-		VK_CHECK(vkResetFences(VulkanDevice, 1, &Fences[CurrentFenceIndex]));
 		VK_CHECK(vkQueueSubmit(VulkanQueue, 1, SubmitInfo, Fences[CurrentFenceIndex]));
 		IsSubmittedQueue[CurrentFenceIndex] = true;
+		FenceSubmitIndices[CurrentFenceIndex] = ++SubmitCounter;
 	}
 
 	void CommandQueueManager::ToNextCmdBuffer()
 	{
-		CurrentCommandBufferIndex = (CurrentCommandBufferIndex + 1) % static_cast<uint32_t>(CommandBuffers.size());
 		CurrentFenceIndex = (CurrentFenceIndex + 1) % CommandsInFlight;
 	}
 
 	void CommandQueueManager::WaitForSubmit()
 	{
-		if(!IsSubmittedQueue[CurrentFenceIndex])
-		{
-			return;
-		}
-
-		const VkResult Result = vkWaitForFences(VulkanDevice, 1, &Fences[CurrentFenceIndex], true, UINT32_MAX);
-		if(Result == VK_TIMEOUT)
-		{
-			BE_ERROR("Wait for fences timeout!");
-			vkDeviceWaitIdle(VulkanDevice);
-		}
-
-		IsSubmittedQueue[CurrentFenceIndex] = false;
-		BuffersToDispose[CurrentFenceIndex].clear();
-		
-		DeallocateResources();
+		WaitForFence(CurrentFenceIndex);
 	}
 
 	void CommandQueueManager::WaitForAllSubmissions()
 	{
-		uint32_t Index = 0;
-		for(VkFence Fence : Fences)
+		for(uint32_t Index = 0; Index < CommandsInFlight; Index++)
 		{
-			VK_CHECK(vkWaitForFences(VulkanDevice, 1, &Fence, true, UINT32_MAX));
-			VK_CHECK(vkResetFences(VulkanDevice, 1, &Fence));
-			IsSubmittedQueue[Index++] = false;
+			WaitForFence(Index);
 		}
-
-		BuffersToDispose.clear();
-		DeallocateResources();
 	}
 
 	void CommandQueueManager::DisposeOnSubmitCompletion(std::shared_ptr<Buffer> DisposeBuffer)
@@ -128,10 +90,10 @@ namespace VulkanCore
 
 	VkCommandBuffer CommandQueueManager::BeginCmdBuffer()
 	{
-		VkFence* Fence = &Fences[CurrentFenceIndex];
+		WaitForFence(CurrentFenceIndex);
+		ResetCommandPools(CurrentFenceIndex);
 
-		VK_CHECK(vkWaitForFences(VulkanDevice, 1, Fence, true, UINT32_MAX));
-		VK_CHECK(vkResetCommandBuffer(CommandBuffers[CurrentCommandBufferIndex], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT));
+		VkCommandBuffer CmdBuffer = AcquireCmdBuffer(CurrentFenceIndex);
 
 		VkCommandBufferBeginInfo BeginInfo{};
 		BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -139,9 +101,9 @@ namespace VulkanCore
 		BeginInfo.pNext = VK_NULL_HANDLE;
 		BeginInfo.pInheritanceInfo = VK_NULL_HANDLE;
 
-		VK_CHECK(vkBeginCommandBuffer(CommandBuffers[CurrentCommandBufferIndex], &BeginInfo));
+		VK_CHECK(vkBeginCommandBuffer(CmdBuffer, &BeginInfo));
 
-		return CommandBuffers[CurrentCommandBufferIndex];
+		return CmdBuffer;
 	}
 
 	void CommandQueueManager::EndCmdBuffer(VkCommandBuffer CmdBuffer)
@@ -151,9 +113,71 @@ namespace VulkanCore
 
 	VkCommandBuffer CommandQueueManager::GetNewCmdBuffer()
 	{
+		return AcquireCmdBuffer(CurrentFenceIndex);
+	}
+
+	uint64_t CommandQueueManager::GetCompletedSubmitIndex()
+	{
+		uint64_t OldestPendingSubmit = SubmitCounter + 1;
+		for(uint32_t Index = 0; Index < CommandsInFlight; Index++)
+		{
+			if(!IsSubmittedQueue[Index] || FenceSubmitIndices[Index] >= OldestPendingSubmit)
+			{
+				continue;
+			}
+
+			const VkResult Result = vkGetFenceStatus(VulkanDevice, Fences[Index]);
+			if(Result == VK_SUCCESS)
+			{
+				continue;
+			}
+
+			// Anything but VK_NOT_READY means the device was lost, the submit never finishes and its resources must not be reused
+			if(Result != VK_NOT_READY)
+			{
+				BE_ERROR("{0}: failed to get the status of submit {1}: {2}", DebugName, FenceSubmitIndices[Index], string_VkResult(Result));
+			}
+
+			OldestPendingSubmit = FenceSubmitIndices[Index];
+		}
+
+		CompletedSubmitIndex = std::max(CompletedSubmitIndex, OldestPendingSubmit - 1);
+		return CompletedSubmitIndex;
+	}
+
+	uint32_t CommandQueueManager::GetCommandPoolCount() const
+	{
+		std::unique_lock<std::mutex> MutexLock(PoolMutex);
+
+		uint32_t NumPools = 0;
+		for(const std::vector<ThreadCommandPool>& SlotPools : CommandPools)
+		{
+			NumPools += static_cast<uint32_t>(SlotPools.size());
+		}
+
+		return NumPools;
+	}
+
+	uint32_t CommandQueueManager::GetCommandBufferCount() const
+	{
+		std::unique_lock<std::mutex> MutexLock(PoolMutex);
+		return NumCommandBuffers;
+	}
+
+	VkCommandBuffer CommandQueueManager::AcquireCmdBuffer(uint32_t FenceIndex)
+	{
+		std::unique_lock<std::mutex> MutexLock(PoolMutex);
+
+		ThreadCommandPool& ThreadPool = GetThreadPool(FenceIndex);
+		if(ThreadPool.NumUsed < ThreadPool.CommandBuffers.size())
+		{
+			return ThreadPool.CommandBuffers[ThreadPool.NumUsed++];
+		}
+
+		// Only happens while a thread is recording more buffers per frame than it ever has before
 		VkCommandBufferAllocateInfo AllocInfo{};
 		AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		AllocInfo.commandPool = CommandPool;
+		AllocInfo.commandPool = ThreadPool.Pool;
 		AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 		AllocInfo.commandBufferCount = 1;
 		AllocInfo.pNext = VK_NULL_HANDLE;
@@ -161,18 +185,94 @@ namespace VulkanCore
 		VkCommandBuffer CmdBuffer{VK_NULL_HANDLE};
 		VK_CHECK(vkAllocateCommandBuffers(VulkanDevice, &AllocInfo, &CmdBuffer));
 
+		ThreadPool.CommandBuffers.push_back(CmdBuffer);
+		ThreadPool.NumUsed++;
+		NumCommandBuffers++;
+
 		return CmdBuffer;
 	}
 
-	void CommandQueueManager::DeallocateResources()
+	CommandQueueManager::ThreadCommandPool& CommandQueueManager::GetThreadPool(uint32_t FenceIndex)
 	{
-		for(auto& DeallocatorList : Deallocators)
+		// A handful of recording threads at most, a linear search is faster than hashing the thread id
+		const std::thread::id ThreadID = std::this_thread::get_id();
+		for(ThreadCommandPool& ThreadPool : CommandPools[FenceIndex])
 		{
-			for(auto& Deallocator : DeallocatorList)
+			if(ThreadPool.ThreadID == ThreadID)
 			{
-				Deallocator();
+				return ThreadPool;
 			}
 		}
+
+		ThreadCommandPool& NewPool = CommandPools[FenceIndex].emplace_back();
+		NewPool.ThreadID = ThreadID;
+
+		VkCommandPoolCreateInfo CmdPoolInfo{};
+		CmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		CmdPoolInfo.flags = PoolFlags;
+		CmdPoolInfo.queueFamilyIndex = QueueFamilyIndex;
+		CmdPoolInfo.pNext = VK_NULL_HANDLE;
+
+		VK_CHECK(vkCreateCommandPool(VulkanDevice, &CmdPoolInfo, nullptr, &NewPool.Pool));
+
+		VkCommandBufferAllocateInfo CmdBufferInfo{};
+		CmdBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		CmdBufferInfo.commandPool = NewPool.Pool;
+		CmdBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		CmdBufferInfo.commandBufferCount = InitialBuffersPerPool;
+		CmdBufferInfo.pNext = VK_NULL_HANDLE;
+
+		NewPool.CommandBuffers.resize(InitialBuffersPerPool);
+		VK_CHECK(vkAllocateCommandBuffers(VulkanDevice, &CmdBufferInfo, NewPool.CommandBuffers.data()));
+		NumCommandBuffers += InitialBuffersPerPool;
+
+		return NewPool;
+	}
+
+	void CommandQueueManager::ResetCommandPools(uint32_t FenceIndex)
+	{
+		std::unique_lock<std::mutex> MutexLock(PoolMutex);
+
+		// One call per pool puts every buffer recorded into it back into the initial state and keeps their memory for the next frame
+		for(ThreadCommandPool& ThreadPool : CommandPools[FenceIndex])
+		{
+			if(ThreadPool.NumUsed > 0)
+			{
+				VK_CHECK(vkResetCommandPool(VulkanDevice, ThreadPool.Pool, 0));
+				ThreadPool.NumUsed = 0;
+			}
+		}
+	}
+
+	void CommandQueueManager::WaitForFence(uint32_t FenceIndex)
+	{
+		if(!IsSubmittedQueue[FenceIndex])
+		{
+			return;
+		}
+
+		const VkResult Result = vkWaitForFences(VulkanDevice, 1, &Fences[FenceIndex], true, UINT32_MAX);
+		if(Result == VK_TIMEOUT)
+		{
+			BE_ERROR("{0}: wait for fences timeout!", DebugName);
+			vkDeviceWaitIdle(VulkanDevice);
+		}
+
+		VK_CHECK(vkResetFences(VulkanDevice, 1, &Fences[FenceIndex]));
+		IsSubmittedQueue[FenceIndex] = false;
+
+		BuffersToDispose[FenceIndex].clear();
+		DeallocateResources(FenceIndex);
+	}
+
+	void CommandQueueManager::DeallocateResources(uint32_t FenceIndex)
+	{
+		for(auto& Deallocator : Deallocators[FenceIndex])
+		{
+			Deallocator();
+		}
+
+		Deallocators[FenceIndex].clear();
 	}
 
 }
\ No newline at end of file
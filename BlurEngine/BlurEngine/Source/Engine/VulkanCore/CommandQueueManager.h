@@ -4,16 +4,25 @@
 #include "Utility.h"
 #include "Buffer.h"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 namespace VulkanCore
 {
 class Context;
+class FencePool;
 
+// Every in-flight submit slot owns one command pool per recording thread. Command buffers are handed out from the slot's pools
+// and all of them are recycled at once with vkResetCommandPool when the slot's fence is waited on, so after the first few frames
+// no command buffers, pools or fences are created anymore.
 class CommandQueueManager final
 {
 public:
 	CommandQueueManager(){}
+	// Count command buffers are allocated up front in each pool, NumConcurrentCommands is the number of submit slots in flight
 	explicit CommandQueueManager(const Context& DeviceContext, uint32_t Count, uint32_t NumConcurrentCommands, uint32_t QueueFamilyIdx,
-								 VkQueue Queue, VkCommandPoolCreateFlags Flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, const std::string& Name = "");
+								 VkQueue Queue, VkCommandPoolCreateFlags Flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, const std::string& Name = "");
 	~CommandQueueManager();
 
 	void Submit(const VkSubmitInfo* SubmitInfo);
@@ -26,28 +35,65 @@ public:
 	void DisposeOnSubmitCompletion(std::shared_ptr<Buffer> DisposeBuffer);
 	void DisposeOnSubmitCompletion(std::function<void()>&& Deallocator);
 
+	// Waits for the current slot's previous submit, resets its command pools and begins a buffer from the calling thread's pool
 	VkCommandBuffer BeginCmdBuffer();
 	void EndCmdBuffer(VkCommandBuffer CmdBuffer);
 
+	// Another buffer for the current slot from the calling thread's pool, safe to call from any thread. It has to be submitted
+	// before ToNextCmdBuffer, it is reset together with the rest of the slot.
 	VkCommandBuffer GetNewCmdBuffer();
 
+	// Every submit gets an increasing index, work recorded now will be part of the next one
+	uint64_t GetNextSubmitIndex() const { return SubmitCounter + 1; }
+	// Polls the fences without waiting, every submit up to and including the returned index has finished on the GPU.
+	// A lost device is reported and its submits are never counted as finished.
+	uint64_t GetCompletedSubmitIndex();
+
+	// Objects created over the manager's lifetime, both stay flat once every thread has recorded into every slot
+	uint32_t GetCommandPoolCount() const;
+	uint32_t GetCommandBufferCount() const;
+
 private:
-	void DeallocateResources();
+	struct ThreadCommandPool
+	{
+		std::thread::id ThreadID;
+		VkCommandPool Pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> CommandBuffers;
+		// Buffers [0, NumUsed) were handed out since the pool was last reset
+		uint32_t NumUsed = 0;
+	};
+
+	VkCommandBuffer AcquireCmdBuffer(uint32_t FenceIndex);
+	ThreadCommandPool& GetThreadPool(uint32_t FenceIndex);
+	void ResetCommandPools(uint32_t FenceIndex);
+
+	void WaitForFence(uint32_t FenceIndex);
+	void DeallocateResources(uint32_t FenceIndex);
 
 private:
 	uint32_t CommandsInFlight = 2;
 	uint32_t QueueFamilyIndex = 0;
+	uint32_t InitialBuffersPerPool = 1;
+	VkCommandPoolCreateFlags PoolFlags = 0;
 
 	VkQueue VulkanQueue = VK_NULL_HANDLE;
 	VkDevice VulkanDevice = VK_NULL_HANDLE;
+	FencePool* SyncFences = nullptr;
 
-	VkCommandPool CommandPool = VK_NULL_HANDLE;
-	std::vector<VkCommandBuffer> CommandBuffers;
+	// Slot index to the command pools of every thread that recorded into that slot
+	std::vector<std::vector<ThreadCommandPool>> CommandPools;
+	uint32_t NumCommandBuffers = 0;
+	mutable std::mutex PoolMutex;
 
+	// A fence is only signaled between its submit completing and the wait that resets it
 	std::vector<VkFence> Fences;
 	std::vector<bool> IsSubmittedQueue;
-	uint32_t CurrentFenceIndex = 0;
-	uint32_t CurrentCommandBufferIndex = 0;
+	// Only advanced by the render thread, atomic because GetNewCmdBuffer reads it from worker threads
+	std::atomic<uint32_t> CurrentFenceIndex = 0;
+
+	uint64_t SubmitCounter = 0;
+	uint64_t CompletedSubmitIndex = 0;
+	std::vector<uint64_t> FenceSubmitIndices;
 
 	// FenceIndex to list of buffers associated with that fence that need to be released
 	std::vector<std::vector<std::shared_ptr<Buffer>>> BuffersToDispose;
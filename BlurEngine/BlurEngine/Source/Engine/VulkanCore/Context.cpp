@@ -58,6 +58,7 @@ namespace VulkanCore
 #pragma endregion
 
 PhysicalDeviceFeatures Context::sPhysicalDeviceFeatures = PhysicalDeviceFeatures();
+std::filesystem::path Context::sPipelineCachePath;
 
 Context::Context(std::shared_ptr<Window> ContextWindow, VkQueueFlags RequestedQueueTypes)
 	:ActiveWindow{ContextWindow}
@@ -81,13 +82,34 @@ Context::Context(std::shared_ptr<Window> ContextWindow, VkQueueFlags RequestedQu
 	CreateLogicalDevice();
 
 	CreateMemoryAllocatior();
+
+	Fences = std::make_unique<FencePool>(*this, "Global");
+	Semaphores = std::make_unique<SemaphorePool>(*this, "Global");
+
+	Descriptors = std::make_unique<DescriptorAllocator>(*this, "Global");
+
+	SharedPipelineCache = std::make_unique<PipelineCache>(*this, sPipelineCachePath, "Global");
+
+	GlobalSamplerCache = std::make_unique<SamplerCache>(*this, sSamplerTableSize, "Global");
 }
 
 Context::~Context()
 {
+	GlobalSamplerCache.reset();
+
+	MemoryTracker.reset();
 	vmaDestroyAllocator(Allocator);
 
 	SwapChain.reset(); // Make sure swapchain is destroyed before destroying the VkDevice
+
+	// After the swapchain, which hands its fence and semaphores back on destruction
+	Semaphores.reset();
+	Fences.reset();
+
+	Descriptors.reset();
+
+	// Saves the cache one last time, every pipeline has been destroyed by now
+	SharedPipelineCache.reset();
 	
 	vkDestroyDevice(Device, nullptr);
 
@@ -201,7 +223,7 @@ std::unique_ptr<VulkanCore::CommandQueueManager> Context::CreateGraphicsCommandQ
 	const uint32_t FamilyIndex = GPUDevice.GetGraphicsFamilyIndex().value();
 	VkQueue GraphicsQueue = GraphicsQueueIndex != -1 ? GraphicsQueues[GraphicsQueueIndex] : GraphicsQueues[0];
 
-	return std::make_unique<CommandQueueManager>(*this, Count, NumConcurrentCommands, FamilyIndex, GraphicsQueue, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, Name);
+	return std::make_unique<CommandQueueManager>(*this, Count, NumConcurrentCommands, FamilyIndex, GraphicsQueue, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, Name);
 }
 
 VulkanCore::CommandQueueManager Context::CreateTransferCommandQueue(uint32_t Count, uint32_t NumConcurrentCommands, int TransferQueueIndex, const std::string Name)
@@ -214,7 +236,7 @@ VulkanCore::CommandQueueManager Context::CreateTransferCommandQueue(uint32_t Cou
 	const uint32_t FamilyIndex = GPUDevice.GetTransferFamilyIndex().value();
 	VkQueue TransferQueue = TransferQueueIndex != -1 ? TransferQueues[TransferQueueIndex] : TransferQueues[0];
 
-	return CommandQueueManager(*this, Count, NumConcurrentCommands, FamilyIndex, TransferQueue, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, Name);
+	return CommandQueueManager(*this, Count, NumConcurrentCommands, FamilyIndex, TransferQueue, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, Name);
 }
 
 std::unique_ptr<VulkanCore::Framebuffer> Context::CreateFramebuffer(VkRenderPass Pass, const FramebufferCreateInfo& CreateInfo)
@@ -227,10 +249,8 @@ std::shared_ptr<VulkanCore::Texture> Context::CreateTexture(const TextureCreateI
 	return std::make_shared<Texture>(*this, CreateInfo);
 }
 
-std::shared_ptr<VulkanCore::Buffer> Context::CreatePersistentBuffer(size_t Size, VkBufferUsageFlags Flags, const std::string& Name) const
+std::shared_ptr<VulkanCore::Buffer> Context::CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Flags, MemoryUsagePolicy Policy, const std::string& Name) const
 {
-	const VkMemoryPropertyFlags MemoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-											  VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
 	VkBufferCreateInfo BufferInfo{};
 	BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	BufferInfo.size = Size;
@@ -238,14 +258,22 @@ std::shared_ptr<VulkanCore::Buffer> Context::CreatePersistentBuffer(size_t Size,
 	BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	BufferInfo.pNext = VK_NULL_HANDLE;
 
-	VmaAllocationCreateInfo AllocInfo{};
-	AllocInfo.flags = 0;
-	AllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-	AllocInfo.requiredFlags = MemoryFlags;
-	
+	// These are filled through copies, UploadOnce whenever it didn't land in host visible memory
+	if(Policy == MemoryUsagePolicy::GPUOnly || Policy == MemoryUsagePolicy::UploadOnce || Policy == MemoryUsagePolicy::Readback)
+	{
+		BufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	}
+
+	const VmaAllocationCreateInfo AllocInfo = Placement.GetAllocationInfo(Policy, Size);
+
 	return std::make_shared<Buffer>(*this, GetAllocator(), BufferInfo, AllocInfo, Name);
 }
 
+std::shared_ptr<VulkanCore::Buffer> Context::CreatePersistentBuffer(size_t Size, VkBufferUsageFlags Flags, const std::string& Name) const
+{
+	return CreateBuffer(Size, Flags, MemoryUsagePolicy::PerFrameDynamic, Name);
+}
+
 void Context::RecreateSwapchain(const VkExtent2D& NewExtent)
 {
 	ASSERT(Surface != VK_NULL_HANDLE, "Trying to recreate swapchain without a valid surface!");
@@ -300,6 +328,19 @@ void Context::EnableDynamicStateFeature()
 	sPhysicalDeviceFeatures.ExtendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
 }
 
+void Context::SetPipelineCachePath(const std::filesystem::path& Filepath)
+{
+	sPipelineCachePath = Filepath;
+}
+
+void Context::EnableDescriptorBufferFeature()
+{
+	sPhysicalDeviceFeatures.DescriptorBufferFeatures.descriptorBuffer = VK_TRUE;
+
+	// Buffer descriptors are written from device addresses
+	sPhysicalDeviceFeatures.Vulkan12Features.bufferDeviceAddress = VK_TRUE;
+}
+
 void Context::CreateInstance()
 {
 	if(!bEnableValidationLayers && IsValidationLayersSupported())
@@ -415,13 +456,22 @@ void Context::CreateLogicalDevice()
 		FeatureChain.PushBack(sPhysicalDeviceFeatures.FragmentDensityMapFeatures);
 	}
 
+	std::vector<const char*> EnabledExtensions = DeviceExtensions;
+
+	bDescriptorBufferEnabled = sPhysicalDeviceFeatures.DescriptorBufferFeatures.descriptorBuffer == VK_TRUE && GPUDevice.IsDescriptorBufferSupported();
+	if(bDescriptorBufferEnabled)
+	{
+		FeatureChain.PushBack(sPhysicalDeviceFeatures.DescriptorBufferFeatures);
+		EnabledExtensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+	}
+
 	VkDeviceCreateInfo DeviceCreateInfo{};
 	DeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	DeviceCreateInfo.pNext = FeatureChain.FirsNextPtr();
 	DeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(QueueCreateInfos.size());
 	DeviceCreateInfo.pQueueCreateInfos = QueueCreateInfos.data();
-	DeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(DeviceExtensions.size());
-	DeviceCreateInfo.ppEnabledExtensionNames = DeviceExtensions.data();
+	DeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(EnabledExtensions.size());
+	DeviceCreateInfo.ppEnabledExtensionNames = EnabledExtensions.data();
 
 	if(EnableValidationLayers)
 	{
@@ -431,6 +481,12 @@ void Context::CreateLogicalDevice()
 
 	VK_CHECK(vkCreateDevice(GPUDevice.GetVkPhysicalDevice(), &DeviceCreateInfo, nullptr, &Device));
 
+	if(bDescriptorBufferEnabled && !DescBufferFunctions.Load(Device))
+	{
+		BE_WARN("VK_EXT_descriptor_buffer functions couldn't be loaded, falling back to descriptor sets");
+		bDescriptorBufferEnabled = false;
+	}
+
 	ResizeQueues();
 }
 
@@ -706,12 +762,17 @@ void Context::CreateMemoryAllocatior()
 #if defined(VK_KHR_buffer_device_address) && defined(_WIN32)
 	AllocInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
 #endif
+	// VK_EXT_memory_budget is always in DeviceExtensions, this makes VMA report the driver's budget instead of an estimate
+	AllocInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
 	AllocInfo.physicalDevice = GPUDevice.GetVkPhysicalDevice();
 	AllocInfo.device = Device;
 	AllocInfo.instance = Instance;
 	AllocInfo.vulkanApiVersion = ApplicationInfo.apiVersion;
 
 	VK_CHECK(vmaCreateAllocator(&AllocInfo, &Allocator));
+
+	MemoryTracker = std::make_unique<MemoryBudgetTracker>(Allocator);
+	Placement = MemoryPlacement(Allocator);
 }
 
 }
\ No newline at end of file
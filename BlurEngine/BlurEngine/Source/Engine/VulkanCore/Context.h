@@ -9,6 +9,13 @@
 #include "CommandQueueManager.h"
 #include "Framebuffer.h"
 #include "Texture.h"
+#include "SamplerCache.h"
+#include "SyncObjectPool.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorBuffer.h"
+#include "PipelineCache.h"
+#include "MemoryBudgetTracker.h"
+#include "MemoryPlacement.h"
 
 #include "../Core/Window.h"
 
@@ -16,6 +23,7 @@
 
 #include <memory>
 #include <any>
+#include <filesystem>
 
 namespace VulkanCore
 {
@@ -95,6 +103,8 @@ struct PhysicalDeviceFeatures
 		FragmentDensityMapOffsetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_OFFSET_FEATURES_QCOM;
 
 		ExtendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+
+		DescriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
 	}
 
 	VkPhysicalDeviceFeatures DeviceFeatures;
@@ -102,6 +112,7 @@ struct PhysicalDeviceFeatures
 	VkPhysicalDeviceVulkan12Features Vulkan12Features{};
 	VkPhysicalDeviceVulkan13Features Vulkan13Features{};
 	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT ExtendedDynamicStateFeatures{};
+	VkPhysicalDeviceDescriptorBufferFeaturesEXT DescriptorBufferFeatures{};
 
 	// Ray tracing features
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR AccelStructFeatures{};
@@ -125,6 +136,10 @@ public:
 	VkDevice GetDevice() const { return Device; }
 
 	inline VmaAllocator GetAllocator() const { return Allocator; }
+	MemoryBudgetTracker* GetMemoryTracker() const { return MemoryTracker.get(); }
+	const MemoryPlacement& GetMemoryPlacement() const { return Placement; }
+
+	const PhysicalDevice& GetPhysicalDevice() const { return GPUDevice; }
 
 	SwapChainSupportDetails GetSupportDetails();
 	VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& AvailableFormats);
@@ -151,8 +166,27 @@ public:
 
 	std::shared_ptr<Texture> CreateTexture(const TextureCreateInfo& CreateInfo);
 
+	// Memory is picked by the placement policy, every policy except GPUOnly returns a persistently mapped buffer
+	std::shared_ptr<Buffer> CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Flags, MemoryUsagePolicy Policy, const std::string& Name = "") const;
+	// Per-frame dynamic buffer
 	std::shared_ptr<Buffer> CreatePersistentBuffer(size_t Size, VkBufferUsageFlags Flags, const std::string& Name = "") const;
 
+	SamplerCache* GetSamplerCache() const { return GlobalSamplerCache.get(); }
+
+	// Every fence and semaphore comes from these, so swapchain recreation and new queues reuse released objects
+	FencePool* GetFencePool() const { return Fences.get(); }
+	SemaphorePool* GetSemaphorePool() const { return Semaphores.get(); }
+
+	// Set layouts and descriptor pools of every pipeline
+	DescriptorAllocator* GetDescriptorAllocator() const { return Descriptors.get(); }
+
+	// Only true if the feature was requested and the device supports it, pipelines fall back to descriptor sets otherwise
+	bool IsDescriptorBufferEnabled() const { return bDescriptorBufferEnabled; }
+	const DescriptorBufferFunctions& GetDescriptorBufferFunctions() const { return DescBufferFunctions; }
+
+	// Every pipeline is created with it, Update has to be called once per frame so it is saved periodically
+	PipelineCache* GetPipelineCache() const { return SharedPipelineCache.get(); }
+
 	void RecreateSwapchain(const VkExtent2D& NewExtent);
 	
 	static void EndableDefaultFeatures();
@@ -161,6 +195,11 @@ public:
 	static void EnableBufferDeviceAddressFeature();
 	static void EnableDynamicRenderingFeature();
 	static void EnableDynamicStateFeature();
+	// Optional, ignored on devices without VK_EXT_descriptor_buffer
+	static void EnableDescriptorBufferFeature();
+
+	// Has to be set before the context is created, the pipeline cache is only kept in memory without a path
+	static void SetPipelineCachePath(const std::filesystem::path& Filepath);
 
 private:
 	void CreateInstance();
@@ -186,6 +225,8 @@ private:
 	void CreateMemoryAllocatior();
 
 public:
+	static constexpr uint32_t sSamplerTableSize = 1000;
+
 #ifdef _DEBUG
 	const bool EnableValidationLayers = true;
 #else
@@ -194,6 +235,7 @@ public:
 
 private:
 	static PhysicalDeviceFeatures sPhysicalDeviceFeatures;
+	static std::filesystem::path sPipelineCachePath;
 	PhysicalDevice GPUDevice;
 
 	VkInstance Instance;
@@ -203,6 +245,20 @@ private:
 	VkApplicationInfo ApplicationInfo;
 
 	VmaAllocator Allocator;
+	std::unique_ptr<MemoryBudgetTracker> MemoryTracker;
+	MemoryPlacement Placement;
+
+	std::unique_ptr<SamplerCache> GlobalSamplerCache;
+
+	std::unique_ptr<FencePool> Fences;
+	std::unique_ptr<SemaphorePool> Semaphores;
+
+	std::unique_ptr<DescriptorAllocator> Descriptors;
+
+	bool bDescriptorBufferEnabled = false;
+	DescriptorBufferFunctions DescBufferFunctions;
+
+	std::unique_ptr<PipelineCache> SharedPipelineCache;
 
 	VkQueueFlags RequestedQueues;
 
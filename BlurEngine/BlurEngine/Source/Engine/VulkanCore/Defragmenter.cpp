@@ -0,0 +1,251 @@
+#include "Defragmenter.h"
+#include "Context.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "BarrierBuilder.h"
+
+#include <tuple>
+
+namespace VulkanCore
+{
+
+	Defragmenter::Defragmenter(const Context& InContext, uint32_t InFramesInFlight, const DefragmentationBudget& InBudget, const std::string& Name)
+		: Device{InContext.GetDevice()}, Allocator{InContext.GetAllocator()}, Budget{InBudget}, FramesInFlight{InFramesInFlight}, DebugName{"Defragmenter: " + Name}
+	{
+	}
+
+	Defragmenter::~Defragmenter()
+	{
+		// The GPU has to be idle by now, so a pass that is still waiting on it can be ended right away
+		if(bPassInProgress)
+		{
+			EndPass();
+		}
+
+		if(DefragContext != VK_NULL_HANDLE)
+		{
+			vmaEndDefragmentation(Allocator, DefragContext, nullptr);
+		}
+	}
+
+	void Defragmenter::Register(std::shared_ptr<Buffer> InBuffer)
+	{
+		ASSERT(InBuffer, "Trying to register a null buffer for defragmentation!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		Resources[InBuffer->GetAllocation()] = RegisteredResource{InBuffer, {}};
+	}
+
+	void Defragmenter::Register(std::shared_ptr<Texture> InTexture)
+	{
+		ASSERT(InTexture, "Trying to register a null texture for defragmentation!");
+
+		if(InTexture->GetAllocation() == nullptr)
+		{
+			BE_WARN("{0}: texture doesn't own its memory and can't be defragmented", DebugName);
+			return;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		Resources[InTexture->GetAllocation()] = RegisteredResource{{}, InTexture};
+	}
+
+	void Defragmenter::Unregister(VmaAllocation Allocation)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		Resources.erase(Allocation);
+	}
+
+	void Defragmenter::AddRelocationCallback(RelocationCallback Callback)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		RelocationCallbacks.push_back(std::move(Callback));
+	}
+
+	void Defragmenter::Start()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(DefragContext != VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		VmaDefragmentationInfo DefragInfo{};
+		DefragInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+		DefragInfo.pool = VK_NULL_HANDLE;
+		DefragInfo.maxBytesPerPass = Budget.MaxBytesPerPass;
+		DefragInfo.maxAllocationsPerPass = Budget.MaxAllocationsPerPass;
+
+		VK_CHECK(vmaBeginDefragmentation(Allocator, &DefragInfo, &DefragContext));
+
+#if _DEBUG
+		BE_INFO("{0}: started defragmenting", DebugName);
+#endif
+	}
+
+	void Defragmenter::Update(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers)
+	{
+		std::vector<RelocationEvent> Events;
+		std::vector<RelocationCallback> Callbacks;
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+
+			CurrentFrame++;
+
+			if(DefragContext == VK_NULL_HANDLE)
+			{
+				return;
+			}
+
+			// Only one pass is in flight at a time, the next one starts once the GPU is done with the last one
+			if(bPassInProgress)
+			{
+				if(PassFrame + FramesInFlight <= CurrentFrame)
+				{
+					EndPass();
+				}
+
+				return;
+			}
+
+			BeginPass(CmdBuffer, Barriers);
+
+			for(const RetiredResource& Retired : RetiredResources)
+			{
+				Events.push_back({Retired.MovedBuffer, Retired.MovedTexture});
+			}
+
+			Callbacks = RelocationCallbacks;
+		}
+
+		// Called without the lock so callbacks can register or unregister resources
+		for(const RelocationEvent& Event : Events)
+		{
+			for(const RelocationCallback& Callback : Callbacks)
+			{
+				Callback(Event);
+			}
+		}
+	}
+
+	void Defragmenter::BeginPass(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers)
+	{
+		const VkResult Result = vmaBeginDefragmentationPass(Allocator, DefragContext, &PassInfo);
+		if(Result == VK_SUCCESS)
+		{
+			// Nothing left to move
+			Finish();
+			return;
+		}
+
+		ASSERT(Result == VK_INCOMPLETE, "Unexpected result when beginning a defragmentation pass!");
+
+		for(uint32_t MoveIndex = 0; MoveIndex < PassInfo.moveCount; MoveIndex++)
+		{
+			VmaDefragmentationMove& Move = PassInfo.pMoves[MoveIndex];
+
+			auto Itr = Resources.find(Move.srcAllocation);
+			if(Itr == Resources.end())
+			{
+				// Not registered, whoever owns it doesn't expect it to move
+				Move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			RetiredResource Retired;
+			Retired.MovedBuffer = Itr->second.WeakBuffer.lock();
+			Retired.MovedTexture = Itr->second.WeakTexture.lock();
+
+			if(Retired.MovedBuffer && Retired.MovedBuffer->CanRelocate())
+			{
+				Retired.OldBuffer = Retired.MovedBuffer->Relocate(CmdBuffer, Barriers, Move.dstTmpAllocation);
+			}
+			else if(Retired.MovedTexture && Retired.MovedTexture->CanRelocate())
+			{
+				std::tie(Retired.OldImage, Retired.OldImageView) = Retired.MovedTexture->Relocate(CmdBuffer, Barriers, Move.dstTmpAllocation);
+			}
+			else
+			{
+				if(!Retired.MovedBuffer && !Retired.MovedTexture)
+				{
+					// The resource is gone, its allocation handle might get reused by something unregistered
+					Resources.erase(Itr);
+				}
+
+				Move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			RetiredResources.push_back(std::move(Retired));
+		}
+
+		bPassInProgress = true;
+		PassFrame = CurrentFrame;
+
+		// Nothing was copied, so there is nothing for the GPU to finish either
+		if(RetiredResources.empty())
+		{
+			EndPass();
+		}
+	}
+
+	void Defragmenter::EndPass()
+	{
+		std::vector<std::shared_ptr<Buffer>> MovedBuffers;
+
+		// The old handles are bound to memory VMA is about to free
+		for(const RetiredResource& Retired : RetiredResources)
+		{
+			if(Retired.MovedBuffer)
+			{
+				MovedBuffers.push_back(Retired.MovedBuffer);
+			}
+
+			if(Retired.OldBuffer != VK_NULL_HANDLE)
+			{
+				vkDestroyBuffer(Device, Retired.OldBuffer, nullptr);
+			}
+
+			if(Retired.OldImageView != VK_NULL_HANDLE)
+			{
+				vkDestroyImageView(Device, Retired.OldImageView, nullptr);
+			}
+
+			if(Retired.OldImage != VK_NULL_HANDLE)
+			{
+				vkDestroyImage(Device, Retired.OldImage, nullptr);
+			}
+		}
+
+		RetiredResources.clear();
+		bPassInProgress = false;
+
+		const VkResult Result = vmaEndDefragmentationPass(Allocator, DefragContext, &PassInfo);
+
+		// Their allocations were swapped over to the new memory by ending the pass
+		for(const std::shared_ptr<Buffer>& MovedBuffer : MovedBuffers)
+		{
+			MovedBuffer->RefreshAllocationInfo();
+		}
+
+		if(Result == VK_SUCCESS)
+		{
+			Finish();
+		}
+	}
+
+	void Defragmenter::Finish()
+	{
+		VmaDefragmentationStats Stats{};
+		vmaEndDefragmentation(Allocator, DefragContext, &Stats);
+		DefragContext = VK_NULL_HANDLE;
+
+#if _DEBUG
+		BE_INFO("{0}: moved {1} allocations ({2} KB), freed {3} memory blocks ({4} KB)", DebugName, Stats.allocationsMoved, Stats.bytesMoved >> 10,
+				Stats.deviceMemoryBlocksFreed, Stats.bytesFreed >> 10);
+#endif
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <vma/vk_mem_alloc.h>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace VulkanCore
+{
+
+class Context;
+class Buffer;
+class Texture;
+class BarrierBuilder;
+
+// Only one of the resources is set
+struct RelocationEvent
+{
+	std::shared_ptr<Buffer> MovedBuffer;
+	std::shared_ptr<Texture> MovedTexture;
+};
+
+// Descriptors and device addresses referencing a moved resource have to be written again in the callback
+using RelocationCallback = std::function<void(const RelocationEvent&)>;
+
+struct DefragmentationBudget
+{
+	// Upper bounds on the copies recorded in a single frame
+	VkDeviceSize MaxBytesPerPass = 16 * 1024 * 1024;
+	uint32_t MaxAllocationsPerPass = 64;
+};
+
+// Runs VMA's defragmentation a bounded pass at a time. A pass records copies of the moved resources into their new memory
+// and switches them over right away, the old resources and memory are released FramesInFlight frames later once the GPU
+// can't be using them anymore. Only resources registered with the defragmenter are moved.
+class Defragmenter final
+{
+public:
+	MOVABLE_ONLY(Defragmenter);
+
+	explicit Defragmenter(const Context& InContext, uint32_t InFramesInFlight, const DefragmentationBudget& InBudget = {}, const std::string& Name = "");
+	~Defragmenter();
+
+	// Resources should be read-only on the GPU, anything written after the copy was recorded would be lost
+	void Register(std::shared_ptr<Buffer> InBuffer);
+	void Register(std::shared_ptr<Texture> InTexture);
+	void Unregister(VmaAllocation Allocation);
+
+	void AddRelocationCallback(RelocationCallback Callback);
+
+	// Starts defragmenting if it isn't running already
+	void Start();
+	bool IsRunning() const { return DefragContext != VK_NULL_HANDLE; }
+
+	// Needs to be called once per frame after waiting on the frame's fence. Copies are recorded into CmdBuffer and barriers
+	// for the moved resources are added to Barriers, which has to be flushed before the resources are used.
+	void Update(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers);
+
+private:
+	struct RegisteredResource
+	{
+		std::weak_ptr<Buffer> WeakBuffer;
+		std::weak_ptr<Texture> WeakTexture;
+	};
+
+	// Old handles of a moved resource. The resource itself is kept alive until the pass ended, since VMA doesn't allow
+	// freeing an allocation that is being moved.
+	struct RetiredResource
+	{
+		std::shared_ptr<Buffer> MovedBuffer;
+		std::shared_ptr<Texture> MovedTexture;
+
+		VkBuffer OldBuffer = VK_NULL_HANDLE;
+		VkImage OldImage = VK_NULL_HANDLE;
+		VkImageView OldImageView = VK_NULL_HANDLE;
+	};
+
+	void BeginPass(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers);
+	void EndPass();
+	void Finish();
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	VmaAllocator Allocator = VK_NULL_HANDLE;
+
+	DefragmentationBudget Budget;
+
+	uint32_t FramesInFlight = 0;
+	uint64_t CurrentFrame = 0;
+
+	VmaDefragmentationContext DefragContext = VK_NULL_HANDLE;
+	VmaDefragmentationPassMoveInfo PassInfo{};
+	bool bPassInProgress = false;
+	uint64_t PassFrame = 0;
+
+	std::unordered_map<VmaAllocation, RegisteredResource> Resources;
+	std::vector<RetiredResource> RetiredResources;
+	std::vector<RelocationCallback> RelocationCallbacks;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
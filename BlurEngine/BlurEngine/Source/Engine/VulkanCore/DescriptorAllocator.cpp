@@ -0,0 +1,405 @@
+#include "DescriptorAllocator.h"
+#include "Context.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VulkanCore
+{
+
+	size_t DescriptorAllocator::LayoutKeyHasher::operator()(const LayoutKey& Key) const
+	{
+		size_t Hash = std::hash<uint32_t>()(Key.Flags);
+
+		auto Combine = [&Hash](uint64_t Value)
+		{
+			Hash ^= std::hash<uint64_t>()(Value) + 0x9E3779B97F4A7C15ull + (Hash << 6) + (Hash >> 2);
+		};
+
+		for(const LayoutBindingKey& Binding : Key.Bindings)
+		{
+			Combine(((uint64_t)Binding.Binding << 32) | (uint64_t)Binding.Type);
+			Combine(((uint64_t)Binding.DescriptorCount << 32) | (uint64_t)Binding.Stages);
+			Combine(Binding.BindingFlags);
+		}
+
+		return Hash;
+	}
+
+	DescriptorAllocator::DescriptorAllocator(const Context& DeviceContext, const std::string& Name)
+		: VulkanDevice{DeviceContext.GetDevice()}, DebugName{"Descriptor Allocator: " + Name}
+	{
+	}
+
+	DescriptorAllocator::~DescriptorAllocator()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		for(const auto& [Layout, Pools] : Persistent)
+		{
+			if(Pools.AllocatedSets > 0)
+			{
+				BE_WARN("{0}: {1} descriptor sets were never freed", DebugName, Pools.AllocatedSets);
+			}
+
+			for(VkDescriptorPool Pool : Pools.Pools)
+			{
+				vkDestroyDescriptorPool(VulkanDevice, Pool, nullptr);
+			}
+		}
+
+		for(const FramePools& Frame : Frames)
+		{
+			for(VkDescriptorPool Pool : Frame.Pools)
+			{
+				vkDestroyDescriptorPool(VulkanDevice, Pool, nullptr);
+			}
+		}
+
+		for(const auto& [Key, Layout] : Layouts)
+		{
+			vkDestroyDescriptorSetLayout(VulkanDevice, Layout, nullptr);
+		}
+	}
+
+	VkDescriptorSetLayout DescriptorAllocator::GetLayout(std::span<const VkDescriptorSetLayoutBinding> Bindings, std::span<const VkDescriptorBindingFlags> BindingFlags,
+														 VkDescriptorSetLayoutCreateFlags Flags)
+	{
+		ASSERT(BindingFlags.empty() || BindingFlags.size() == Bindings.size(), "Binding flags need one entry per binding!");
+
+		LayoutKey Key;
+		Key.Flags = Flags;
+		Key.Bindings.reserve(Bindings.size());
+
+		for(size_t Index = 0; Index < Bindings.size(); Index++)
+		{
+			ASSERT(Bindings[Index].pImmutableSamplers == nullptr, "Immutable samplers aren't supported by the layout cache!");
+
+			LayoutBindingKey BindingKey;
+			BindingKey.Binding = Bindings[Index].binding;
+			BindingKey.Type = Bindings[Index].descriptorType;
+			BindingKey.DescriptorCount = Bindings[Index].descriptorCount;
+			BindingKey.Stages = Bindings[Index].stageFlags;
+			BindingKey.BindingFlags = !BindingFlags.empty() ? BindingFlags[Index] : 0;
+
+			Key.Bindings.push_back(BindingKey);
+		}
+
+		std::sort(Key.Bindings.begin(), Key.Bindings.end(), [](const LayoutBindingKey& A, const LayoutBindingKey& B) { return A.Binding < B.Binding; });
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		auto Itr = Layouts.find(Key);
+		if(Itr != Layouts.end())
+		{
+			return Itr->second;
+		}
+
+		std::vector<VkDescriptorSetLayoutBinding> SortedBindings;
+		std::vector<VkDescriptorBindingFlags> SortedFlags;
+		SortedBindings.reserve(Key.Bindings.size());
+		SortedFlags.reserve(Key.Bindings.size());
+
+		LayoutInfo Info;
+
+		for(const LayoutBindingKey& BindingKey : Key.Bindings)
+		{
+			VkDescriptorSetLayoutBinding LayoutBinding{};
+			LayoutBinding.binding = BindingKey.Binding;
+			LayoutBinding.descriptorType = BindingKey.Type;
+			LayoutBinding.descriptorCount = BindingKey.DescriptorCount;
+			LayoutBinding.stageFlags = BindingKey.Stages;
+			LayoutBinding.pImmutableSamplers = nullptr;
+
+			SortedBindings.push_back(LayoutBinding);
+			SortedFlags.push_back(BindingKey.BindingFlags);
+
+			if(BindingKey.DescriptorCount > 0)
+			{
+				const VkDescriptorPoolSize Size{BindingKey.Type, BindingKey.DescriptorCount};
+				AddPoolSizes(Info.PoolSizes, std::span<const VkDescriptorPoolSize>(&Size, 1), 1);
+			}
+		}
+
+		Info.bUpdateAfterBind = (Flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT) != 0;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo LayoutFlagsInfo{};
+		LayoutFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		LayoutFlagsInfo.pNext = nullptr;
+		LayoutFlagsInfo.bindingCount = static_cast<uint32_t>(SortedFlags.size());
+		LayoutFlagsInfo.pBindingFlags = !SortedFlags.empty() ? SortedFlags.data() : nullptr;
+
+		VkDescriptorSetLayoutCreateInfo DescriptorLayoutInfo{};
+		DescriptorLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		DescriptorLayoutInfo.flags = Flags;
+		DescriptorLayoutInfo.bindingCount = static_cast<uint32_t>(SortedBindings.size());
+		DescriptorLayoutInfo.pBindings = !SortedBindings.empty() ? SortedBindings.data() : nullptr;
+		DescriptorLayoutInfo.pNext = &LayoutFlagsInfo;
+
+		VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+
+		const std::string ErrorMsg = "Failed to create descriptor set layout: " + DebugName;
+		VK_CHECK(vkCreateDescriptorSetLayout(VulkanDevice, &DescriptorLayoutInfo, nullptr, &Layout), ErrorMsg.c_str());
+
+		Layouts.emplace(std::move(Key), Layout);
+		LayoutInfos.emplace(Layout, std::move(Info));
+
+		return Layout;
+	}
+
+	VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout Layout, VkDescriptorPool& OutPool)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		auto InfoItr = LayoutInfos.find(Layout);
+		ASSERT(InfoItr != LayoutInfos.end(), "Descriptor set layout wasn't created by this allocator!");
+		const LayoutInfo& Info = InfoItr->second;
+
+		PersistentPools& LayoutPools = Persistent[Layout];
+
+		// Newest pool first, older pools only have room if sets were freed from them
+		for(auto Itr = LayoutPools.Pools.rbegin(); Itr != LayoutPools.Pools.rend(); ++Itr)
+		{
+			VkDescriptorSet Set = TryAllocate(*Itr, Layout);
+			if(Set != VK_NULL_HANDLE)
+			{
+				LayoutPools.AllocatedSets++;
+				OutPool = *Itr;
+				return Set;
+			}
+		}
+
+		// Every pool doubles what the layout has allocated so far
+		const uint32_t MaxSets = std::clamp(LayoutPools.AllocatedSets, 1u, MAX_SETS_PER_POOL);
+
+		std::vector<VkDescriptorPoolSize> PoolSizes;
+		AddPoolSizes(PoolSizes, Info.PoolSizes, MaxSets);
+
+		VkDescriptorPoolCreateFlags PoolFlags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		if(Info.bUpdateAfterBind)
+		{
+			PoolFlags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		}
+
+		VkDescriptorPool NewPool = CreatePool(PoolSizes, MaxSets, PoolFlags);
+		LayoutPools.Pools.push_back(NewPool);
+
+		VkDescriptorSet Set = TryAllocate(NewPool, Layout);
+		ASSERT(Set != VK_NULL_HANDLE, "Failed to allocate a descriptor set from a new pool!");
+
+		LayoutPools.AllocatedSets++;
+		OutPool = NewPool;
+		return Set;
+	}
+
+	void DescriptorAllocator::Free(VkDescriptorSet Set, VkDescriptorPool Pool)
+	{
+		if(Set == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		for(auto& [Layout, LayoutPools] : Persistent)
+		{
+			if(std::find(LayoutPools.Pools.begin(), LayoutPools.Pools.end(), Pool) != LayoutPools.Pools.end())
+			{
+				VK_CHECK(vkFreeDescriptorSets(VulkanDevice, Pool, 1, &Set));
+				LayoutPools.AllocatedSets--;
+				return;
+			}
+		}
+
+		BE_ERROR("{0}: trying to free a descriptor set that wasn't allocated as a persistent set!", DebugName);
+	}
+
+	VkDescriptorSet DescriptorAllocator::AllocateFrameSet(VkDescriptorSetLayout Layout)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		auto InfoItr = LayoutInfos.find(Layout);
+		ASSERT(InfoItr != LayoutInfos.end(), "Descriptor set layout wasn't created by this allocator!");
+		const LayoutInfo& Info = InfoItr->second;
+
+		if(Frames.empty())
+		{
+			Frames.resize(1);
+		}
+
+		FramePools& Frame = Frames[CurrentFrame];
+
+		VkDescriptorSet Set = VK_NULL_HANDLE;
+		while(Set == VK_NULL_HANDLE && Frame.CurrentPool < Frame.Pools.size())
+		{
+			Set = TryAllocate(Frame.Pools[Frame.CurrentPool], Layout);
+			if(Set == VK_NULL_HANDLE)
+			{
+				Frame.CurrentPool++;
+			}
+		}
+
+		if(Set == VK_NULL_HANDLE)
+		{
+			// Twice what the frame used so far, so a frame that keeps growing only needs a few pools
+			std::vector<VkDescriptorPoolSize> PoolSizes = Frame.UsedSizes;
+			AddPoolSizes(PoolSizes, Info.PoolSizes, 1);
+			for(VkDescriptorPoolSize& Size : PoolSizes)
+			{
+				Size.descriptorCount *= 2;
+			}
+
+			VkDescriptorPool NewPool = CreatePool(PoolSizes, (Frame.UsedSets + 1) * 2, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+			Frame.Pools.push_back(NewPool);
+			Frame.CurrentPool = static_cast<uint32_t>(Frame.Pools.size() - 1);
+
+			Set = TryAllocate(NewPool, Layout);
+			ASSERT(Set != VK_NULL_HANDLE, "Failed to allocate a descriptor set from a new pool!");
+		}
+
+		AddPoolSizes(Frame.UsedSizes, Info.PoolSizes, 1);
+		Frame.UsedSets++;
+
+		return Set;
+	}
+
+	void DescriptorAllocator::BeginFrame(uint32_t FrameIndex)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(FrameIndex >= Frames.size())
+		{
+			Frames.resize(FrameIndex + 1);
+		}
+
+		FrameSetsLastFrame = Frames[CurrentFrame].UsedSets;
+		CurrentFrame = FrameIndex;
+
+		FramePools& Frame = Frames[FrameIndex];
+
+		if(Frame.Pools.size() > 1)
+		{
+			// The frame outgrew its pool, replace them with one that fits everything it allocated
+			for(VkDescriptorPool Pool : Frame.Pools)
+			{
+				vkDestroyDescriptorPool(VulkanDevice, Pool, nullptr);
+			}
+
+			Frame.Pools.clear();
+
+			std::vector<VkDescriptorPoolSize> PoolSizes = Frame.UsedSizes;
+			for(VkDescriptorPoolSize& Size : PoolSizes)
+			{
+				Size.descriptorCount = (uint32_t)std::ceil(Size.descriptorCount * FRAME_POOL_HEADROOM);
+			}
+
+			const uint32_t MaxSets = (uint32_t)std::ceil(Frame.UsedSets * FRAME_POOL_HEADROOM);
+			Frame.Pools.push_back(CreatePool(PoolSizes, MaxSets, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT));
+
+#if _DEBUG
+			BE_INFO("{0}: frame {1} pools merged into one for {2} sets", DebugName, FrameIndex, MaxSets);
+#endif
+		}
+		else if(!Frame.Pools.empty())
+		{
+			VK_CHECK(vkResetDescriptorPool(VulkanDevice, Frame.Pools.front(), 0));
+		}
+
+		Frame.CurrentPool = 0;
+		Frame.UsedSizes.clear();
+		Frame.UsedSets = 0;
+	}
+
+	DescriptorAllocatorStats DescriptorAllocator::GetStats() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		DescriptorAllocatorStats Stats;
+		Stats.CachedLayouts = static_cast<uint32_t>(Layouts.size());
+		Stats.FrameSetsLastFrame = FrameSetsLastFrame;
+		Stats.ReservedDescriptors = ReservedDescriptors;
+
+		for(const auto& [Layout, LayoutPools] : Persistent)
+		{
+			Stats.PersistentPools += static_cast<uint32_t>(LayoutPools.Pools.size());
+			Stats.PersistentSets += LayoutPools.AllocatedSets;
+		}
+
+		for(const FramePools& Frame : Frames)
+		{
+			Stats.FramePools += static_cast<uint32_t>(Frame.Pools.size());
+		}
+
+		return Stats;
+	}
+
+	void DescriptorAllocator::LogStats() const
+	{
+		const DescriptorAllocatorStats Current = GetStats();
+
+		BE_INFO("{0}: {1} layouts, {2} persistent sets in {3} pools, {4} frame sets last frame in {5} pools, {6} descriptors reserved", DebugName,
+				Current.CachedLayouts, Current.PersistentSets, Current.PersistentPools, Current.FrameSetsLastFrame, Current.FramePools,
+				Current.ReservedDescriptors);
+	}
+
+	VkDescriptorPool DescriptorAllocator::CreatePool(std::span<const VkDescriptorPoolSize> PoolSizes, uint32_t MaxSets, VkDescriptorPoolCreateFlags Flags)
+	{
+		VkDescriptorPoolCreateInfo DescPoolInfo{};
+		DescPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		DescPoolInfo.flags = Flags;
+		DescPoolInfo.maxSets = std::max(MaxSets, 1u);
+		DescPoolInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
+		DescPoolInfo.pPoolSizes = !PoolSizes.empty() ? PoolSizes.data() : nullptr;
+		DescPoolInfo.pNext = VK_NULL_HANDLE;
+
+		VkDescriptorPool Pool = VK_NULL_HANDLE;
+
+		const std::string ErrorMsg = "Failed to create descriptor pool: " + DebugName;
+		VK_CHECK(vkCreateDescriptorPool(VulkanDevice, &DescPoolInfo, nullptr, &Pool), ErrorMsg.c_str());
+
+		for(const VkDescriptorPoolSize& Size : PoolSizes)
+		{
+			ReservedDescriptors += Size.descriptorCount;
+		}
+
+		return Pool;
+	}
+
+	VkDescriptorSet DescriptorAllocator::TryAllocate(VkDescriptorPool Pool, VkDescriptorSetLayout Layout)
+	{
+		VkDescriptorSetAllocateInfo DescAllocInfo{};
+		DescAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		DescAllocInfo.descriptorPool = Pool;
+		DescAllocInfo.descriptorSetCount = 1;
+		DescAllocInfo.pSetLayouts = &Layout;
+
+		VkDescriptorSet Set = VK_NULL_HANDLE;
+		const VkResult Result = vkAllocateDescriptorSets(VulkanDevice, &DescAllocInfo, &Set);
+
+		if(Result == VK_ERROR_OUT_OF_POOL_MEMORY || Result == VK_ERROR_FRAGMENTED_POOL)
+		{
+			return VK_NULL_HANDLE;
+		}
+
+		VK_CHECK(Result);
+		return Set;
+	}
+
+	void DescriptorAllocator::AddPoolSizes(std::vector<VkDescriptorPoolSize>& InOutSizes, std::span<const VkDescriptorPoolSize> Sizes, uint32_t Multiplier)
+	{
+		for(const VkDescriptorPoolSize& Size : Sizes)
+		{
+			auto Itr = std::find_if(InOutSizes.begin(), InOutSizes.end(), [&Size](const VkDescriptorPoolSize& Existing) { return Existing.type == Size.type; });
+			if(Itr != InOutSizes.end())
+			{
+				Itr->descriptorCount += Size.descriptorCount * Multiplier;
+			}
+			else
+			{
+				InOutSizes.push_back({Size.type, Size.descriptorCount * Multiplier});
+			}
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+namespace VulkanCore
+{
+
+class Context;
+
+struct DescriptorAllocatorStats
+{
+	uint32_t CachedLayouts = 0;
+
+	uint32_t PersistentPools = 0;
+	uint32_t PersistentSets = 0;
+
+	uint32_t FramePools = 0;
+	uint32_t FrameSetsLastFrame = 0;
+
+	// Descriptors the pools were created with, summed over every type
+	uint64_t ReservedDescriptors = 0;
+};
+
+// Owns every descriptor set layout and descriptor pool. Layouts are cached by their bindings, so pipelines declaring the same set
+// share one layout. Pools are sized from what was actually allocated instead of a fixed worst case:
+// - persistent sets come from per layout pools, every new pool holds as many sets as the layout already has, up to MAX_SETS_PER_POOL
+// - frame sets come from pools owned by one frame in flight and are all freed at once by BeginFrame with vkResetDescriptorPool,
+//   a frame that needed more than one pool gets a single pool sized to its usage the next time around
+class DescriptorAllocator final
+{
+public:
+	MOVABLE_ONLY(DescriptorAllocator);
+
+	explicit DescriptorAllocator(const Context& DeviceContext, const std::string& Name = "");
+	~DescriptorAllocator();
+
+	// The layout stays valid for the allocator's lifetime, callers don't destroy it. BindingFlags is empty or has one entry per binding.
+	VkDescriptorSetLayout GetLayout(std::span<const VkDescriptorSetLayoutBinding> Bindings, std::span<const VkDescriptorBindingFlags> BindingFlags,
+									VkDescriptorSetLayoutCreateFlags Flags = 0);
+
+	// Sets that live until they are freed, OutPool has to be handed back to Free
+	VkDescriptorSet Allocate(VkDescriptorSetLayout Layout, VkDescriptorPool& OutPool);
+	void Free(VkDescriptorSet Set, VkDescriptorPool Pool);
+
+	// Sets that are only valid until the frame in flight they were allocated in comes around again
+	VkDescriptorSet AllocateFrameSet(VkDescriptorSetLayout Layout);
+
+	// Recycles every set allocated the last time FrameIndex was current, the frame's command buffers must have retired
+	void BeginFrame(uint32_t FrameIndex);
+
+	DescriptorAllocatorStats GetStats() const;
+	void LogStats() const;
+
+public:
+	static constexpr uint32_t MAX_SETS_PER_POOL = 256;
+	// Frame pools are recreated with this many sets per set used, so small changes in usage don't need a second pool
+	static constexpr float FRAME_POOL_HEADROOM = 1.25f;
+
+private:
+	struct LayoutBindingKey
+	{
+		uint32_t Binding = 0;
+		VkDescriptorType Type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		uint32_t DescriptorCount = 0;
+		VkShaderStageFlags Stages = 0;
+		VkDescriptorBindingFlags BindingFlags = 0;
+
+		bool operator==(const LayoutBindingKey& Other) const = default;
+	};
+
+	struct LayoutKey
+	{
+		VkDescriptorSetLayoutCreateFlags Flags = 0;
+		// Sorted by binding
+		std::vector<LayoutBindingKey> Bindings;
+
+		bool operator==(const LayoutKey& Other) const = default;
+	};
+
+	struct LayoutKeyHasher
+	{
+		size_t operator()(const LayoutKey& Key) const;
+	};
+
+	struct LayoutInfo
+	{
+		// Descriptors one set of the layout needs, one entry per type
+		std::vector<VkDescriptorPoolSize> PoolSizes;
+		bool bUpdateAfterBind = false;
+	};
+
+	struct PersistentPools
+	{
+		std::vector<VkDescriptorPool> Pools;
+		uint32_t AllocatedSets = 0;
+	};
+
+	struct FramePools
+	{
+		std::vector<VkDescriptorPool> Pools;
+		uint32_t CurrentPool = 0;
+
+		// What the frame allocated since its last reset
+		std::vector<VkDescriptorPoolSize> UsedSizes;
+		uint32_t UsedSets = 0;
+	};
+
+	VkDescriptorPool CreatePool(std::span<const VkDescriptorPoolSize> PoolSizes, uint32_t MaxSets, VkDescriptorPoolCreateFlags Flags);
+
+	// Returns VK_NULL_HANDLE if the pool is out of memory
+	VkDescriptorSet TryAllocate(VkDescriptorPool Pool, VkDescriptorSetLayout Layout);
+
+	static void AddPoolSizes(std::vector<VkDescriptorPoolSize>& InOutSizes, std::span<const VkDescriptorPoolSize> Sizes, uint32_t Multiplier);
+
+private:
+	VkDevice VulkanDevice = VK_NULL_HANDLE;
+
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHasher> Layouts;
+	std::unordered_map<VkDescriptorSetLayout, LayoutInfo> LayoutInfos;
+
+	std::unordered_map<VkDescriptorSetLayout, PersistentPools> Persistent;
+
+	std::vector<FramePools> Frames;
+	uint32_t CurrentFrame = 0;
+	uint32_t FrameSetsLastFrame = 0;
+
+	uint64_t ReservedDescriptors = 0;
+
+	mutable std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
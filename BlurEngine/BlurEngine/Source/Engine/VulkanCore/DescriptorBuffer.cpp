@@ -0,0 +1,321 @@
+#include "DescriptorBuffer.h"
+#include "Context.h"
+#include "Buffer.h"
+#include "CommandQueueManager.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace VulkanCore
+{
+
+	bool DescriptorBufferFunctions::Load(VkDevice Device)
+	{
+		GetDescriptorSetLayoutSize = (PFN_vkGetDescriptorSetLayoutSizeEXT)vkGetDeviceProcAddr(Device, "vkGetDescriptorSetLayoutSizeEXT");
+		GetDescriptorSetLayoutBindingOffset = (PFN_vkGetDescriptorSetLayoutBindingOffsetEXT)vkGetDeviceProcAddr(Device, "vkGetDescriptorSetLayoutBindingOffsetEXT");
+		GetDescriptor = (PFN_vkGetDescriptorEXT)vkGetDeviceProcAddr(Device, "vkGetDescriptorEXT");
+		CmdBindDescriptorBuffers = (PFN_vkCmdBindDescriptorBuffersEXT)vkGetDeviceProcAddr(Device, "vkCmdBindDescriptorBuffersEXT");
+		CmdSetDescriptorBufferOffsets = (PFN_vkCmdSetDescriptorBufferOffsetsEXT)vkGetDeviceProcAddr(Device, "vkCmdSetDescriptorBufferOffsetsEXT");
+
+		if(!GetDescriptorSetLayoutSize || !GetDescriptorSetLayoutBindingOffset || !GetDescriptor || !CmdBindDescriptorBuffers || !CmdSetDescriptorBufferOffsets)
+		{
+			*this = DescriptorBufferFunctions{};
+			return false;
+		}
+
+		return true;
+	}
+
+	DescriptorBuffer::DescriptorBuffer(const Context& InContext, const std::string& Name)
+		: DeviceContext{InContext}, VulkanDevice{InContext.GetDevice()}, Functions{InContext.GetDescriptorBufferFunctions()},
+		  Properties{InContext.GetPhysicalDevice().GetDescriptorBufferProperties()}, DebugName{"Descriptor Buffer: " + Name}
+	{
+		ASSERT(Functions.IsLoaded(), "Descriptor buffers aren't enabled on this device!");
+
+		BufferUsage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	}
+
+	void DescriptorBuffer::AddSetLayout(uint32_t Set, VkDescriptorSetLayout Layout, std::span<const VkDescriptorSetLayoutBinding> Bindings)
+	{
+		ASSERT(!Sets.contains(Set), "Set was already added to the descriptor buffer!");
+		ASSERT(UsedSize == 0, "Every set has to be added before allocating sets!");
+
+		SetRegion Region;
+		Region.Layout = Layout;
+
+		// Every set starts at a valid buffer offset, so the size is rounded up to the offset alignment
+		const VkDeviceSize Alignment = std::max<VkDeviceSize>(Properties.descriptorBufferOffsetAlignment, 1);
+		Functions.GetDescriptorSetLayoutSize(VulkanDevice, Layout, &Region.LayoutSize);
+		Region.LayoutSize = (Region.LayoutSize + Alignment - 1) & ~(Alignment - 1);
+
+		uint32_t NumBindings = 0;
+		for(const VkDescriptorSetLayoutBinding& Binding : Bindings)
+		{
+			NumBindings = std::max(NumBindings, Binding.binding + 1);
+		}
+
+		Region.BindingOffsets.resize(NumBindings, 0);
+
+		for(const VkDescriptorSetLayoutBinding& Binding : Bindings)
+		{
+			Functions.GetDescriptorSetLayoutBindingOffset(VulkanDevice, Layout, Binding.binding, &Region.BindingOffsets[Binding.binding]);
+
+			if(Binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || Binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+			{
+				BufferUsage |= VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+			}
+		}
+
+		Sets.emplace(Set, std::move(Region));
+	}
+
+	void DescriptorBuffer::AllocateSets(uint32_t Set, uint32_t Count)
+	{
+		auto Itr = Sets.find(Set);
+		ASSERT(Itr != Sets.end(), "This descriptor buffer doesn't have a set with index " + std::to_string(Set));
+
+		SetRegion& Region = Itr->second;
+
+		const VkDeviceSize RequiredSize = UsedSize + Region.LayoutSize * Count;
+		if(!DescriptorMemory || RequiredSize > DescriptorMemory->GetSize())
+		{
+			Grow(RequiredSize);
+		}
+
+		for(uint32_t i = 0; i < Count; i++)
+		{
+			Region.Offsets.push_back(UsedSize);
+			UsedSize += Region.LayoutSize;
+		}
+	}
+
+	bool DescriptorBuffer::IsAllocated(uint32_t Set, uint32_t Index) const
+	{
+		auto Itr = Sets.find(Set);
+		return Itr != Sets.end() && Index < Itr->second.Offsets.size();
+	}
+
+	template<typename FillFunc>
+	void DescriptorBuffer::WriteDescriptors(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type, uint32_t Count, FillFunc&& Fill)
+	{
+		const size_t DescriptorSize = GetDescriptorSize(Type);
+		ASSERT(DescriptorSize > 0, "Descriptor type can't be written to a descriptor buffer!");
+
+		VkDeviceSize Offset = 0;
+		uint8_t* Dst = GetDescriptorPtr(Set, Index, Binding, DstArrayElement, DescriptorSize, Count, Offset);
+
+		VkDescriptorGetInfoEXT GetInfo{};
+		GetInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+		GetInfo.type = Type;
+		GetInfo.pNext = VK_NULL_HANDLE;
+
+		for(uint32_t Element = 0; Element < Count; Element++)
+		{
+			Fill(Element, GetInfo.data);
+			Functions.GetDescriptor(VulkanDevice, &GetInfo, DescriptorSize, Dst + Element * DescriptorSize);
+		}
+
+		// Does nothing on coherent memory
+		DescriptorMemory->Upload(Offset, DescriptorSize * Count);
+	}
+
+	void DescriptorBuffer::WriteImages(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type,
+									   std::span<const VkDescriptorImageInfo> Infos)
+	{
+		WriteDescriptors(Set, Index, Binding, DstArrayElement, Type, (uint32_t)Infos.size(), [&Infos, Type](uint32_t Element, VkDescriptorDataEXT& Data)
+		{
+			switch(Type)
+			{
+			case VK_DESCRIPTOR_TYPE_SAMPLER:					Data.pSampler = &Infos[Element].sampler; break;
+			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:		Data.pCombinedImageSampler = &Infos[Element]; break;
+			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:				Data.pSampledImage = &Infos[Element]; break;
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:				Data.pStorageImage = &Infos[Element]; break;
+			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:			Data.pInputAttachmentImage = &Infos[Element]; break;
+			default:											ASSERT(false, "Not an image descriptor type!"); break;
+			}
+		});
+	}
+
+	void DescriptorBuffer::WriteBuffers(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type,
+										std::span<const VkDescriptorBufferInfo> Infos)
+	{
+		VkDescriptorAddressInfoEXT AddressInfo{};
+		AddressInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+		AddressInfo.format = VK_FORMAT_UNDEFINED;
+		AddressInfo.pNext = VK_NULL_HANDLE;
+
+		WriteDescriptors(Set, Index, Binding, DstArrayElement, Type, (uint32_t)Infos.size(), [this, &Infos, &AddressInfo, Type](uint32_t Element, VkDescriptorDataEXT& Data)
+		{
+			ASSERT(Infos[Element].range != VK_WHOLE_SIZE, "Descriptor buffers need the exact range of a buffer descriptor!");
+
+			VkBufferDeviceAddressInfo BufferAddressInfo{};
+			BufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+			BufferAddressInfo.buffer = Infos[Element].buffer;
+			BufferAddressInfo.pNext = VK_NULL_HANDLE;
+
+			AddressInfo.address = vkGetBufferDeviceAddress(VulkanDevice, &BufferAddressInfo) + Infos[Element].offset;
+			AddressInfo.range = Infos[Element].range;
+
+			if(Type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+			{
+				Data.pUniformBuffer = &AddressInfo;
+			}
+			else
+			{
+				Data.pStorageBuffer = &AddressInfo;
+			}
+		});
+	}
+
+	void DescriptorBuffer::WriteTexelBuffer(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type,
+											VkBuffer TexelBuffer, VkDeviceSize Offset, VkDeviceSize Range, VkFormat Format)
+	{
+		VkBufferDeviceAddressInfo BufferAddressInfo{};
+		BufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		BufferAddressInfo.buffer = TexelBuffer;
+		BufferAddressInfo.pNext = VK_NULL_HANDLE;
+
+		VkDescriptorAddressInfoEXT AddressInfo{};
+		AddressInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+		AddressInfo.address = vkGetBufferDeviceAddress(VulkanDevice, &BufferAddressInfo) + Offset;
+		AddressInfo.range = Range;
+		AddressInfo.format = Format;
+		AddressInfo.pNext = VK_NULL_HANDLE;
+
+		WriteDescriptors(Set, Index, Binding, DstArrayElement, Type, 1, [&AddressInfo, Type](uint32_t Element, VkDescriptorDataEXT& Data)
+		{
+			if(Type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER)
+			{
+				Data.pUniformTexelBuffer = &AddressInfo;
+			}
+			else
+			{
+				Data.pStorageTexelBuffer = &AddressInfo;
+			}
+		});
+	}
+
+	void DescriptorBuffer::Bind(VkCommandBuffer CmdBuffer) const
+	{
+		if(!DescriptorMemory)
+		{
+			return;
+		}
+
+		VkDescriptorBufferBindingInfoEXT BindingInfo{};
+		BindingInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		BindingInfo.address = DescriptorAddress;
+		BindingInfo.usage = BufferUsage;
+		BindingInfo.pNext = VK_NULL_HANDLE;
+
+		Functions.CmdBindDescriptorBuffers(CmdBuffer, 1, &BindingInfo);
+	}
+
+	void DescriptorBuffer::SetOffsets(VkCommandBuffer CmdBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout Layout, uint32_t Set, uint32_t Index) const
+	{
+		ASSERT(IsAllocated(Set, Index), "Descriptor set was not allocated before binding");
+
+		// Everything lives in the one buffer bound by Bind
+		const uint32_t BufferIndex = 0;
+		const VkDeviceSize Offset = Sets.at(Set).Offsets[Index];
+
+		Functions.CmdSetDescriptorBufferOffsets(CmdBuffer, BindPoint, Layout, Set, 1, &BufferIndex, &Offset);
+	}
+
+	bool DescriptorBuffer::SupportsDescriptorType(VkDescriptorType Type)
+	{
+		switch(Type)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint8_t* DescriptorBuffer::GetDescriptorPtr(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, size_t DescriptorSize,
+												uint32_t Count, VkDeviceSize& OutOffset)
+	{
+		ASSERT(IsAllocated(Set, Index), "Descriptor set was not allocated before binding");
+
+		const SetRegion& Region = Sets.at(Set);
+		ASSERT(Binding < Region.BindingOffsets.size(), "The set doesn't have binding " + std::to_string(Binding));
+
+		// Array elements are packed tightly after the binding's offset
+		OutOffset = Region.Offsets[Index] + Region.BindingOffsets[Binding] + DstArrayElement * DescriptorSize;
+		ASSERT(OutOffset + Count * DescriptorSize <= Region.Offsets[Index] + Region.LayoutSize, "Descriptor write goes past the end of its set!");
+
+		return static_cast<uint8_t*>(DescriptorMemory->GetMappedMemory()) + OutOffset;
+	}
+
+	size_t DescriptorBuffer::GetDescriptorSize(VkDescriptorType Type) const
+	{
+		switch(Type)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:					return Properties.samplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:		return Properties.combinedImageSamplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:				return Properties.sampledImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:				return Properties.storageImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:			return Properties.inputAttachmentDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:		return Properties.uniformTexelBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:		return Properties.storageTexelBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:				return Properties.uniformBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:				return Properties.storageBufferDescriptorSize;
+		default:											return 0;
+		}
+	}
+
+	void DescriptorBuffer::ReleaseRetiredBuffers(CommandQueueManager& Queue)
+	{
+		if(RetiredBuffers.empty())
+		{
+			return;
+		}
+
+		// Buffers retired since the last call could still be bound by the command buffer being recorded
+		const uint64_t NextSubmit = Queue.GetNextSubmitIndex();
+		for(RetiredBuffer& Retired : RetiredBuffers)
+		{
+			if(Retired.SubmitIndex == 0)
+			{
+				Retired.SubmitIndex = NextSubmit;
+			}
+		}
+
+		const uint64_t CompletedSubmit = Queue.GetCompletedSubmitIndex();
+		std::erase_if(RetiredBuffers, [CompletedSubmit](const RetiredBuffer& Retired) { return Retired.SubmitIndex <= CompletedSubmit; });
+	}
+
+	void DescriptorBuffer::Grow(VkDeviceSize MinSize)
+	{
+		const VkDeviceSize NewSize = std::max(MinSize, DescriptorMemory ? DescriptorMemory->GetSize() * 2 : MinSize);
+
+		std::shared_ptr<Buffer> NewMemory = DeviceContext.CreateBuffer(NewSize, BufferUsage, MemoryUsagePolicy::PerFrameDynamic, DebugName);
+		ASSERT(NewMemory->GetMappedMemory() != nullptr, "Descriptor buffer has to be host visible!");
+
+		if(DescriptorMemory)
+		{
+			memcpy(NewMemory->GetMappedMemory(), DescriptorMemory->GetMappedMemory(), UsedSize);
+			NewMemory->Upload(0, UsedSize);
+
+#if _DEBUG
+			BE_INFO("{0}: grown from {1} KB to {2} KB", DebugName, DescriptorMemory->GetSize() >> 10, NewSize >> 10);
+#endif
+
+			RetiredBuffers.push_back({std::move(DescriptorMemory), 0});
+		}
+
+		DescriptorMemory = std::move(NewMemory);
+		DescriptorAddress = DescriptorMemory->GetDeviceAddress();
+	}
+
+}
\ No newline at end of file
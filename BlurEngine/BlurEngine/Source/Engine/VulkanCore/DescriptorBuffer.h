@@ -0,0 +1,110 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <span>
+#include <unordered_map>
+
+namespace VulkanCore
+{
+
+class Context;
+class Buffer;
+class CommandQueueManager;
+
+// VK_EXT_descriptor_buffer entry points, loaded by the Context when the extension is enabled
+struct DescriptorBufferFunctions
+{
+	PFN_vkGetDescriptorSetLayoutSizeEXT GetDescriptorSetLayoutSize = nullptr;
+	PFN_vkGetDescriptorSetLayoutBindingOffsetEXT GetDescriptorSetLayoutBindingOffset = nullptr;
+	PFN_vkGetDescriptorEXT GetDescriptor = nullptr;
+	PFN_vkCmdBindDescriptorBuffersEXT CmdBindDescriptorBuffers = nullptr;
+	PFN_vkCmdSetDescriptorBufferOffsetsEXT CmdSetDescriptorBufferOffsets = nullptr;
+
+	bool Load(VkDevice Device);
+	bool IsLoaded() const { return GetDescriptor != nullptr; }
+};
+
+// Keeps the descriptors of one pipeline's sets in a single host visible buffer. Descriptors are written straight into the mapped
+// memory with vkGetDescriptorEXT, so there are no pools, no descriptor set objects and no queued writes. A write is visible to the
+// GPU as soon as it returns, the same rules as update-after-bind apply: a descriptor a frame in flight reads must not be rewritten.
+class DescriptorBuffer final
+{
+public:
+	MOVABLE_ONLY(DescriptorBuffer);
+
+	explicit DescriptorBuffer(const Context& DeviceContext, const std::string& Name = "");
+
+	// Every set has to be added before any set is allocated. Layout must have been created with DESCRIPTOR_BUFFER_BIT_EXT.
+	void AddSetLayout(uint32_t Set, VkDescriptorSetLayout Layout, std::span<const VkDescriptorSetLayoutBinding> Bindings);
+	void AllocateSets(uint32_t Set, uint32_t Count);
+	bool IsAllocated(uint32_t Set, uint32_t Index) const;
+
+	void WriteImages(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type,
+					 std::span<const VkDescriptorImageInfo> Infos);
+	// Ranges can't be VK_WHOLE_SIZE, the buffers need VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+	void WriteBuffers(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type,
+					  std::span<const VkDescriptorBufferInfo> Infos);
+	void WriteTexelBuffer(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type,
+						  VkBuffer TexelBuffer, VkDeviceSize Offset, VkDeviceSize Range, VkFormat Format);
+
+	// Binds the buffer to the command buffer, has to happen before SetOffsets and again after another descriptor buffer was bound
+	void Bind(VkCommandBuffer CmdBuffer) const;
+	void SetOffsets(VkCommandBuffer CmdBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout Layout, uint32_t Set, uint32_t Index) const;
+
+	// Frees the buffers replaced by growing once every submit that could have bound them has completed, called once per frame
+	void ReleaseRetiredBuffers(CommandQueueManager& Queue);
+
+	// Dynamic buffers and inline uniform blocks can't live in a descriptor buffer, pipelines using them stay on descriptor sets
+	static bool SupportsDescriptorType(VkDescriptorType Type);
+
+private:
+	struct SetRegion
+	{
+		VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+		VkDeviceSize LayoutSize = 0;
+		// Indexed by binding
+		std::vector<VkDeviceSize> BindingOffsets;
+		// Offset of every allocated set in the buffer
+		std::vector<VkDeviceSize> Offsets;
+	};
+
+	struct RetiredBuffer
+	{
+		std::shared_ptr<Buffer> Memory;
+		// Last submit that can have it bound, 0 until ReleaseRetiredBuffers has seen it
+		uint64_t SubmitIndex = 0;
+	};
+
+	// Where element DstArrayElement of Binding lives in the mapped memory
+	uint8_t* GetDescriptorPtr(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, size_t DescriptorSize, uint32_t Count, VkDeviceSize& OutOffset);
+	size_t GetDescriptorSize(VkDescriptorType Type) const;
+
+	// Writes one descriptor per element, GetInfo.data is pointed at each element in turn by Fill
+	template<typename FillFunc>
+	void WriteDescriptors(uint32_t Set, uint32_t Index, uint32_t Binding, uint32_t DstArrayElement, VkDescriptorType Type, uint32_t Count, FillFunc&& Fill);
+
+	void Grow(VkDeviceSize MinSize);
+
+private:
+	const Context& DeviceContext;
+	VkDevice VulkanDevice = VK_NULL_HANDLE;
+
+	const DescriptorBufferFunctions& Functions;
+	VkPhysicalDeviceDescriptorBufferPropertiesEXT Properties{};
+
+	std::unordered_map<uint32_t, SetRegion> Sets;
+
+	std::shared_ptr<Buffer> DescriptorMemory;
+	VkDeviceAddress DescriptorAddress = 0;
+	VkDeviceSize UsedSize = 0;
+	VkBufferUsageFlags BufferUsage = 0;
+
+	// Replaced by Grow, kept alive since frames in flight can still read them
+	std::vector<RetiredBuffer> RetiredBuffers;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
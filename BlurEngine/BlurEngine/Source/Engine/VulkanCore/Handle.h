@@ -0,0 +1,172 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+namespace VulkanCore
+{
+
+// Typed reference to an object in a HandlePool. Copying one is two integers, no reference counting, and a handle to an
+// object that was freed is detected by its generation instead of dangling.
+template<typename T>
+struct Handle
+{
+	uint32_t Index = UINT32_MAX;
+	uint32_t Generation = 0;
+
+	bool IsNull() const { return Index == UINT32_MAX; }
+
+	bool operator==(const Handle& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+	bool operator!=(const Handle& Other) const { return !(*this == Other); }
+};
+
+// Owns objects of one type in a dense array, so iterating every live object walks contiguous memory. Handles index an
+// indirection table holding each slot's generation and dense position, lookups and validation are O(1).
+// Freeing moves the last object into the hole, pointers returned by Get are only valid until the next Allocate or Free.
+// Not thread safe, owners lock around it like the rest of the engine's caches.
+template<typename T>
+class HandlePool final
+{
+public:
+	MOVABLE_ONLY(HandlePool);
+
+	HandlePool() = default;
+
+	// Pointers returned by Get stay valid across Allocate as long as the pool stays within the reserved size and nothing is freed
+	void Reserve(uint32_t Count)
+	{
+		Objects.reserve(Count);
+		DenseToSlot.reserve(Count);
+		Slots.reserve(Count);
+	}
+
+	template<typename... Args>
+	Handle<T> Allocate(Args&&... InArgs)
+	{
+		uint32_t SlotIndex = 0;
+		if(!FreeSlots.empty())
+		{
+			SlotIndex = FreeSlots.back();
+			FreeSlots.pop_back();
+		}
+		else
+		{
+			SlotIndex = static_cast<uint32_t>(Slots.size());
+			Slots.emplace_back();
+		}
+
+		Slot& NewSlot = Slots[SlotIndex];
+		NewSlot.DenseIndex = static_cast<uint32_t>(Objects.size());
+
+		Objects.emplace_back(std::forward<Args>(InArgs)...);
+		DenseToSlot.push_back(SlotIndex);
+
+		return {SlotIndex, NewSlot.Generation};
+	}
+
+	// Returns false if the handle was already freed
+	bool Free(Handle<T> InHandle)
+	{
+		if(!IsValid(InHandle))
+		{
+			return false;
+		}
+
+		Slot& FreedSlot = Slots[InHandle.Index];
+		const uint32_t LastIndex = static_cast<uint32_t>(Objects.size()) - 1;
+
+		if(FreedSlot.DenseIndex != LastIndex)
+		{
+			Objects[FreedSlot.DenseIndex] = std::move(Objects[LastIndex]);
+			DenseToSlot[FreedSlot.DenseIndex] = DenseToSlot[LastIndex];
+			Slots[DenseToSlot[LastIndex]].DenseIndex = FreedSlot.DenseIndex;
+		}
+
+		Objects.pop_back();
+		DenseToSlot.pop_back();
+
+		// Outstanding handles to the slot stop validating, the slot is retired once the generation would wrap
+		FreedSlot.Generation++;
+		FreedSlot.DenseIndex = UINT32_MAX;
+		if(FreedSlot.Generation != UINT32_MAX)
+		{
+			FreeSlots.push_back(InHandle.Index);
+		}
+
+		return true;
+	}
+
+	bool IsValid(Handle<T> InHandle) const
+	{
+		return InHandle.Index < Slots.size() && Slots[InHandle.Index].Generation == InHandle.Generation && Slots[InHandle.Index].DenseIndex != UINT32_MAX;
+	}
+
+	// Returns nullptr for stale or null handles
+	T* Get(Handle<T> InHandle)
+	{
+		return IsValid(InHandle) ? &Objects[Slots[InHandle.Index].DenseIndex] : nullptr;
+	}
+
+	const T* Get(Handle<T> InHandle) const
+	{
+		return IsValid(InHandle) ? &Objects[Slots[InHandle.Index].DenseIndex] : nullptr;
+	}
+
+	T& operator[](Handle<T> InHandle)
+	{
+		ASSERT(IsValid(InHandle), "Stale or invalid handle!");
+		return Objects[Slots[InHandle.Index].DenseIndex];
+	}
+
+	const T& operator[](Handle<T> InHandle) const
+	{
+		ASSERT(IsValid(InHandle), "Stale or invalid handle!");
+		return Objects[Slots[InHandle.Index].DenseIndex];
+	}
+
+	void Clear()
+	{
+		for(uint32_t SlotIndex : DenseToSlot)
+		{
+			Slot& FreedSlot = Slots[SlotIndex];
+			FreedSlot.Generation++;
+			FreedSlot.DenseIndex = UINT32_MAX;
+			if(FreedSlot.Generation != UINT32_MAX)
+			{
+				FreeSlots.push_back(SlotIndex);
+			}
+		}
+
+		Objects.clear();
+		DenseToSlot.clear();
+	}
+
+	uint32_t GetSize() const { return static_cast<uint32_t>(Objects.size()); }
+
+	// Live objects in no particular order
+	std::vector<T>& GetObjects() { return Objects; }
+	const std::vector<T>& GetObjects() const { return Objects; }
+
+	// Handle of the object at a position in GetObjects
+	Handle<T> GetHandle(uint32_t DenseIndex) const
+	{
+		ASSERT(DenseIndex < Objects.size(), "Dense index is outside of the pool!");
+		const uint32_t SlotIndex = DenseToSlot[DenseIndex];
+		return {SlotIndex, Slots[SlotIndex].Generation};
+	}
+
+private:
+	struct Slot
+	{
+		uint32_t Generation = 0;
+		uint32_t DenseIndex = UINT32_MAX;
+	};
+
+	std::vector<T> Objects;
+	std::vector<uint32_t> DenseToSlot;
+
+	std::vector<Slot> Slots;
+	std::vector<uint32_t> FreeSlots;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "LinearUniformAllocator.h"
+#include "Context.h"
+#include "Buffer.h"
+
+namespace VulkanCore
+{
+
+	LinearUniformAllocator::LinearUniformAllocator(const Context& DeviceContext, uint32_t InFramesInFlight, VkDeviceSize InFrameSize,
+												   VkDeviceSize InMaxBindingRange, const std::string& Name)
+		: FramesInFlight{InFramesInFlight}, DebugName{Name}
+	{
+		// Offsets have to satisfy both binding types so the same allocation can back either
+		const VkPhysicalDeviceLimits Limits = DeviceContext.GetPhysicalDevice().GetDeviceProperties().limits;
+		Alignment = std::max(Limits.minUniformBufferOffsetAlignment, Limits.minStorageBufferOffsetAlignment);
+
+		ASSERT(InMaxBindingRange <= Limits.maxUniformBufferRange, "Binding range is larger than the device allows for uniform buffers!");
+
+		FrameSize = (InFrameSize + Alignment - 1) & ~(Alignment - 1);
+
+		// The extra binding range at the end keeps a descriptor bound at the last offset of the last frame inside the buffer
+		const VkDeviceSize TotalSize = FrameSize * FramesInFlight + InMaxBindingRange;
+		ASSERT(TotalSize <= UINT32_MAX, "Dynamic offsets are 32 bit, linear allocator can't be larger than 4GB!");
+
+		VkBufferCreateInfo BufferInfo{};
+		BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		BufferInfo.size = TotalSize;
+		BufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		BufferInfo.pNext = VK_NULL_HANDLE;
+
+		const VmaAllocationCreateInfo AllocInfo = DeviceContext.GetMemoryPlacement().GetAllocationInfo(MemoryUsagePolicy::PerFrameDynamic, TotalSize);
+
+		UniformBuffer = std::make_shared<Buffer>(DeviceContext, DeviceContext.GetAllocator(), BufferInfo, AllocInfo, "Linear Uniforms: " + Name);
+		MappedData = static_cast<uint8_t*>(UniformBuffer->GetMappedMemory());
+
+		ASSERT(MappedData != nullptr, "Linear uniform allocator memory has to be persistently mapped!");
+	}
+
+	void LinearUniformAllocator::BeginFrame(uint32_t FrameIndex)
+	{
+		FrameBase = (FrameIndex % FramesInFlight) * FrameSize;
+		FrameOffset.store(0, std::memory_order_relaxed);
+	}
+
+	LinearAllocation LinearUniformAllocator::Allocate(VkDeviceSize Size)
+	{
+		const VkDeviceSize AlignedSize = (Size + Alignment - 1) & ~(Alignment - 1);
+		const VkDeviceSize Offset = FrameOffset.fetch_add(AlignedSize, std::memory_order_relaxed);
+
+		if(Offset + AlignedSize > FrameSize)
+		{
+			BE_ERROR("{0}: frame region of {1} bytes is full!", DebugName, FrameSize);
+			return LinearAllocation{};
+		}
+
+		LinearAllocation Allocation;
+		Allocation.Buffer = UniformBuffer->GetVkBuffer();
+		Allocation.Offset = (uint32_t)(FrameBase + Offset);
+		Allocation.MappedData = MappedData + FrameBase + Offset;
+
+		return Allocation;
+	}
+
+	void LinearUniformAllocator::FlushFrame()
+	{
+		const VkDeviceSize UsedSize = std::min(FrameOffset.load(std::memory_order_relaxed), FrameSize);
+		if(UsedSize > 0)
+		{
+			UniformBuffer->Upload(FrameBase, UsedSize);
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <atomic>
+
+namespace VulkanCore
+{
+
+class Context;
+class Buffer;
+
+struct LinearAllocation
+{
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	// Passed as the dynamic offset when binding the descriptor set, or written into a plain buffer descriptor
+	uint32_t Offset = 0;
+	void* MappedData = nullptr;
+
+	bool IsValid() const { return MappedData != nullptr; }
+};
+
+// Per-frame bump allocator for shader constants. A single persistently mapped buffer is split into one region per frame in flight,
+// the buffer is bound once as a UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC descriptor and each allocation only costs a memcpy and a dynamic offset.
+class LinearUniformAllocator final
+{
+public:
+	MOVABLE_ONLY(LinearUniformAllocator);
+
+	// MaxBindingRange is the largest range any descriptor will bind the buffer with
+	explicit LinearUniformAllocator(const Context& DeviceContext, uint32_t InFramesInFlight, VkDeviceSize InFrameSize,
+									VkDeviceSize InMaxBindingRange, const std::string& Name = "");
+
+	// Starts allocating from the frame's region, the GPU must be done with the frame that used it last
+	void BeginFrame(uint32_t FrameIndex);
+
+	// Thread safe, returns an invalid allocation if the frame's region is full
+	LinearAllocation Allocate(VkDeviceSize Size);
+
+	template<typename T>
+	LinearAllocation Write(const T& Data)
+	{
+		const LinearAllocation Allocation = Allocate(sizeof(T));
+		if(Allocation.IsValid())
+		{
+			memcpy(Allocation.MappedData, &Data, sizeof(T));
+		}
+
+		return Allocation;
+	}
+
+	// Makes the frame's writes visible to the GPU, only needed before submitting on non-coherent memory
+	void FlushFrame();
+
+	std::shared_ptr<Buffer> GetBuffer() const { return UniformBuffer; }
+	VkDeviceSize GetAlignment() const { return Alignment; }
+	VkDeviceSize GetUsedSize() const { return FrameOffset.load(std::memory_order_relaxed); }
+
+private:
+	std::shared_ptr<Buffer> UniformBuffer;
+	uint8_t* MappedData = nullptr;
+
+	uint32_t FramesInFlight = 0;
+	VkDeviceSize FrameSize = 0;
+	VkDeviceSize Alignment = 0;
+
+	VkDeviceSize FrameBase = 0;
+	std::atomic<VkDeviceSize> FrameOffset = 0;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
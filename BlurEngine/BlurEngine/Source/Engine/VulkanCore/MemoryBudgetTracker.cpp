@@ -0,0 +1,137 @@
+#include "MemoryBudgetTracker.h"
+
+#include <algorithm>
+
+namespace VulkanCore
+{
+
+	MemoryBudgetTracker::MemoryBudgetTracker(VmaAllocator InAllocator, float InPressureThreshold)
+		: Allocator{InAllocator}
+	{
+		SetPressureThreshold(InPressureThreshold);
+
+		const VkPhysicalDeviceMemoryProperties* MemoryProperties = nullptr;
+		vmaGetMemoryProperties(Allocator, &MemoryProperties);
+
+		HeapBudgets.resize(MemoryProperties->memoryHeapCount);
+		HeapsUnderPressure.resize(MemoryProperties->memoryHeapCount, false);
+
+		for(uint32_t HeapIndex = 0; HeapIndex < MemoryProperties->memoryHeapCount; HeapIndex++)
+		{
+			HeapBudgets[HeapIndex].Flags = MemoryProperties->memoryHeaps[HeapIndex].flags;
+			HeapBudgets[HeapIndex].Size = MemoryProperties->memoryHeaps[HeapIndex].size;
+		}
+	}
+
+	void MemoryBudgetTracker::Update()
+	{
+		std::vector<MemoryPressureEvent> Events;
+		MemoryPressureCallback Callback;
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+			Callback = PressureCallback;
+
+			// VMA only re-queries the budget from the driver when the frame index changes
+			vmaSetCurrentFrameIndex(Allocator, ++FrameNumber);
+
+			std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> Budgets{};
+			vmaGetHeapBudgets(Allocator, Budgets.data());
+
+			for(uint32_t HeapIndex = 0; HeapIndex < HeapBudgets.size(); HeapIndex++)
+			{
+				HeapBudget& Heap = HeapBudgets[HeapIndex];
+				Heap.Budget = Budgets[HeapIndex].budget;
+				Heap.Usage = Budgets[HeapIndex].usage;
+				Heap.AllocatedBlockBytes = Budgets[HeapIndex].statistics.blockBytes;
+				Heap.AllocationBytes = Budgets[HeapIndex].statistics.allocationBytes;
+
+				if(Heap.Budget == 0)
+				{
+					continue;
+				}
+
+				const float UsedFraction = (float)((double)Heap.Usage / (double)Heap.Budget);
+				const bool bWasUnderPressure = HeapsUnderPressure[HeapIndex];
+				const bool bUnderPressure = bWasUnderPressure ? UsedFraction > PressureThreshold - PRESSURE_HYSTERESIS : UsedFraction > PressureThreshold;
+
+				if(bUnderPressure != bWasUnderPressure)
+				{
+					HeapsUnderPressure[HeapIndex] = bUnderPressure;
+					Events.push_back({HeapIndex, Heap, bUnderPressure});
+				}
+			}
+		}
+
+		// Called without the lock so the callback can free memory, which untracks it
+		for(const MemoryPressureEvent& Event : Events)
+		{
+			if(Event.bUnderPressure)
+			{
+				BE_WARN("Memory heap {0} is under pressure: {1} MB used of a {2} MB budget", Event.HeapIndex, Event.Heap.Usage >> 20, Event.Heap.Budget >> 20);
+			}
+
+			if(Callback)
+			{
+				Callback(Event);
+			}
+		}
+	}
+
+	void MemoryBudgetTracker::TrackAllocation(MemoryCategory Category, VkDeviceSize Size)
+	{
+		CategoryUsage[(size_t)Category].fetch_add(Size, std::memory_order_relaxed);
+	}
+
+	void MemoryBudgetTracker::UntrackAllocation(MemoryCategory Category, VkDeviceSize Size)
+	{
+		CategoryUsage[(size_t)Category].fetch_sub(Size, std::memory_order_relaxed);
+	}
+
+	void MemoryBudgetTracker::SetPressureCallback(MemoryPressureCallback Callback)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		PressureCallback = std::move(Callback);
+	}
+
+	void MemoryBudgetTracker::SetPressureThreshold(float Fraction)
+	{
+		ASSERT(Fraction > 0.0f && Fraction <= 1.0f, "Memory pressure threshold has to be a fraction of the budget!");
+		PressureThreshold = std::clamp(Fraction, 0.0f, 1.0f);
+	}
+
+	void MemoryBudgetTracker::LogUsage() const
+	{
+		for(uint32_t HeapIndex = 0; HeapIndex < HeapBudgets.size(); HeapIndex++)
+		{
+			const HeapBudget& Heap = HeapBudgets[HeapIndex];
+			BE_INFO("Memory heap {0}{1}: {2} MB used of a {3} MB budget, {4} MB in VMA blocks", HeapIndex,
+					(Heap.Flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "", Heap.Usage >> 20, Heap.Budget >> 20, Heap.AllocatedBlockBytes >> 20);
+		}
+
+		for(size_t Category = 0; Category < (size_t)MemoryCategory::Count; Category++)
+		{
+			BE_INFO("    {0}: {1} KB", GetCategoryName((MemoryCategory)Category), CategoryUsage[Category].load(std::memory_order_relaxed) >> 10);
+		}
+	}
+
+	const char* MemoryBudgetTracker::GetCategoryName(MemoryCategory Category)
+	{
+		switch(Category)
+		{
+		case MemoryCategory::Textures:
+			return "Textures";
+		case MemoryCategory::Meshes:
+			return "Meshes";
+		case MemoryCategory::RenderTargets:
+			return "Render Targets";
+		case MemoryCategory::Staging:
+			return "Staging";
+		case MemoryCategory::Uniforms:
+			return "Uniforms";
+		default:
+			return "Other";
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <vma/vk_mem_alloc.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace VulkanCore
+{
+
+enum class MemoryCategory : uint8_t
+{
+	Textures,
+	Meshes,
+	RenderTargets,
+	Staging,
+	Uniforms,
+	Other,
+	Count
+};
+
+struct HeapBudget
+{
+	VkMemoryHeapFlags Flags = 0;
+	VkDeviceSize Size = 0;
+	// How much the process can allocate from the heap before the OS starts paging, reported by VK_EXT_memory_budget
+	VkDeviceSize Budget = 0;
+	// Usage of the whole process, including memory that wasn't allocated through VMA
+	VkDeviceSize Usage = 0;
+	VkDeviceSize AllocatedBlockBytes = 0;
+	VkDeviceSize AllocationBytes = 0;
+};
+
+struct MemoryPressureEvent
+{
+	uint32_t HeapIndex = 0;
+	HeapBudget Heap;
+	// False once usage dropped back below the threshold
+	bool bUnderPressure = false;
+};
+
+using MemoryPressureCallback = std::function<void(const MemoryPressureEvent&)>;
+
+// Polls the per-heap budget and usage once per frame and keeps a running total of the memory every category of resource
+// allocated. Calls the pressure callback when a heap's usage passes the configured fraction of its budget, and again once it recovered.
+class MemoryBudgetTracker final
+{
+public:
+	MOVABLE_ONLY(MemoryBudgetTracker);
+
+	explicit MemoryBudgetTracker(VmaAllocator InAllocator, float InPressureThreshold = 0.9f);
+
+	// Needs to be called once per frame
+	void Update();
+
+	void TrackAllocation(MemoryCategory Category, VkDeviceSize Size);
+	void UntrackAllocation(MemoryCategory Category, VkDeviceSize Size);
+
+	void SetPressureCallback(MemoryPressureCallback Callback);
+	// Fraction of the budget, between 0 and 1, usage has to pass before the callback is called
+	void SetPressureThreshold(float Fraction);
+
+	const std::vector<HeapBudget>& GetHeapBudgets() const { return HeapBudgets; }
+	VkDeviceSize GetCategoryUsage(MemoryCategory Category) const { return CategoryUsage[(size_t)Category].load(std::memory_order_relaxed); }
+	bool IsUnderPressure(uint32_t HeapIndex) const { return HeapIndex < HeapsUnderPressure.size() && HeapsUnderPressure[HeapIndex]; }
+
+	void LogUsage() const;
+
+	static const char* GetCategoryName(MemoryCategory Category);
+
+private:
+	VmaAllocator Allocator = VK_NULL_HANDLE;
+
+	float PressureThreshold = 0.9f;
+	MemoryPressureCallback PressureCallback;
+
+	uint32_t FrameNumber = 0;
+
+	std::vector<HeapBudget> HeapBudgets;
+	std::vector<bool> HeapsUnderPressure;
+
+	std::array<std::atomic<VkDeviceSize>, (size_t)MemoryCategory::Count> CategoryUsage{};
+
+	std::mutex Mutex;
+
+	// Heaps only leave the pressure state once usage is this far below the threshold, so the callback doesn't flip every frame
+	static constexpr float PRESSURE_HYSTERESIS = 0.05f;
+};
+
+}
\ No newline at end of file
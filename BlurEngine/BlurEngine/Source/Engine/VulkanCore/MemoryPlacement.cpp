@@ -0,0 +1,276 @@
+#include "MemoryPlacement.h"
+#include "Context.h"
+#include "Buffer.h"
+#include "CommandQueueManager.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace VulkanCore
+{
+
+	static std::string GetMemoryFlagsName(VkMemoryPropertyFlags Flags)
+	{
+		std::string Name;
+		const auto AddFlag = [&Name, Flags](VkMemoryPropertyFlags Flag, const char* FlagName)
+		{
+			if(Flags & Flag)
+			{
+				Name += Name.empty() ? FlagName : std::string(" | ") + FlagName;
+			}
+		};
+
+		AddFlag(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "DEVICE_LOCAL");
+		AddFlag(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "HOST_VISIBLE");
+		AddFlag(VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "HOST_COHERENT");
+		AddFlag(VK_MEMORY_PROPERTY_HOST_CACHED_BIT, "HOST_CACHED");
+
+		return Name.empty() ? "NONE" : Name;
+	}
+
+	MemoryPlacement::MemoryPlacement(VmaAllocator Allocator)
+	{
+		const VkPhysicalDeviceProperties* DeviceProperties = nullptr;
+		vmaGetPhysicalDeviceProperties(Allocator, &DeviceProperties);
+
+		const VkPhysicalDeviceMemoryProperties* MemoryProperties = nullptr;
+		vmaGetMemoryProperties(Allocator, &MemoryProperties);
+
+		for(uint32_t TypeIndex = 0; TypeIndex < MemoryProperties->memoryTypeCount; TypeIndex++)
+		{
+			const VkMemoryType& Type = MemoryProperties->memoryTypes[TypeIndex];
+			const VkDeviceSize HeapSize = MemoryProperties->memoryHeaps[Type.heapIndex].size;
+
+			if(Type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+			{
+				Capabilities.DeviceLocalSize = std::max(Capabilities.DeviceLocalSize, HeapSize);
+
+				if(Type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+				{
+					Capabilities.DeviceLocalHostVisibleSize = std::max(Capabilities.DeviceLocalHostVisibleSize, HeapSize);
+				}
+			}
+
+			if((Type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (Type.propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+			{
+				Capabilities.bHasHostCached = true;
+			}
+		}
+
+		bool bAllHeapsDeviceLocal = true;
+		for(uint32_t HeapIndex = 0; HeapIndex < MemoryProperties->memoryHeapCount; HeapIndex++)
+		{
+			bAllHeapsDeviceLocal &= (MemoryProperties->memoryHeaps[HeapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		}
+
+		if(DeviceProperties->deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || DeviceProperties->deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU || bAllHeapsDeviceLocal)
+		{
+			Capabilities.Architecture = MemoryArchitecture::Unified;
+		}
+		else if(Capabilities.DeviceLocalHostVisibleSize > CLASSIC_BAR_SIZE)
+		{
+			Capabilities.Architecture = MemoryArchitecture::ResizableBAR;
+		}
+		else
+		{
+			Capabilities.Architecture = MemoryArchitecture::Discrete;
+		}
+
+		BE_INFO("Memory architecture: {0}, {1} MB device local, {2} MB of it host visible", GetArchitectureName(Capabilities.Architecture),
+				Capabilities.DeviceLocalSize >> 20, Capabilities.DeviceLocalHostVisibleSize >> 20);
+	}
+
+	VmaAllocationCreateInfo MemoryPlacement::GetAllocationInfo(MemoryUsagePolicy Policy, VkDeviceSize Size) const
+	{
+		VmaAllocationCreateInfo AllocInfo{};
+
+		switch(Policy)
+		{
+		case MemoryUsagePolicy::GPUOnly:
+			AllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+			break;
+		case MemoryUsagePolicy::UploadOnce:
+			AllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+			// A discrete GPU would put it in the BAR window, which is better left to data that changes every frame
+			if(Capabilities.Architecture != MemoryArchitecture::Discrete)
+			{
+				AllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+								  VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT;
+			}
+			break;
+		case MemoryUsagePolicy::PerFrameDynamic:
+			AllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+			// Device local and host visible memory is preferred everywhere, the GPU reads it without going over PCIe
+			AllocInfo.usage = Capabilities.Architecture == MemoryArchitecture::Discrete && Size > MAX_BAR_ALLOCATION_SIZE ?
+							  VMA_MEMORY_USAGE_AUTO_PREFER_HOST : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+			break;
+		case MemoryUsagePolicy::Readback:
+			// Random access makes VMA pick cached memory, uncached reads are an order of magnitude slower
+			AllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+			AllocInfo.usage = Capabilities.Architecture == MemoryArchitecture::Unified ? VMA_MEMORY_USAGE_AUTO : VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+			break;
+		case MemoryUsagePolicy::Staging:
+			AllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+			AllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+			break;
+		}
+
+		return AllocInfo;
+	}
+
+	const char* MemoryPlacement::GetArchitectureName(MemoryArchitecture Architecture)
+	{
+		switch(Architecture)
+		{
+		case MemoryArchitecture::ResizableBAR:
+			return "Resizable BAR";
+		case MemoryArchitecture::Unified:
+			return "Unified";
+		default:
+			return "Discrete";
+		}
+	}
+
+	const char* MemoryPlacement::GetPolicyName(MemoryUsagePolicy Policy)
+	{
+		switch(Policy)
+		{
+		case MemoryUsagePolicy::GPUOnly:
+			return "GPU Only";
+		case MemoryUsagePolicy::UploadOnce:
+			return "Upload Once";
+		case MemoryUsagePolicy::PerFrameDynamic:
+			return "Per-Frame Dynamic";
+		case MemoryUsagePolicy::Staging:
+			return "Staging";
+		default:
+			return "Readback";
+		}
+	}
+
+	void MemoryPlacement::RunBenchmark(const Context& DeviceContext, CommandQueueManager& Queue, VkDeviceSize Size)
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		const VmaAllocator Allocator = DeviceContext.GetAllocator();
+		const VkDevice Device = DeviceContext.GetDevice();
+		const float TimestampPeriod = DeviceContext.GetPhysicalDevice().GetDeviceProperties().limits.timestampPeriod;
+
+		const VkPhysicalDeviceMemoryProperties* MemoryProperties = nullptr;
+		vmaGetMemoryProperties(Allocator, &MemoryProperties);
+
+		VkBufferCreateInfo BufferInfo{};
+		BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		BufferInfo.size = Size;
+		BufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		BufferInfo.pNext = VK_NULL_HANDLE;
+
+		// Copying into device local memory stands in for a shader reading the data
+		VmaAllocationCreateInfo DeviceAllocInfo{};
+		DeviceAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		Buffer DeviceBuffer(DeviceContext, Allocator, BufferInfo, DeviceAllocInfo, "Memory Benchmark: Device Local");
+
+		VkQueryPoolCreateInfo QueryPoolInfo{};
+		QueryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		QueryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		QueryPoolInfo.queryCount = 2;
+		QueryPoolInfo.pNext = VK_NULL_HANDLE;
+
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateQueryPool(Device, &QueryPoolInfo, nullptr, &QueryPool));
+
+		std::vector<uint8_t> HostData(Size, 0x5a);
+		std::vector<VkMemoryPropertyFlags> TestedFlags;
+
+		BE_INFO("Memory placement benchmark, {0} MB per test:", Size >> 20);
+
+		for(uint32_t TypeIndex = 0; TypeIndex < MemoryProperties->memoryTypeCount; TypeIndex++)
+		{
+			const VkMemoryType& Type = MemoryProperties->memoryTypes[TypeIndex];
+			const bool bAlreadyTested = std::find(TestedFlags.begin(), TestedFlags.end(), Type.propertyFlags) != TestedFlags.end();
+			if(!(Type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || bAlreadyTested)
+			{
+				continue;
+			}
+
+			TestedFlags.push_back(Type.propertyFlags);
+
+			// The classic BAR window might not have room for the test buffer
+			if(MemoryProperties->memoryHeaps[Type.heapIndex].size < Size * 2)
+			{
+				BE_INFO("    {0}: heap is too small, skipped", GetMemoryFlagsName(Type.propertyFlags));
+				continue;
+			}
+
+			VmaAllocationCreateInfo HostAllocInfo{};
+			HostAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+			HostAllocInfo.usage = VMA_MEMORY_USAGE_UNKNOWN;
+			HostAllocInfo.memoryTypeBits = 1u << TypeIndex;
+
+			Buffer HostBuffer(DeviceContext, Allocator, BufferInfo, HostAllocInfo, "Memory Benchmark: " + GetMemoryFlagsName(Type.propertyFlags));
+			uint8_t* MappedData = static_cast<uint8_t*>(HostBuffer.GetMappedMemory());
+
+			Clock::time_point Start = Clock::now();
+			memcpy(MappedData, HostData.data(), Size);
+			HostBuffer.Upload();
+			const double WriteSeconds = std::chrono::duration<double>(Clock::now() - Start).count();
+
+			VK_CHECK(vmaInvalidateAllocation(Allocator, HostBuffer.GetAllocation(), 0, VK_WHOLE_SIZE));
+			Start = Clock::now();
+			memcpy(HostData.data(), MappedData, Size);
+			const double ReadSeconds = std::chrono::duration<double>(Clock::now() - Start).count();
+
+			VkCommandBuffer CmdBuffer = Queue.BeginCmdBuffer();
+			vkCmdResetQueryPool(CmdBuffer, QueryPool, 0, 2);
+			vkCmdWriteTimestamp(CmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPool, 0);
+
+			VkBufferCopy CopyRegion{};
+			CopyRegion.size = Size;
+			vkCmdCopyBuffer(CmdBuffer, HostBuffer.GetVkBuffer(), DeviceBuffer.GetVkBuffer(), 1, &CopyRegion);
+
+			vkCmdWriteTimestamp(CmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, QueryPool, 1);
+			Queue.EndCmdBuffer(CmdBuffer);
+
+			VkSubmitInfo SubmitInfo{};
+			SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			SubmitInfo.commandBufferCount = 1;
+			SubmitInfo.pCommandBuffers = &CmdBuffer;
+			SubmitInfo.pNext = VK_NULL_HANDLE;
+
+			Queue.Submit(&SubmitInfo);
+			Queue.WaitForSubmit();
+			Queue.ToNextCmdBuffer();
+
+			std::array<uint64_t, 2> Timestamps{};
+			VK_CHECK(vkGetQueryPoolResults(Device, QueryPool, 0, 2, sizeof(Timestamps), Timestamps.data(), sizeof(uint64_t),
+										   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+			const double GPUSeconds = (double)(Timestamps[1] - Timestamps[0]) * TimestampPeriod * 1e-9;
+
+			const double SizeMB = (double)Size / (1024.0 * 1024.0);
+			BE_INFO("    {0}: CPU write {1:.0f} MB/s, CPU read {2:.0f} MB/s, GPU read {3:.0f} MB/s", GetMemoryFlagsName(Type.propertyFlags),
+					SizeMB / WriteSeconds, SizeMB / ReadSeconds, GPUSeconds > 0.0 ? SizeMB / GPUSeconds : 0.0);
+		}
+
+		vkDestroyQueryPool(Device, QueryPool, nullptr);
+
+		// What each policy ends up with on this device, to compare against the numbers above
+		const MemoryPlacement& Placement = DeviceContext.GetMemoryPlacement();
+		for(MemoryUsagePolicy Policy : {MemoryUsagePolicy::GPUOnly, MemoryUsagePolicy::UploadOnce, MemoryUsagePolicy::PerFrameDynamic, MemoryUsagePolicy::Readback,
+										 MemoryUsagePolicy::Staging})
+		{
+			const VmaAllocationCreateInfo PolicyAllocInfo = Placement.GetAllocationInfo(Policy, 64 * 1024);
+
+			BufferInfo.size = 64 * 1024;
+			Buffer PolicyBuffer(DeviceContext, Allocator, BufferInfo, PolicyAllocInfo, "Memory Benchmark: Policy");
+
+			VkMemoryPropertyFlags PolicyFlags = 0;
+			vmaGetAllocationMemoryProperties(Allocator, PolicyBuffer.GetAllocation(), &PolicyFlags);
+			BE_INFO("    {0} uses {1}", GetPolicyName(Policy), GetMemoryFlagsName(PolicyFlags));
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <vma/vk_mem_alloc.h>
+
+namespace VulkanCore
+{
+
+class Context;
+class CommandQueueManager;
+
+enum class MemoryUsagePolicy : uint8_t
+{
+	// Only ever written by the GPU or through a copy, render targets, geometry pools, textures
+	GPUOnly,
+	// Written once by the CPU and only read by the GPU afterwards. Mapped directly when all of device local memory is host visible,
+	// staged otherwise.
+	UploadOnce,
+	// Rewritten by the CPU every frame and read by the GPU in the same frame, uniforms and per-draw data
+	PerFrameDynamic,
+	// Written by the GPU and read on the CPU
+	Readback,
+	// Written sequentially by the CPU and only read by copies, kept in system memory so it doesn't take up VRAM
+	Staging
+};
+
+enum class MemoryArchitecture : uint8_t
+{
+	// Device local memory is only reachable through copies or the small BAR window
+	Discrete,
+	// All of device local memory can be mapped (resizable BAR / smart access memory)
+	ResizableBAR,
+	// CPU and GPU share the same memory, integrated GPUs and software rasterizers like lavapipe
+	Unified
+};
+
+struct MemoryCapabilities
+{
+	MemoryArchitecture Architecture = MemoryArchitecture::Discrete;
+	VkDeviceSize DeviceLocalSize = 0;
+	// Size of the largest heap that is both device local and host visible, 0 if there is none
+	VkDeviceSize DeviceLocalHostVisibleSize = 0;
+	bool bHasHostCached = false;
+};
+
+// Picks where buffers live based on how they are used and what memory the device has. Without it everything host visible
+// ends up in system memory, which is the slowest place for the GPU to read per-draw data from on a discrete GPU.
+class MemoryPlacement final
+{
+public:
+	MOVABLE_ONLY(MemoryPlacement);
+
+	MemoryPlacement() = default;
+	explicit MemoryPlacement(VmaAllocator Allocator);
+
+	// PerFrameDynamic, Readback and Staging allocations are always persistently mapped. UploadOnce allocations are never mapped on
+	// discrete GPUs and can still end up in memory the CPU can't see elsewhere, Buffer::IsHostVisible tells whether they need a staging copy.
+	VmaAllocationCreateInfo GetAllocationInfo(MemoryUsagePolicy Policy, VkDeviceSize Size) const;
+
+	const MemoryCapabilities& GetCapabilities() const { return Capabilities; }
+
+	static const char* GetArchitectureName(MemoryArchitecture Architecture);
+	static const char* GetPolicyName(MemoryUsagePolicy Policy);
+
+	// Measures CPU write, CPU read and GPU read bandwidth for every kind of host visible memory on the device and logs the results.
+	// Waits on the queue, so it's only meant to be run during startup.
+	static void RunBenchmark(const Context& DeviceContext, CommandQueueManager& Queue, VkDeviceSize Size = 64 * 1024 * 1024);
+
+private:
+	MemoryCapabilities Capabilities;
+
+	// The BAR window without resizable BAR, anything larger that is host visible means all of VRAM is mappable
+	static constexpr VkDeviceSize CLASSIC_BAR_SIZE = 256 * 1024 * 1024;
+	// Per-frame buffers larger than this stay in system memory on discrete GPUs so they don't crowd the driver out of the BAR window
+	static constexpr VkDeviceSize MAX_BAR_ALLOCATION_SIZE = 32 * 1024 * 1024;
+};
+
+}
\ No newline at end of file
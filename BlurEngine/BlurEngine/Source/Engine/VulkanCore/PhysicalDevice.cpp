@@ -2,6 +2,7 @@
 #include "Utility.h"
 
 #include <set>
+#include <cstring>
 
 namespace VulkanCore
 {
@@ -20,6 +21,14 @@ namespace VulkanCore
 
 			std::vector<VkExtensionProperties> Properties(PropertyCount);
 			vkEnumerateDeviceExtensionProperties(VulkanPhysicalDevice, nullptr, &PropertyCount, Properties.data());
+
+			for(const VkExtensionProperties& Extension : Properties)
+			{
+				if(strcmp(Extension.extensionName, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME) == 0)
+				{
+					bDescriptorBufferExtension = true;
+				}
+			}
 		}
 
 		{
@@ -162,7 +171,10 @@ namespace VulkanCore
 		MultiviewFeature.pNext = &FragmentDensityMapFeature;
 
 		FragmentDensityMapFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_FEATURES_EXT;
-		FragmentDensityMapFeature.pNext = nullptr;
+		FragmentDensityMapFeature.pNext = &DescriptorBufferFeature;
+
+		DescriptorBufferFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+		DescriptorBufferFeature.pNext = nullptr;
 
 		vkGetPhysicalDeviceFeatures2(VulkanPhysicalDevice, &Features);
 	}
@@ -176,7 +188,10 @@ namespace VulkanCore
 		RayTracingPipelineProperties.pNext = &FragmentDensityMapProperties;
 
 		FragmentDensityMapProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_PROPERTIES_EXT;
-		FragmentDensityMapProperties.pNext = nullptr;
+		FragmentDensityMapProperties.pNext = &DescriptorBufferProperties;
+
+		DescriptorBufferProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+		DescriptorBufferProperties.pNext = nullptr;
 
 		vkGetPhysicalDeviceProperties2(VulkanPhysicalDevice, &Properties);
 	}
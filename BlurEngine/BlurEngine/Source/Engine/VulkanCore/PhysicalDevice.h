@@ -25,6 +25,9 @@ namespace VulkanCore
 		bool IsRayTracingSupported() const;
 		bool IsMultiviewSupported() const { return MultiviewFeature.multiview; }
 		bool IsFragmentDensityMapSupported() const { return FragmentDensityMapFeature.fragmentDensityMap == VK_TRUE; }
+		bool IsDescriptorBufferSupported() const { return bDescriptorBufferExtension && DescriptorBufferFeature.descriptorBuffer == VK_TRUE; }
+
+		const VkPhysicalDeviceDescriptorBufferPropertiesEXT& GetDescriptorBufferProperties() const { return DescriptorBufferProperties; }
 
 		std::optional<uint32_t> GetComputeFamilyIndex() const { return ComputeFamilyIndex; }
 		std::optional<uint32_t> GetGraphicsFamilyIndex() const { return GraphicsFamilyIndex; }
@@ -55,10 +58,12 @@ namespace VulkanCore
 		// Properties
 		VkPhysicalDeviceFragmentDensityMapPropertiesEXT FragmentDensityMapProperties;
 		VkPhysicalDeviceRayTracingPipelinePropertiesKHR RayTracingPipelineProperties;
+		VkPhysicalDeviceDescriptorBufferPropertiesEXT DescriptorBufferProperties;
 		VkPhysicalDeviceProperties2 Properties;
 
 		// Features
 		VkPhysicalDeviceFragmentDensityMapFeaturesEXT FragmentDensityMapFeature;
+		VkPhysicalDeviceDescriptorBufferFeaturesEXT DescriptorBufferFeature;
 		VkPhysicalDeviceMultiviewFeatures MultiviewFeature;
 		VkPhysicalDeviceTimelineSemaphoreFeatures TimelineSemaphoreFeature;
 		VkPhysicalDeviceMeshShaderFeaturesNV MeshShaderFeature;
@@ -70,6 +75,9 @@ namespace VulkanCore
 		VkPhysicalDeviceVulkan12Features Features12;
 		VkPhysicalDeviceFeatures2 Features;
 
+		// Optional extensions
+		bool bDescriptorBufferExtension = false;
+
 		// Memory properties
 		VkPhysicalDeviceMemoryProperties2 MemoryProperties;
 
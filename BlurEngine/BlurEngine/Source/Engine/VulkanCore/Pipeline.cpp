@@ -3,20 +3,44 @@
 #include "Sampler.h"
 #include "Texture.h"
 #include "Buffer.h"
+#include "DescriptorBuffer.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace VulkanCore
 {
-	static constexpr int MAX_DESCRIPTOR_SETS = 4096 * 3;
-	
 	Pipeline::Pipeline(const Context& DeviceContext, const GraphicsPipelineDescriptor& Desc, VkRenderPass Pass, const std::string& Name)
-		: VulkanDevice {DeviceContext.GetDevice()}, GraphicsPipelineDesc{Desc}, BindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS}, VulkanRenderPass{Pass}, DebugName{Name}
+		: VulkanDevice {DeviceContext.GetDevice()}, GraphicsPipelineDesc{Desc}, BindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS}, VulkanRenderPass{Pass}, 
+		  VulkanPipelineCache{DeviceContext.GetPipelineCache()->GetVkPipelineCache()}, Descriptors{DeviceContext.GetDescriptorAllocator()},
+		  ScratchArena{std::make_unique<uint8_t[]>(SCRATCH_ARENA_SIZE)}, ScratchCapacity{SCRATCH_ARENA_SIZE}, DebugName{Name}
 	{
+		PendingWrites.reserve(INITIAL_PENDING_WRITES);
+		WriteDescSets.reserve(INITIAL_PENDING_WRITES);
+		WriteOrder.reserve(INITIAL_PENDING_WRITES);
+
+		if(DeviceContext.IsDescriptorBufferEnabled())
+		{
+			DescBuffer = std::make_unique<DescriptorBuffer>(DeviceContext, Name);
+		}
+
 		CreateGraphicsPipeline();
 	}
 
 	Pipeline::Pipeline(const Context& DeviceContext, const ComputePipelineDescriptor& Desc, const std::string& Name)
-		: VulkanDevice {DeviceContext.GetDevice()}, ComputePipelineDesc{Desc}, BindPoint{VK_PIPELINE_BIND_POINT_COMPUTE}, DebugName{Name}
+		: VulkanDevice {DeviceContext.GetDevice()}, ComputePipelineDesc{Desc}, BindPoint{VK_PIPELINE_BIND_POINT_COMPUTE}, 
+		  VulkanPipelineCache{DeviceContext.GetPipelineCache()->GetVkPipelineCache()}, Descriptors{DeviceContext.GetDescriptorAllocator()},
+		  ScratchArena{std::make_unique<uint8_t[]>(SCRATCH_ARENA_SIZE)}, ScratchCapacity{SCRATCH_ARENA_SIZE}, DebugName{Name}
 	{
+		PendingWrites.reserve(INITIAL_PENDING_WRITES);
+		WriteDescSets.reserve(INITIAL_PENDING_WRITES);
+		WriteOrder.reserve(INITIAL_PENDING_WRITES);
+
+		if(DeviceContext.IsDescriptorBufferEnabled())
+		{
+			DescBuffer = std::make_unique<DescriptorBuffer>(DeviceContext, Name);
+		}
+
 		CreateComputePipeline();
 	}
 
@@ -24,252 +48,436 @@ namespace VulkanCore
 	{
 		vkDestroyPipeline(VulkanDevice, VulkanPipeline, nullptr);
 		vkDestroyPipelineLayout(VulkanDevice, VulkanPipelineLayout, nullptr);
-		vkDestroyDescriptorPool(VulkanDevice, VulkanDescriptorPool, nullptr);
 
-		for(const std::pair<uint32_t, DescriptorSet> Set : DescriptorSets)
+		// Layouts belong to the descriptor allocator and can be shared with other pipelines
+		for(const std::pair<const uint32_t, DescriptorSet>& Set : DescriptorSets)
 		{
-			vkDestroyDescriptorSetLayout(VulkanDevice, Set.second.Layout, nullptr);
+			// Empty when the pipeline uses a descriptor buffer
+			for(size_t Index = 0; Index < Set.second.Sets.size(); Index++)
+			{
+				// Frame sets don't have a pool, they are recycled with their frame
+				if(Set.second.Pools[Index] != VK_NULL_HANDLE)
+				{
+					Descriptors->Free(Set.second.Sets[Index], Set.second.Pools[Index]);
+				}
+			}
+
+			vkDestroyDescriptorUpdateTemplate(VulkanDevice, Set.second.SetTemplate, nullptr);
 		}
 	}
 
 	void Pipeline::Bind(VkCommandBuffer CmdBuffer)
 	{
 		vkCmdBindPipeline(CmdBuffer, BindPoint, VulkanPipeline);
+
+		if(DescBuffer)
+		{
+			// Rebound every time, another pipeline may have bound its own descriptor buffer in between
+			DescBuffer->Bind(CmdBuffer);
+			return;
+		}
+
 		UpdateDescriptorSets();
 	}
 
+	void Pipeline::BindDescriptorSet(VkCommandBuffer CmdBuffer, uint32_t Set, uint32_t Index, std::span<const uint32_t> DynamicOffsets)
+	{
+		if(DescBuffer)
+		{
+			ASSERT(DynamicOffsets.empty(), "Pipelines using a descriptor buffer don't have dynamic buffers");
+			DescBuffer->SetOffsets(CmdBuffer, BindPoint, VulkanPipelineLayout, Set, Index);
+			return;
+		}
+
+		ASSERT(DescriptorSets.contains(Set) && Index < DescriptorSets[Set].Sets.size(), "Descriptor set was not allocated before binding");
+		vkCmdBindDescriptorSets(CmdBuffer, BindPoint, VulkanPipelineLayout, Set, 1, &DescriptorSets[Set].Sets[Index], 
+								(uint32_t)DynamicOffsets.size(), DynamicOffsets.data());
+	}
+
 	void Pipeline::UpdateDescriptorSets()
 	{
-		if(!WriteDescSets.empty())
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(PendingWrites.empty())
+		{
+			return;
+		}
+
+		// Writes to different sets don't affect each other, so they are grouped by set. The sort is stable within a set since
+		// ties are broken by queue order, a later write to the same descriptors still wins.
+		WriteOrder.resize(PendingWrites.size());
+		for(uint32_t Index = 0; Index < WriteOrder.size(); Index++)
 		{
-			std::unique_lock<std::mutex> MutexLock(Mutex);
-			vkUpdateDescriptorSets(VulkanDevice, WriteDescSets.size(), WriteDescSets.data(), 0, nullptr);
+			WriteOrder[Index] = Index;
+		}
 
+		std::sort(WriteOrder.begin(), WriteOrder.end(), [this](uint32_t A, uint32_t B)
+		{
+			return PendingWrites[A].DstSet != PendingWrites[B].DstSet ? PendingWrites[A].DstSet < PendingWrites[B].DstSet : A < B;
+		});
+
+		for(size_t GroupStart = 0; GroupStart < WriteOrder.size();)
+		{
+			size_t GroupEnd = GroupStart + 1;
+			while(GroupEnd < WriteOrder.size() && PendingWrites[WriteOrder[GroupEnd]].DstSet == PendingWrites[WriteOrder[GroupStart]].DstSet)
+			{
+				GroupEnd++;
+			}
+
+			const std::span<const uint32_t> SetWrites(WriteOrder.data() + GroupStart, GroupEnd - GroupStart);
+			GroupStart = GroupEnd;
+
+			if(UpdateWithSetTemplate(SetWrites))
+			{
+				continue;
+			}
+
+			for(uint32_t WriteIndex : SetWrites)
+			{
+				const PendingDescriptorWrite& Pending = PendingWrites[WriteIndex];
+				const uint8_t* Data = ScratchArena.get() + Pending.DataOffset;
+				const DescriptorInfoType InfoType = GetDescriptorInfoType(Pending.Type);
+
+				VkWriteDescriptorSet WriteDescSet{};
+				WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				WriteDescSet.dstSet = Pending.DstSet;
+				WriteDescSet.dstBinding = Pending.Binding;
+				WriteDescSet.dstArrayElement = Pending.DstArrayElement;
+				WriteDescSet.descriptorCount = Pending.Count;
+				WriteDescSet.descriptorType = Pending.Type;
+				WriteDescSet.pImageInfo = InfoType == DescriptorInfoType::Image ? reinterpret_cast<const VkDescriptorImageInfo*>(Data) : VK_NULL_HANDLE;
+				WriteDescSet.pBufferInfo = InfoType == DescriptorInfoType::Buffer ? reinterpret_cast<const VkDescriptorBufferInfo*>(Data) : VK_NULL_HANDLE;
+				WriteDescSet.pTexelBufferView = InfoType == DescriptorInfoType::TexelBuffer ? reinterpret_cast<const VkBufferView*>(Data) : VK_NULL_HANDLE;
+				WriteDescSet.pNext = VK_NULL_HANDLE;
+
+				WriteDescSets.push_back(WriteDescSet);
+			}
+		}
+
+		if(!WriteDescSets.empty())
+		{
+			vkUpdateDescriptorSets(VulkanDevice, (uint32_t)WriteDescSets.size(), WriteDescSets.data(), 0, nullptr);
 			WriteDescSets.clear();
-			BufferInfos.clear();
-			BufferViewInfos.clear();
-			ImageInfos.clear();
 		}
+
+		PendingWrites.clear();
+		ScratchUsed = 0;
 	}
 
-	void Pipeline::AllocateDescriptors(const std::vector<SetAllocInfo> AllocInfos)
+	bool Pipeline::UpdateWithSetTemplate(std::span<const uint32_t> SetWrites)
 	{
-		if(VulkanDescriptorPool == VK_NULL_HANDLE)
+		auto SetItr = DescriptorSets.find(PendingWrites[SetWrites[0]].Set);
+		if(SetItr == DescriptorSets.end() || SetItr->second.SetTemplate == VK_NULL_HANDLE)
+		{
+			return false;
+		}
+
+		const DescriptorSet& DstSet = SetItr->second;
+
+		// Only writes that cover a whole binding can be placed into the template's data, any other write and the set is written the normal way
+		CoveredBindings.assign(DstSet.TemplateEntries.size(), false);
+		for(uint32_t WriteIndex : SetWrites)
+		{
+			const PendingDescriptorWrite& Pending = PendingWrites[WriteIndex];
+			if(Pending.Binding >= DstSet.TemplateEntries.size())
+			{
+				return false;
+			}
+
+			const DescriptorTemplateEntry& Entry = DstSet.TemplateEntries[Pending.Binding];
+			if(Pending.DstArrayElement != 0 || Entry.Type != Pending.Type || Entry.DescriptorCount != Pending.Count)
+			{
+				return false;
+			}
+
+			CoveredBindings[Pending.Binding] = true;
+		}
+
+		for(size_t Binding = 0; Binding < DstSet.TemplateEntries.size(); Binding++)
 		{
-			InitDescriptorPool();
+			// Bindings the layout doesn't have aren't part of the template
+			if(DstSet.TemplateEntries[Binding].DescriptorCount > 0 && !CoveredBindings[Binding])
+			{
+				return false;
+			}
+		}
+
+		if(TemplateData.size() < DstSet.TemplateDataSize)
+		{
+			TemplateData.resize(DstSet.TemplateDataSize);
+		}
+
+		// In queue order, a binding written twice ends up with its last write
+		for(uint32_t WriteIndex : SetWrites)
+		{
+			const PendingDescriptorWrite& Pending = PendingWrites[WriteIndex];
+			const DescriptorTemplateEntry& Entry = DstSet.TemplateEntries[Pending.Binding];
+			memcpy(TemplateData.data() + Entry.Offset, ScratchArena.get() + Pending.DataOffset, Pending.Count * GetDescriptorInfoSize(GetDescriptorInfoType(Pending.Type)));
 		}
 
+		vkUpdateDescriptorSetWithTemplate(VulkanDevice, PendingWrites[SetWrites[0]].DstSet, DstSet.SetTemplate, TemplateData.data());
+		return true;
+	}
+
+	void Pipeline::AllocateDescriptors(const std::vector<SetAllocInfo> AllocInfos)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
 		for(SetAllocInfo AllocInfo : AllocInfos)
 		{
 			ASSERT(DescriptorSets.contains(AllocInfo.SetIndex), "This pipeline doesn't have a set with index " + std::to_string(AllocInfo.SetIndex));
 
-			VkDescriptorSetAllocateInfo DescAllocInfo{};
-			DescAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			DescAllocInfo.descriptorPool = VulkanDescriptorPool;
-			DescAllocInfo.descriptorSetCount = 1;
-			DescAllocInfo.pSetLayouts = &DescriptorSets[AllocInfo.SetIndex].Layout;
+			if(DescBuffer)
+			{
+				DescBuffer->AllocateSets(AllocInfo.SetIndex, AllocInfo.Count);
+				continue;
+			}
+
+			DescriptorSet& DstSet = DescriptorSets[AllocInfo.SetIndex];
 
 			for(uint32_t i = 0; i < AllocInfo.Count; i++)
 			{
-				VkDescriptorSet DescSet{VK_NULL_HANDLE};
-				VK_CHECK(vkAllocateDescriptorSets(VulkanDevice, &DescAllocInfo, &DescSet));
-
-				DescriptorSets[AllocInfo.SetIndex].Sets.push_back(DescSet);
+				VkDescriptorPool Pool = VK_NULL_HANDLE;
+				DstSet.Sets.push_back(Descriptors->Allocate(DstSet.Layout, Pool));
+				DstSet.Pools.push_back(Pool);
 			}
 		}
 	}
 
-	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::shared_ptr<Buffer> InBuffer, uint32_t Offset,
-		uint32_t Size, VkDescriptorType Type, VkFormat Format)
+	uint32_t Pipeline::AllocateFrameSet(uint32_t Set, uint32_t FrameIndex)
 	{
-		std::vector<VkDescriptorBufferInfo> NewBufferInfos = { {InBuffer->GetVkBuffer(), Offset, Size} };
-		BufferInfos.emplace_back(NewBufferInfos);
+		// Resizing the set's arrays would move them under a BindResource running on another thread
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-		const bool bTexelBuffer = Type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER || Type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
-		if (bTexelBuffer)
+		ASSERT(DescriptorSets.contains(Set), "This pipeline doesn't have a set with index " + std::to_string(Set));
+
+		if(DescBuffer)
 		{
-			ASSERT(Format != VK_FORMAT_UNDEFINED, "Format must be specified for texel buffer");
-			BufferViewInfos.emplace_back(InBuffer->RequestBufferView(Format));
+			// Descriptor buffer sets can't be recycled, every frame keeps its own
+			while(!DescBuffer->IsAllocated(Set, FrameIndex))
+			{
+				DescBuffer->AllocateSets(Set, 1);
+			}
+
+			return FrameIndex;
 		}
 
-		VkDescriptorSet& DstSet = DescriptorSets[Set].Sets[Index];
-		ASSERT(DstSet != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+		DescriptorSet& DstSet = DescriptorSets[Set];
+		if(FrameIndex >= DstSet.Sets.size())
+		{
+			DstSet.Sets.resize(FrameIndex + 1, VK_NULL_HANDLE);
+			DstSet.Pools.resize(FrameIndex + 1, VK_NULL_HANDLE);
+		}
 
-		VkWriteDescriptorSet WriteDescSet{};
-		WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		WriteDescSet.dstSet = DstSet;
-		WriteDescSet.dstBinding = Binding;
-		WriteDescSet.dstArrayElement = 0;
-		WriteDescSet.descriptorCount = 1;
-		WriteDescSet.descriptorType = Type;
-		WriteDescSet.pImageInfo = VK_NULL_HANDLE;
-		WriteDescSet.pBufferInfo = bTexelBuffer ? VK_NULL_HANDLE : BufferInfos.back().data();
-		WriteDescSet.pTexelBufferView = bTexelBuffer ? &BufferViewInfos.back() : VK_NULL_HANDLE;
-		WriteDescSet.pNext = VK_NULL_HANDLE;
+		ASSERT(DstSet.Pools[FrameIndex] == VK_NULL_HANDLE, "Frame sets can't share a set index with persistent sets");
 
-		WriteDescSets.emplace_back(std::move(WriteDescSet));
+		// Last time's set went back to the frame's pool when the frame began
+		DstSet.Sets[FrameIndex] = Descriptors->AllocateFrameSet(DstSet.Layout);
+		return FrameIndex;
 	}
 
-	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<std::shared_ptr<Texture>> Textures,
-								std::shared_ptr<Sampler> InSampler, uint32_t DstArrayElement)
+	void Pipeline::ReleaseRetiredDescriptors(CommandQueueManager& Queue)
 	{
-		if(Textures.size() == 0)
+		if(DescBuffer)
 		{
-			BE_ERROR("Empty texure array provided when binding resource!");
-			return;
+			DescBuffer->ReleaseRetiredBuffers(Queue);
 		}
+	}
 
-		std::unique_lock<std::mutex> MutexLock(Mutex);
+	VkDescriptorSetLayout Pipeline::GetDescriptorSetLayout(uint32_t Set) const
+	{
+		if(DescBuffer)
+		{
+			return VK_NULL_HANDLE;
+		}
+
+		auto Itr = DescriptorSets.find(Set);
+		return Itr != DescriptorSets.end() ? Itr->second.Layout : VK_NULL_HANDLE;
+	}
 
-		ImageInfos.push_back(std::vector<VkDescriptorImageInfo>());
-		ImageInfos.back().reserve(Textures.size());
+	template<typename T>
+	size_t Pipeline::AllocateScratch(uint32_t Count)
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t), "Scratch arena can't align descriptor infos");
+
+		const size_t Offset = (ScratchUsed + alignof(T) - 1) & ~(alignof(T) - 1);
+		const size_t NewUsed = Offset + sizeof(T) * Count;
 
-		for(const std::shared_ptr<Texture> Tex : Textures)
+		if(NewUsed > ScratchCapacity)
 		{
-			if(Tex)
+			// Only happens if a frame queues more than the arena holds, the arena keeps its new size from then on
+			size_t NewCapacity = ScratchCapacity * 2;
+			while(NewCapacity < NewUsed)
 			{
-				VkDescriptorImageInfo ImageInfo;
-				ImageInfo.sampler = InSampler ? InSampler->GetVkSampler() : VK_NULL_HANDLE;
-				ImageInfo.imageView = Tex->GetImageView(0);
-				ImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-				ImageInfos.back().emplace_back(ImageInfo);
+				NewCapacity *= 2;
 			}
+
+			BE_WARN("{0}: descriptor scratch arena grown from {1} KB to {2} KB", DebugName, ScratchCapacity >> 10, NewCapacity >> 10);
+
+			std::unique_ptr<uint8_t[]> NewArena = std::make_unique<uint8_t[]>(NewCapacity);
+			memcpy(NewArena.get(), ScratchArena.get(), ScratchUsed);
+
+			ScratchArena = std::move(NewArena);
+			ScratchCapacity = NewCapacity;
 		}
 
-		if(ImageInfos.back().size() == 0)
+		ScratchUsed = NewUsed;
+		return Offset;
+	}
+
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, const std::shared_ptr<Buffer>& InBuffer, uint32_t Offset,
+		uint32_t Size, VkDescriptorType Type, VkFormat Format)
+	{
+		const bool bTexelBuffer = GetDescriptorInfoType(Type) == DescriptorInfoType::TexelBuffer;
+		ASSERT(!bTexelBuffer || Format != VK_FORMAT_UNDEFINED, "Format must be specified for texel buffer");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(bTexelBuffer && DescBuffer)
 		{
-			BE_ERROR("No image infos allocated!");
+			// Descriptor buffers take the buffer's address and format directly, no buffer view is needed
+			DescBuffer->WriteTexelBuffer(Set, Index, Binding, 0, Type, InBuffer->GetVkBuffer(), Offset, Size, Format);
 			return;
 		}
 
-		ASSERT(DescriptorSets[Set].Sets[Index] != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+		if(bTexelBuffer)
+		{
+			const size_t DataOffset = AllocateScratch<VkBufferView>(1);
+			*GetScratch<VkBufferView>(DataOffset) = InBuffer->RequestBufferView(Format);
+
+			QueueWrite(Set, Binding, Index, 0, 1, Type, DataOffset);
+			return;
+		}
 
-		VkWriteDescriptorSet WriteDescSet{};
-		WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		WriteDescSet.dstSet = DescriptorSets[Set].Sets[Index];
-		WriteDescSet.dstBinding = Binding;
-		WriteDescSet.descriptorCount = static_cast<uint32_t>(ImageInfos.back().size());
-		WriteDescSet.descriptorType = InSampler ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		WriteDescSet.pImageInfo = ImageInfos.back().data();
-		WriteDescSet.pBufferInfo = VK_NULL_HANDLE;
-		WriteDescSet.pTexelBufferView = VK_NULL_HANDLE;
-		WriteDescSet.pNext = VK_NULL_HANDLE;
+		const size_t DataOffset = AllocateScratch<VkDescriptorBufferInfo>(1);
+		*GetScratch<VkDescriptorBufferInfo>(DataOffset) = {InBuffer->GetVkBuffer(), Offset, Size};
 
-		WriteDescSets.emplace_back(std::move(WriteDescSet));
+		QueueWrite(Set, Binding, Index, 0, 1, Type, DataOffset);
 	}
 
-	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<std::shared_ptr<Sampler>> Samplers)
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const std::shared_ptr<Texture>> Textures,
+								const Sampler* InSampler, uint32_t DstArrayElement)
 	{
-		if (Samplers.size() == 0)
+		if(Textures.size() == 0)
 		{
-			BE_ERROR("Empty sampler array provided when binding resource!");
+			BE_ERROR("Empty texure array provided when binding resource!");
 			return;
 		}
 
-		ImageInfos.push_back(std::vector<VkDescriptorImageInfo>());
-		ImageInfos.back().reserve(Samplers.size());
+		const VkDescriptorType Type = InSampler ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		const VkSampler VulkanSampler = InSampler ? InSampler->GetVkSampler() : VK_NULL_HANDLE;
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-		for (std::shared_ptr<Sampler> CurrentSampler : Samplers)
+		// Null textures leave their element untouched, every run of valid textures is written to the elements it was given
+		bool bWroteAny = false;
+		size_t RunStart = 0;
+		while(RunStart < Textures.size())
 		{
-			VkDescriptorImageInfo ImageInfo;
-			ImageInfo.sampler = CurrentSampler->GetVkSampler();
+			if(!Textures[RunStart])
+			{
+				RunStart++;
+				continue;
+			}
 
-			ImageInfos.back().emplace_back(ImageInfo);
-		}
+			size_t RunEnd = RunStart;
+			while(RunEnd < Textures.size() && Textures[RunEnd])
+			{
+				RunEnd++;
+			}
+
+			const uint32_t RunCount = static_cast<uint32_t>(RunEnd - RunStart);
+			const size_t DataOffset = AllocateScratch<VkDescriptorImageInfo>(RunCount);
+			VkDescriptorImageInfo* ImageInfos = GetScratch<VkDescriptorImageInfo>(DataOffset);
+
+			for(uint32_t i = 0; i < RunCount; i++)
+			{
+				ImageInfos[i].sampler = VulkanSampler;
+				ImageInfos[i].imageView = Textures[RunStart + i]->GetImageView(0);
+				ImageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			}
 
-		ASSERT(DescriptorSets[Set].Sets[Index] != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+			QueueWrite(Set, Binding, Index, DstArrayElement + static_cast<uint32_t>(RunStart), RunCount, Type, DataOffset);
 
-		VkWriteDescriptorSet WriteDescSet{};
-		WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		WriteDescSet.dstSet = DescriptorSets[Set].Sets[Index];
-		WriteDescSet.dstBinding = Binding;
-		WriteDescSet.dstArrayElement = 0;
-		WriteDescSet.descriptorCount = static_cast<uint32_t>(ImageInfos.back().size());
-		WriteDescSet.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-		WriteDescSet.pImageInfo = ImageInfos.back().data();
-		WriteDescSet.pBufferInfo = VK_NULL_HANDLE;
-		WriteDescSet.pTexelBufferView = VK_NULL_HANDLE;
-		WriteDescSet.pNext = VK_NULL_HANDLE;
+			bWroteAny = true;
+			RunStart = RunEnd;
+		}
 
-		WriteDescSets.emplace_back(std::move(WriteDescSet));
+		if(!bWroteAny)
+		{
+			BE_ERROR("No image infos allocated!");
+		}
 	}
 
-void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<std::shared_ptr<VkImageView>> ImageViews, VkDescriptorType Type)
-{
-	if (ImageViews.size() == 0)
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const Sampler> Samplers, uint32_t DstArrayElement)
 	{
-		BE_ERROR("Empty Image View array provided when binding resource!");
-		return;
-	}
+		if (Samplers.size() == 0)
+		{
+			BE_ERROR("Empty sampler array provided when binding resource!");
+			return;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-	ImageInfos.push_back(std::vector<VkDescriptorImageInfo>());
-	ImageInfos.back().reserve(ImageViews.size());
+		const size_t DataOffset = AllocateScratch<VkDescriptorImageInfo>(static_cast<uint32_t>(Samplers.size()));
+		VkDescriptorImageInfo* ImageInfos = GetScratch<VkDescriptorImageInfo>(DataOffset);
 
-	for (std::shared_ptr<VkImageView> ImageView : ImageViews)
-	{
-		VkDescriptorImageInfo ImageInfo;
-		ImageInfo.imageView = *ImageView;
+		for (size_t i = 0; i < Samplers.size(); i++)
+		{
+			ImageInfos[i] = {};
+			ImageInfos[i].sampler = Samplers[i].GetVkSampler();
+		}
 
-		ImageInfos.back().emplace_back(ImageInfo);
+		QueueWrite(Set, Binding, Index, DstArrayElement, static_cast<uint32_t>(Samplers.size()), VK_DESCRIPTOR_TYPE_SAMPLER, DataOffset);
 	}
 
-	ASSERT(DescriptorSets[Set].Sets[Index] != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const std::shared_ptr<VkImageView>> ImageViews, VkDescriptorType Type)
+	{
+		if (ImageViews.size() == 0)
+		{
+			BE_ERROR("Empty Image View array provided when binding resource!");
+			return;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-	VkWriteDescriptorSet WriteDescSet{};
-	WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	WriteDescSet.dstSet = DescriptorSets[Set].Sets[Index];
-	WriteDescSet.dstBinding = Binding;
-	WriteDescSet.dstArrayElement = 0;
-	WriteDescSet.descriptorCount = static_cast<uint32_t>(ImageInfos.back().size());
-	WriteDescSet.descriptorType = Type;
-	WriteDescSet.pImageInfo = ImageInfos.back().data();
-	WriteDescSet.pBufferInfo = VK_NULL_HANDLE;
-	WriteDescSet.pTexelBufferView = VK_NULL_HANDLE;
-	WriteDescSet.pNext = VK_NULL_HANDLE;
+		const size_t DataOffset = AllocateScratch<VkDescriptorImageInfo>(static_cast<uint32_t>(ImageViews.size()));
+		VkDescriptorImageInfo* ImageInfos = GetScratch<VkDescriptorImageInfo>(DataOffset);
 
-	WriteDescSets.emplace_back(std::move(WriteDescSet));
-}
+		for (size_t i = 0; i < ImageViews.size(); i++)
+		{
+			ImageInfos[i] = {};
+			ImageInfos[i].imageView = *ImageViews[i];
+			ImageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		}
 
-void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::vector<std::shared_ptr<Buffer>> Buffers, VkDescriptorType Type)
-{
-	if (Buffers.size() == 0)
-	{
-		BE_ERROR("Empty buffer array provided when binding resource!");
-		return;
+		QueueWrite(Set, Binding, Index, 0, static_cast<uint32_t>(ImageViews.size()), Type, DataOffset);
 	}
 
-	std::vector<VkDescriptorBufferInfo> BufferDescInfos;
-	for (std::shared_ptr<Buffer> Buff : Buffers)
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const std::shared_ptr<Buffer>> Buffers, VkDescriptorType Type)
 	{
-		VkDescriptorBufferInfo BufferInfo;
-		BufferInfo.buffer = Buff->GetVkBuffer();
-		BufferInfo.offset = 0;
-		BufferInfo.range = Buff->GetSize();
-
-		BufferDescInfos.emplace_back(BufferInfo);
-	}
+		if (Buffers.size() == 0)
+		{
+			BE_ERROR("Empty buffer array provided when binding resource!");
+			return;
+		}
 
-	BufferInfos.emplace_back(BufferDescInfos);
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-	ASSERT(DescriptorSets[Set].Sets[Index] != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+		const size_t DataOffset = AllocateScratch<VkDescriptorBufferInfo>(static_cast<uint32_t>(Buffers.size()));
+		VkDescriptorBufferInfo* BufferInfos = GetScratch<VkDescriptorBufferInfo>(DataOffset);
 
-	VkWriteDescriptorSet WriteDescSet{};
-	WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	WriteDescSet.dstSet = DescriptorSets[Set].Sets[Index];
-	WriteDescSet.dstBinding = Binding;
-	WriteDescSet.dstArrayElement = 0;
-	WriteDescSet.descriptorCount = static_cast<uint32_t>(BufferDescInfos.size());
-	WriteDescSet.descriptorType = Type;
-	WriteDescSet.pImageInfo = VK_NULL_HANDLE;
-	WriteDescSet.pBufferInfo = BufferInfos.back().data();
-	WriteDescSet.pTexelBufferView = VK_NULL_HANDLE;
-	WriteDescSet.pNext = VK_NULL_HANDLE;
+		for (size_t i = 0; i < Buffers.size(); i++)
+		{
+			BufferInfos[i].buffer = Buffers[i]->GetVkBuffer();
+			BufferInfos[i].offset = 0;
+			BufferInfos[i].range = Buffers[i]->GetSize();
+		}
 
-	WriteDescSets.emplace_back(std::move(WriteDescSet));
-}
+		QueueWrite(Set, Binding, Index, 0, static_cast<uint32_t>(Buffers.size()), Type, DataOffset);
+	}
 
-	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::shared_ptr<Texture> InTexture, VkDescriptorType Type)
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, const std::shared_ptr<Texture>& InTexture, VkDescriptorType Type)
 	{
 		if(!InTexture)
 		{
@@ -277,62 +485,103 @@ void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std:
 			return;
 		}
 
-		ImageInfos.push_back(std::vector<VkDescriptorImageInfo>());
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-		VkDescriptorImageInfo ImageInfo;
-		ImageInfo.imageView = InTexture->GetImageView(0);
-		ImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		const size_t DataOffset = AllocateScratch<VkDescriptorImageInfo>(1);
+		VkDescriptorImageInfo* ImageInfo = GetScratch<VkDescriptorImageInfo>(DataOffset);
+		ImageInfo->sampler = VK_NULL_HANDLE;
+		ImageInfo->imageView = InTexture->GetImageView(0);
+		ImageInfo->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-		ImageInfos.back().push_back(ImageInfo);
+		QueueWrite(Set, Binding, Index, 0, 1, Type, DataOffset);
+	}
 
-		ASSERT(DescriptorSets[Set].Sets[Index] != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+	void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, const std::shared_ptr<Texture>& InTexture, const Sampler& InSampler, VkDescriptorType Type)
+	{
+		if (!InTexture)
+		{
+			BE_ERROR("Trying to bind invalid texture!");
+			return;
+		}
 
-		VkWriteDescriptorSet WriteDescSet{};
-		WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		WriteDescSet.dstSet = DescriptorSets[Set].Sets[Index];
-		WriteDescSet.dstBinding = Binding;
-		WriteDescSet.dstArrayElement = 0;
-		WriteDescSet.descriptorCount = static_cast<uint32_t>(ImageInfos.back().size());
-		WriteDescSet.descriptorType = Type;
-		WriteDescSet.pImageInfo = ImageInfos.back().data();
-		WriteDescSet.pBufferInfo = VK_NULL_HANDLE;
-		WriteDescSet.pTexelBufferView = VK_NULL_HANDLE;
-		WriteDescSet.pNext = VK_NULL_HANDLE;
+		std::unique_lock<std::mutex> MutexLock(Mutex);
 
-		WriteDescSets.emplace_back(std::move(WriteDescSet));
+		const size_t DataOffset = AllocateScratch<VkDescriptorImageInfo>(1);
+		VkDescriptorImageInfo* ImageInfo = GetScratch<VkDescriptorImageInfo>(DataOffset);
+		ImageInfo->sampler = InSampler.GetVkSampler();
+		ImageInfo->imageView = InTexture->GetImageView(0);
+		ImageInfo->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		QueueWrite(Set, Binding, Index, 0, 1, Type, DataOffset);
 	}
 
-void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::shared_ptr<Texture> InTexture, std::shared_ptr<Sampler> InSampler, VkDescriptorType Type)
-{
-	if (!InTexture || !InSampler)
+	void Pipeline::QueueWrite(uint32_t Set, uint32_t Binding, uint32_t Index, uint32_t DstArrayElement, uint32_t Count, VkDescriptorType Type, size_t DataOffset)
 	{
-		BE_ERROR("Trying to bind invalid texture or sampler!");
-		return;
-	}
+		if(DescBuffer)
+		{
+			switch(GetDescriptorInfoType(Type))
+			{
+			case DescriptorInfoType::Image:
+				DescBuffer->WriteImages(Set, Index, Binding, DstArrayElement, Type, std::span<const VkDescriptorImageInfo>(GetScratch<VkDescriptorImageInfo>(DataOffset), Count));
+				break;
+			case DescriptorInfoType::Buffer:
+				DescBuffer->WriteBuffers(Set, Index, Binding, DstArrayElement, Type, std::span<const VkDescriptorBufferInfo>(GetScratch<VkDescriptorBufferInfo>(DataOffset), Count));
+				break;
+			default:
+				ASSERT(false, "Texel buffers are written to the descriptor buffer by BindResource");
+				break;
+			}
 
-	ImageInfos.push_back(std::vector<VkDescriptorImageInfo>());
+			// Nothing is queued, the infos aren't needed anymore
+			ScratchUsed = 0;
+			return;
+		}
 
-	VkDescriptorImageInfo ImageInfo;
-	ImageInfo.imageView = InTexture->GetImageView(0);
-	ImageInfo.sampler = InSampler->GetVkSampler();
-	ImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		auto SetItr = DescriptorSets.find(Set);
+		ASSERT(SetItr != DescriptorSets.end() && Index < SetItr->second.Sets.size() && SetItr->second.Sets[Index] != VK_NULL_HANDLE, 
+			   "Descriptor set was not allocated before binding");
 
-	ASSERT(DescriptorSets[Set].Sets[Index] != VK_NULL_HANDLE, "Descriptor set was not allocated before binding");
+		const DescriptorSet& DstSet = SetItr->second;
 
-	VkWriteDescriptorSet WriteDescSet{};
-	WriteDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	WriteDescSet.dstSet = DescriptorSets[Set].Sets[Index];
-	WriteDescSet.dstBinding = Binding;
-	WriteDescSet.dstArrayElement = 0;
-	WriteDescSet.descriptorCount = static_cast<uint32_t>(ImageInfos.back().size());
-	WriteDescSet.descriptorType = Type;
-	WriteDescSet.pImageInfo = ImageInfos.back().data();
-	WriteDescSet.pBufferInfo = VK_NULL_HANDLE;
-	WriteDescSet.pTexelBufferView = VK_NULL_HANDLE;
-	WriteDescSet.pNext = VK_NULL_HANDLE;
+		PendingDescriptorWrite Pending;
+		Pending.DstSet = DstSet.Sets[Index];
+		Pending.Set = Set;
+		Pending.Binding = Binding;
+		Pending.DstArrayElement = DstArrayElement;
+		Pending.Count = Count;
+		Pending.Type = Type;
+		Pending.DataOffset = DataOffset;
 
-	WriteDescSets.emplace_back(std::move(WriteDescSet));
-}
+		PendingWrites.push_back(Pending);
+	}
+
+	DescriptorInfoType Pipeline::GetDescriptorInfoType(VkDescriptorType Type)
+	{
+		switch(Type)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			return DescriptorInfoType::Image;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			return DescriptorInfoType::TexelBuffer;
+		default:
+			return DescriptorInfoType::Buffer;
+		}
+	}
+
+	size_t Pipeline::GetDescriptorInfoSize(DescriptorInfoType InfoType)
+	{
+		switch(InfoType)
+		{
+		case DescriptorInfoType::Image:			return sizeof(VkDescriptorImageInfo);
+		case DescriptorInfoType::TexelBuffer:	return sizeof(VkBufferView);
+		default:								return sizeof(VkDescriptorBufferInfo);
+		}
+	}
 
 	void Pipeline::CreateGraphicsPipeline()
 	{
@@ -505,10 +754,11 @@ void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std:
 		PipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 		PipelineInfo.basePipelineIndex = -1; // Optional
 		PipelineInfo.pTessellationState = VK_NULL_HANDLE;
+		PipelineInfo.flags = DescBuffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
 
 		DebugName = "Graphics Pipeline: " + DebugName;
 		const std::string ErrorMsg = "Failed to create " + DebugName + "!";
-		VK_CHECK(vkCreateGraphicsPipelines(VulkanDevice, VK_NULL_HANDLE, 1, &PipelineInfo, nullptr, &VulkanPipeline), ErrorMsg.c_str());
+		VK_CHECK(vkCreateGraphicsPipelines(VulkanDevice, VulkanPipelineCache, 1, &PipelineInfo, nullptr, &VulkanPipeline), ErrorMsg.c_str());
 	}
 
 	void Pipeline::CreateComputePipeline()
@@ -545,14 +795,14 @@ void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std:
 
 		VkComputePipelineCreateInfo ComputePipelineInfo{};
 		ComputePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-		ComputePipelineInfo.flags = 0;
+		ComputePipelineInfo.flags = DescBuffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
 		ComputePipelineInfo.stage = ShaderStageInfo;
 		ComputePipelineInfo.layout = VulkanPipelineLayout;
 		ComputePipelineInfo.pNext = VK_NULL_HANDLE;
 
 		DebugName = "Compute Pipeline: " + DebugName;
 		const std::string ErrorMsg = "Failed to create " + DebugName + "!";
-		VK_CHECK(vkCreateComputePipelines(VulkanDevice, VK_NULL_HANDLE, 1, &ComputePipelineInfo, nullptr, &VulkanPipeline), ErrorMsg);
+		VK_CHECK(vkCreateComputePipelines(VulkanDevice, VulkanPipelineCache, 1, &ComputePipelineInfo, nullptr, &VulkanPipeline), ErrorMsg);
 	}
 
 	void Pipeline::InitDescriptorLayout()
@@ -560,31 +810,141 @@ void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std:
 		std::vector<SetDescriptor> Sets;
 		GetSetDescriptorsFromBindPoint(Sets);
 
+		if(DescBuffer)
+		{
+			for(const SetDescriptor& Set : Sets)
+			{
+				for(const VkDescriptorSetLayoutBinding& Binding : Set.Bindings)
+				{
+					if(!DescriptorBuffer::SupportsDescriptorType(Binding.descriptorType))
+					{
+#if _DEBUG
+						BE_INFO("{0}: binding {1} of set {2} can't live in a descriptor buffer, falling back to descriptor sets", DebugName, Binding.binding, Set.SetIndex);
+#endif
+						DescBuffer.reset();
+						break;
+					}
+				}
+
+				if(!DescBuffer)
+				{
+					break;
+				}
+			}
+		}
+
+		if(DescBuffer)
+		{
+			// Descriptor buffer layouts can't be update after bind, the descriptors are written to memory the GPU reads directly anyway
+			for(SetDescriptor& Set : Sets)
+			{
+				const VkDescriptorSetLayout Layout = Descriptors->GetLayout(Set.Bindings, {}, VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT);
+				DescriptorSets[Set.SetIndex].Layout = Layout;
+				DescBuffer->AddSetLayout(Set.SetIndex, Layout, Set.Bindings);
+			}
+
+			return;
+		}
+
 		constexpr VkDescriptorBindingFlags FlagsToEnable = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
 
 		for(SetDescriptor& Set : Sets)
 		{
 			std::vector<VkDescriptorBindingFlags> BindFlags(Set.Bindings.size(), FlagsToEnable);
 
-			VkDescriptorSetLayoutBindingFlagsCreateInfo LayoutFlagsInfo{};
-			LayoutFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
-			LayoutFlagsInfo.pNext = nullptr;
-			LayoutFlagsInfo.bindingCount = static_cast<uint32_t>(Set.Bindings.size());
-			LayoutFlagsInfo.pBindingFlags = BindFlags.data();
+			bool bUpdateAfterBind = false;
+			for(size_t Index = 0; Index < Set.Bindings.size(); Index++)
+			{
+				if(SupportsUpdateAfterBind(Set.Bindings[Index].descriptorType))
+				{
+					BindFlags[Index] |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+					bUpdateAfterBind = true;
+				}
+			}
+
+			const VkDescriptorSetLayoutCreateFlags LayoutFlags = bUpdateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT : 0;
+			DescriptorSets[Set.SetIndex].Layout = Descriptors->GetLayout(Set.Bindings, BindFlags, LayoutFlags);
+
+			CreateUpdateTemplate(Set.SetIndex, Set.Bindings);
+		}
+	}
+
+	void Pipeline::CreateUpdateTemplate(uint32_t SetIndex, const std::vector<VkDescriptorSetLayoutBinding>& Bindings)
+	{
+		DescriptorSet& DstSet = DescriptorSets[SetIndex];
+
+		uint32_t NumBindings = 0;
+		for(const VkDescriptorSetLayoutBinding& Binding : Bindings)
+		{
+			NumBindings = std::max(NumBindings, Binding.binding + 1);
+		}
+
+		DstSet.TemplateEntries.resize(NumBindings);
+
+		// One entry per binding covering all of its elements, each binding's infos are packed right after the previous one's
+		// the way BindResource writes them
+		std::vector<VkDescriptorUpdateTemplateEntry> Entries;
+		Entries.reserve(Bindings.size());
+
+		size_t DataSize = 0;
+		for(const VkDescriptorSetLayoutBinding& Binding : Bindings)
+		{
+			if(Binding.descriptorCount == 0)
+			{
+				continue;
+			}
+
+			const size_t InfoSize = GetDescriptorInfoSize(GetDescriptorInfoType(Binding.descriptorType));
+
+			VkDescriptorUpdateTemplateEntry Entry{};
+			Entry.dstBinding = Binding.binding;
+			Entry.dstArrayElement = 0;
+			Entry.descriptorCount = Binding.descriptorCount;
+			Entry.descriptorType = Binding.descriptorType;
+			Entry.offset = DataSize;
+			Entry.stride = InfoSize;
+			Entries.push_back(Entry);
+
+			DescriptorTemplateEntry& TemplateEntry = DstSet.TemplateEntries[Binding.binding];
+			TemplateEntry.Type = Binding.descriptorType;
+			TemplateEntry.DescriptorCount = Binding.descriptorCount;
+			TemplateEntry.Offset = DataSize;
+
+			DataSize += InfoSize * Binding.descriptorCount;
+		}
 
-			VkDescriptorSetLayoutCreateInfo DescriptorLayoutInfo{};
-			DescriptorLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-			DescriptorLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
-			DescriptorLayoutInfo.bindingCount = static_cast<uint32_t>(Set.Bindings.size());
-			DescriptorLayoutInfo.pBindings = !Set.Bindings.empty() ? Set.Bindings.data() : nullptr;
-			DescriptorLayoutInfo.pNext = VK_NULL_HANDLE;
+		if(Entries.empty())
+		{
+			return;
+		}
+
+		DstSet.TemplateDataSize = DataSize;
 
-			VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+		VkDescriptorUpdateTemplateCreateInfo TemplateInfo{};
+		TemplateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		TemplateInfo.flags = 0;
+		TemplateInfo.descriptorUpdateEntryCount = (uint32_t)Entries.size();
+		TemplateInfo.pDescriptorUpdateEntries = Entries.data();
+		TemplateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		TemplateInfo.descriptorSetLayout = DstSet.Layout;
+		TemplateInfo.pNext = VK_NULL_HANDLE;
 
-			const std::string ErrorMsg = "Failed to create descriptor set: " + DebugName;
-			VK_CHECK(vkCreateDescriptorSetLayout(VulkanDevice, &DescriptorLayoutInfo, nullptr, &Layout), ErrorMsg.c_str());
+		const std::string ErrorMsg = "Failed to create descriptor update template: " + DebugName;
+		VK_CHECK(vkCreateDescriptorUpdateTemplate(VulkanDevice, &TemplateInfo, nullptr, &DstSet.SetTemplate), ErrorMsg.c_str());
+	}
 
-			DescriptorSets[Set.SetIndex].Layout = Layout;
+	bool Pipeline::SupportsUpdateAfterBind(VkDescriptorType Type)
+	{
+		// Only the descriptor types whose update-after-bind features are enabled in Context::EndableDefaultFeatures
+		switch(Type)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			return true;
+		default:
+			return false;
 		}
 	}
 
@@ -605,38 +965,6 @@ void Pipeline::BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std:
 		}
 	}
 
-	void Pipeline::InitDescriptorPool()
-	{
-		std::vector<SetDescriptor> SetDescs;
-
-		if(BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
-		{
-			SetDescs = GraphicsPipelineDesc.SetDescriptors;
-		}
-		else if(BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
-		{
-			SetDescs = ComputePipelineDesc.SetDescriptors;
-		}
-
-		std::vector<VkDescriptorPoolSize> PoolSizes;
-		for(uint32_t SetIndex = 0; SetIndex < (uint32_t)SetDescs.size(); SetIndex++)
-		{
-			for(const auto& Binding : SetDescs[SetIndex].Bindings)
-			{
-				PoolSizes.push_back({ Binding.descriptorType, MAX_DESCRIPTOR_SETS });
-			}
-		}
-
-		VkDescriptorPoolCreateInfo DescPoolInfo{};
-		DescPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		DescPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT | VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
-		DescPoolInfo.maxSets = MAX_DESCRIPTOR_SETS;
-		DescPoolInfo.poolSizeCount = static_cast<uint32_t>(PoolSizes.size());
-		DescPoolInfo.pPoolSizes = PoolSizes.data();
-
-		VK_CHECK(vkCreateDescriptorPool(VulkanDevice, &DescPoolInfo, nullptr, &VulkanDescriptorPool));
-	}
-
 	VkPipelineLayout Pipeline::CreatePipelineLayout(const std::vector<VkDescriptorSetLayout>& DescLayouts, const std::vector<VkPushConstantRange>& PushConstants)
 	{
 		VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
@@ -4,7 +4,6 @@
 #include "Utility.h"
 
 #include <unordered_map>
-#include <list>
 #include <span>
 
 namespace VulkanCore
@@ -15,6 +14,16 @@ class ShaderModule;
 class Sampler;
 class Texture;
 class Buffer;
+class DescriptorAllocator;
+class DescriptorBuffer;
+class CommandQueueManager;
+
+enum class DescriptorInfoType : uint8_t
+{
+	Image,
+	Buffer,
+	TexelBuffer
+};
 
 #pragma region PipelineDataStructures
 
@@ -24,10 +33,27 @@ struct SetDescriptor
 	std::vector<VkDescriptorSetLayoutBinding> Bindings;
 };
 
+struct DescriptorTemplateEntry
+{
+	VkDescriptorType Type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+	uint32_t DescriptorCount = 0;
+	// Where the binding's infos start in the set template's data
+	size_t Offset = 0;
+};
+
 struct DescriptorSet
 {
 	std::vector<VkDescriptorSet> Sets;
+	// Pool each set was allocated from, the sets are handed back to the descriptor allocator with it
+	std::vector<VkDescriptorPool> Pools;
+	// Owned by the descriptor allocator
 	VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+
+	// Covers every binding of the layout, a set whose queued writes fill all of its bindings is written with one template update
+	VkDescriptorUpdateTemplate SetTemplate = VK_NULL_HANDLE;
+	// Indexed by binding
+	std::vector<DescriptorTemplateEntry> TemplateEntries;
+	size_t TemplateDataSize = 0;
 };
 
 struct SetAllocInfo
@@ -167,29 +193,47 @@ public:
 
 	bool IsValid() const { return VulkanPipeline != VK_NULL_HANDLE; }
 
+	// True if the pipeline's descriptors live in a descriptor buffer instead of descriptor sets
+	bool UsesDescriptorBuffer() const { return DescBuffer != nullptr; }
+
 	VkPipeline GetVkPipeline() const { return VulkanPipeline; }
 
 	void Bind(VkCommandBuffer CmdBuffer);
 
+	// DynamicOffsets needs one entry per dynamic buffer in the set, in binding order
+	void BindDescriptorSet(VkCommandBuffer CmdBuffer, uint32_t Set, uint32_t Index, std::span<const uint32_t> DynamicOffsets = {});
+
+	// Applies every write queued by BindResource since the last update, called by Bind once per frame
 	void UpdateDescriptorSets();
 
 	void AllocateDescriptors(const std::vector<SetAllocInfo> AllocInfos);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::shared_ptr<Buffer> InBuffer, 
+	// Allocates this frame's set for data that changes every frame and returns the index it's written and bound with. Sets come from
+	// the descriptor allocator's frame pools and are recycled once the frame comes around again, descriptor buffers keep one set per frame.
+	// The set has to be written again every frame.
+	uint32_t AllocateFrameSet(uint32_t Set, uint32_t FrameIndex);
+
+	// Frees descriptor memory the GPU is done with, only does something when the pipeline uses a descriptor buffer. Called once per frame.
+	void ReleaseRetiredDescriptors(CommandQueueManager& Queue);
+
+	// For allocating per-frame sets from the descriptor allocator, VK_NULL_HANDLE if the pipeline has no such set or uses a descriptor buffer
+	VkDescriptorSetLayout GetDescriptorSetLayout(uint32_t Set) const;
+
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, const std::shared_ptr<Buffer>& InBuffer, 
 					  uint32_t Offset, uint32_t Size, VkDescriptorType Type, VkFormat Format = VK_FORMAT_UNDEFINED);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<std::shared_ptr<Texture>> Textures,
-					  std::shared_ptr<Sampler> InSampler = nullptr, uint32_t DstArrayElement = 0);
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const std::shared_ptr<Texture>> Textures,
+					  const Sampler* InSampler = nullptr, uint32_t DstArrayElement = 0);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<std::shared_ptr<Sampler>> Samplers);
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const Sampler> Samplers, uint32_t DstArrayElement = 0);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<std::shared_ptr<VkImageView>> ImageViews, VkDescriptorType Type);
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const std::shared_ptr<VkImageView>> ImageViews, VkDescriptorType Type);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::vector<std::shared_ptr<Buffer>> Buffers, VkDescriptorType Type);
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::span<const std::shared_ptr<Buffer>> Buffers, VkDescriptorType Type);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::shared_ptr<Texture> InTexture, VkDescriptorType Type);
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, const std::shared_ptr<Texture>& InTexture, VkDescriptorType Type);
 
-	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, std::shared_ptr<Texture> InTexture, std::shared_ptr<Sampler> InSampler, 
+	void BindResource(uint32_t Set, uint32_t Binding, uint32_t Index, const std::shared_ptr<Texture>& InTexture, const Sampler& InSampler, 
 					  VkDescriptorType Type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
 private:
@@ -197,30 +241,75 @@ private:
 	void CreateComputePipeline();
 
 	void InitDescriptorLayout();
-	void GetSetDescriptorsFromBindPoint(std::vector<SetDescriptor>& InOutSets);
+	void CreateUpdateTemplate(uint32_t SetIndex, const std::vector<VkDescriptorSetLayoutBinding>& Bindings);
 
-	void InitDescriptorPool();
+	// Expects the mutex to be held. Returns true if the writes fill every binding of their set and were applied with its template.
+	bool UpdateWithSetTemplate(std::span<const uint32_t> SetWrites);
+	static bool SupportsUpdateAfterBind(VkDescriptorType Type);
+	void GetSetDescriptorsFromBindPoint(std::vector<SetDescriptor>& InOutSets);
 
 	VkPipelineLayout CreatePipelineLayout(const std::vector<VkDescriptorSetLayout>& DescLayouts, const std::vector<VkPushConstantRange>& PushConstants);
 
+	// Reserves room for Count descriptor infos in the scratch arena, returns their offset. Only valid until the next UpdateDescriptorSets.
+	template<typename T>
+	size_t AllocateScratch(uint32_t Count);
+
+	template<typename T>
+	T* GetScratch(size_t Offset) { return reinterpret_cast<T*>(ScratchArena.get() + Offset); }
+
+	// Expects the mutex to be held. Writes into a descriptor buffer are applied right away.
+	void QueueWrite(uint32_t Set, uint32_t Binding, uint32_t Index, uint32_t DstArrayElement, uint32_t Count, VkDescriptorType Type, size_t DataOffset);
+
+	static DescriptorInfoType GetDescriptorInfoType(VkDescriptorType Type);
+	static size_t GetDescriptorInfoSize(DescriptorInfoType InfoType);
+
+public:
+	static constexpr size_t SCRATCH_ARENA_SIZE = 64 * 1024;
+	static constexpr size_t INITIAL_PENDING_WRITES = 128;
+
 private:
+	struct PendingDescriptorWrite
+	{
+		VkDescriptorSet DstSet = VK_NULL_HANDLE;
+		uint32_t Set = 0;
+		uint32_t Binding = 0;
+		uint32_t DstArrayElement = 0;
+		uint32_t Count = 0;
+		VkDescriptorType Type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		size_t DataOffset = 0;
+	};
+
 	VkDevice VulkanDevice = VK_NULL_HANDLE;
 	VkRenderPass VulkanRenderPass = VK_NULL_HANDLE;
 	
 	VkPipeline VulkanPipeline = VK_NULL_HANDLE;
 	VkPipelineLayout VulkanPipelineLayout = VK_NULL_HANDLE;
+	// Owned by the context
+	VkPipelineCache VulkanPipelineCache = VK_NULL_HANDLE;
 	VkPipelineBindPoint BindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
 	GraphicsPipelineDescriptor GraphicsPipelineDesc;
 	ComputePipelineDescriptor ComputePipelineDesc;
 
 	std::unordered_map<uint32_t, DescriptorSet> DescriptorSets;
-	std::vector<VkWriteDescriptorSet> WriteDescSets;
-	VkDescriptorPool VulkanDescriptorPool = VK_NULL_HANDLE;
+	DescriptorAllocator* Descriptors = nullptr;
 
-	std::list<std::vector<VkDescriptorBufferInfo>> BufferInfos;
-	std::list<VkBufferView> BufferViewInfos;
-	std::list<std::vector<VkDescriptorImageInfo>> ImageInfos;
+	// Only created when the device has descriptor buffers enabled and every binding of the pipeline can use them
+	std::unique_ptr<DescriptorBuffer> DescBuffer;
+
+	// Descriptor infos of the queued writes, reset by every update. Writes refer to it by offset since it can grow.
+	std::unique_ptr<uint8_t[]> ScratchArena;
+	size_t ScratchCapacity = 0;
+	size_t ScratchUsed = 0;
+
+	// These keep their capacity between updates, binding doesn't allocate once they've grown to a frame's worth of writes
+	std::vector<PendingDescriptorWrite> PendingWrites;
+	std::vector<VkWriteDescriptorSet> WriteDescSets;
+	// Pending writes grouped by the set they go to, in the order they were queued within a set
+	std::vector<uint32_t> WriteOrder;
+	// Bindings of the set being updated that were written completely
+	std::vector<bool> CoveredBindings;
+	std::vector<uint8_t> TemplateData;
 
 	std::mutex Mutex;
 
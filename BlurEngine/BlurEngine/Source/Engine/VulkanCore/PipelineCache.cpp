@@ -0,0 +1,230 @@
+#include "PipelineCache.h"
+#include "Context.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace VulkanCore
+{
+
+	PipelineCache::PipelineCache(const Context& DeviceContext, const std::filesystem::path& InFilepath, const std::string& Name)
+		: VulkanDevice{DeviceContext.GetDevice()}, DeviceProperties{DeviceContext.GetPhysicalDevice().GetDeviceProperties()},
+		  Filepath{InFilepath}, DebugName{"Pipeline Cache: " + Name}
+	{
+		const std::vector<uint8_t> InitialData = LoadFile();
+
+		VkPipelineCacheCreateInfo CacheInfo{};
+		CacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		CacheInfo.initialDataSize = InitialData.size();
+		CacheInfo.pInitialData = InitialData.empty() ? nullptr : InitialData.data();
+		CacheInfo.pNext = VK_NULL_HANDLE;
+
+		if(vkCreatePipelineCache(VulkanDevice, &CacheInfo, nullptr, &VulkanPipelineCache) != VK_SUCCESS)
+		{
+			// Drivers should ignore data they can't use, start empty for the ones that fail instead
+			BE_WARN("{0}: driver rejected the cache file, starting with an empty cache", DebugName);
+
+			CacheInfo.initialDataSize = 0;
+			CacheInfo.pInitialData = nullptr;
+			VK_CHECK(vkCreatePipelineCache(VulkanDevice, &CacheInfo, nullptr, &VulkanPipelineCache));
+		}
+
+		SavedSize = InitialData.size();
+		LastSaveTime = std::chrono::steady_clock::now();
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		if(BackgroundSave.valid())
+		{
+			BackgroundSave.wait();
+		}
+
+		Save();
+
+		vkDestroyPipelineCache(VulkanDevice, VulkanPipelineCache, nullptr);
+	}
+
+	void PipelineCache::Update()
+	{
+		if(BackgroundSave.valid())
+		{
+			if(BackgroundSave.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				return;
+			}
+
+			BackgroundSave.get();
+		}
+
+		const std::chrono::duration<double> SinceSave = std::chrono::steady_clock::now() - LastSaveTime;
+		if(Filepath.empty() || SinceSave.count() < SAVE_INTERVAL_SECONDS)
+		{
+			return;
+		}
+
+		LastSaveTime = std::chrono::steady_clock::now();
+
+		size_t DataSize = 0;
+		vkGetPipelineCacheData(VulkanDevice, VulkanPipelineCache, &DataSize, nullptr);
+
+		if(DataSize != SavedSize)
+		{
+			BackgroundSave = std::async(std::launch::async, [this]() { return Save(); });
+		}
+	}
+
+	bool PipelineCache::Save()
+	{
+		if(Filepath.empty())
+		{
+			return false;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		size_t DataSize = 0;
+		VK_CHECK(vkGetPipelineCacheData(VulkanDevice, VulkanPipelineCache, &DataSize, nullptr));
+
+		std::vector<uint8_t> Data(DataSize);
+		if(DataSize > 0)
+		{
+			// The cache can grow between the two calls, VK_INCOMPLETE then means the data is valid but misses the newest pipelines
+			const VkResult Result = vkGetPipelineCacheData(VulkanDevice, VulkanPipelineCache, &DataSize, Data.data());
+			if(Result != VK_SUCCESS && Result != VK_INCOMPLETE)
+			{
+				BE_WARN("{0}: failed to read the cache data", DebugName);
+				return false;
+			}
+
+			Data.resize(DataSize);
+		}
+
+		PipelineCacheFileHeader Header;
+		Header.Magic = FILE_MAGIC;
+		Header.FileVersion = FILE_VERSION;
+		Header.VendorID = DeviceProperties.vendorID;
+		Header.DeviceID = DeviceProperties.deviceID;
+		Header.DriverVersion = DeviceProperties.driverVersion;
+		memcpy(Header.PipelineCacheUUID, DeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+		Header.DataSize = Data.size();
+		Header.DataHash = HashData(Data.data(), Data.size());
+
+		std::error_code Error;
+		if(Filepath.has_parent_path())
+		{
+			std::filesystem::create_directories(Filepath.parent_path(), Error);
+		}
+
+		std::filesystem::path TempPath = Filepath;
+		TempPath += ".tmp";
+
+		{
+			std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+			File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+			File.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+			File.flush();
+
+			if(!File.good())
+			{
+				BE_WARN("{0}: failed to write {1}", DebugName, TempPath.string());
+				File.close();
+				std::filesystem::remove(TempPath, Error);
+				return false;
+			}
+		}
+
+		// Replaces the old file in one step, readers only ever see a complete file
+		std::filesystem::rename(TempPath, Filepath, Error);
+		if(Error)
+		{
+			BE_WARN("{0}: failed to replace {1}: {2}", DebugName, Filepath.string(), Error.message());
+			std::filesystem::remove(TempPath, Error);
+			return false;
+		}
+
+		SavedSize = Data.size();
+
+#if _DEBUG
+		BE_INFO("{0}: saved {1} KB to {2}", DebugName, Data.size() >> 10, Filepath.string());
+#endif
+
+		return true;
+	}
+
+	std::vector<uint8_t> PipelineCache::LoadFile() const
+	{
+		std::error_code Error;
+		if(Filepath.empty() || !std::filesystem::exists(Filepath, Error))
+		{
+			return {};
+		}
+
+		std::ifstream File(Filepath, std::ios::binary | std::ios::ate);
+		if(File.fail())
+		{
+			BE_WARN("{0}: failed to open {1}", DebugName, Filepath.string());
+			return {};
+		}
+
+		const size_t FileSize = (size_t)File.tellg();
+		File.seekg(0);
+
+		PipelineCacheFileHeader Header;
+		if(FileSize < sizeof(Header) || !File.read(reinterpret_cast<char*>(&Header), sizeof(Header)))
+		{
+			BE_WARN("{0}: {1} is truncated, ignoring it", DebugName, Filepath.string());
+			return {};
+		}
+
+		if(Header.Magic != FILE_MAGIC || Header.FileVersion != FILE_VERSION)
+		{
+			BE_WARN("{0}: {1} isn't a pipeline cache of this version, ignoring it", DebugName, Filepath.string());
+			return {};
+		}
+
+		// Expected after driver updates or when switching GPUs, the cache is rebuilt from scratch
+		if(Header.VendorID != DeviceProperties.vendorID || Header.DeviceID != DeviceProperties.deviceID ||
+		   Header.DriverVersion != DeviceProperties.driverVersion || memcmp(Header.PipelineCacheUUID, DeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+#if _DEBUG
+			BE_INFO("{0}: {1} was written by another device or driver, ignoring it", DebugName, Filepath.string());
+#endif
+			return {};
+		}
+
+		if(Header.DataSize != FileSize - sizeof(Header))
+		{
+			BE_WARN("{0}: {1} is truncated, ignoring it", DebugName, Filepath.string());
+			return {};
+		}
+
+		std::vector<uint8_t> Data(Header.DataSize);
+		if(!File.read(reinterpret_cast<char*>(Data.data()), Data.size()) || HashData(Data.data(), Data.size()) != Header.DataHash)
+		{
+			BE_WARN("{0}: {1} is corrupted, ignoring it", DebugName, Filepath.string());
+			return {};
+		}
+
+#if _DEBUG
+		BE_INFO("{0}: loaded {1} KB from {2}", DebugName, Data.size() >> 10, Filepath.string());
+#endif
+
+		return Data;
+	}
+
+	uint64_t PipelineCache::HashData(const uint8_t* Data, size_t Size)
+	{
+		// FNV-1a, only meant to catch files that were cut short or damaged
+		uint64_t Hash = 0xCBF29CE484222325ull;
+		for(size_t i = 0; i < Size; i++)
+		{
+			Hash ^= Data[i];
+			Hash *= 0x100000001B3ull;
+		}
+
+		return Hash;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <mutex>
+
+namespace VulkanCore
+{
+
+class Context;
+
+// Written in front of the driver's cache data. The driver validates its own header too, but some drivers don't check the driver
+// version and a stale cache from an older driver can crash pipeline creation, so the file is checked before the data is handed over.
+struct PipelineCacheFileHeader
+{
+	uint32_t Magic = 0;
+	uint32_t FileVersion = 0;
+
+	uint32_t VendorID = 0;
+	uint32_t DeviceID = 0;
+	uint32_t DriverVersion = 0;
+	uint8_t PipelineCacheUUID[VK_UUID_SIZE] = {};
+
+	uint64_t DataSize = 0;
+	uint64_t DataHash = 0;
+};
+
+// Owns the VkPipelineCache every pipeline is created with. The cache is loaded from disk when created, so warm starts skip most of
+// the driver's shader compilation, and written back every SAVE_INTERVAL_SECONDS if it grew and once more on destruction.
+// Files are written to a temporary file first and renamed over the old one, a crash while saving leaves the previous cache intact.
+//
+// The VkPipelineCache is internally synchronized, pipelines can be created with it from any thread while it is being saved.
+class PipelineCache final
+{
+public:
+	MOVABLE_ONLY(PipelineCache);
+
+	// An empty path keeps the cache in memory only
+	PipelineCache(const Context& DeviceContext, const std::filesystem::path& InFilepath, const std::string& Name = "");
+	~PipelineCache();
+
+	VkPipelineCache GetVkPipelineCache() const { return VulkanPipelineCache; }
+
+	// Starts a save on a background thread if the interval has passed and the cache grew, called once per frame from the render thread.
+	// Reading the driver data, hashing and writing the file can take a while once the cache is large, none of it stalls the frame.
+	void Update();
+
+	// Saves right away on the calling thread. Returns false if the file couldn't be written, the previous file is kept in that case.
+	bool Save();
+
+public:
+	static constexpr uint32_t FILE_MAGIC = 0x43505542; // "BUPC"
+	static constexpr uint32_t FILE_VERSION = 1;
+	static constexpr double SAVE_INTERVAL_SECONDS = 30.0;
+
+private:
+	// Returns the driver data of the file, empty if there is no file or it doesn't match this device and driver
+	std::vector<uint8_t> LoadFile() const;
+
+	static uint64_t HashData(const uint8_t* Data, size_t Size);
+
+private:
+	VkDevice VulkanDevice = VK_NULL_HANDLE;
+	VkPipelineCache VulkanPipelineCache = VK_NULL_HANDLE;
+
+	VkPhysicalDeviceProperties DeviceProperties{};
+
+	std::filesystem::path Filepath;
+
+	// Driver data size at the last save, the cache only grows so a different size means there is something new.
+	// Written by the save, only read by Update once the save it started has finished.
+	size_t SavedSize = 0;
+	std::chrono::steady_clock::time_point LastSaveTime;
+
+	// Save started by Update, at most one runs at a time
+	std::future<bool> BackgroundSave;
+	// Keeps a background save and a direct Save from writing the file at the same time
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "ReadbackRing.h"
+#include "Context.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "CommandQueueManager.h"
+
+namespace VulkanCore
+{
+
+	// Covers the copy offset alignment of every texel size and keeps regions cache line aligned
+	static constexpr VkDeviceSize READBACK_ALIGNMENT = 64;
+
+	ReadbackRing::ReadbackRing(const Context& DeviceContext, CommandQueueManager& InQueue, VkDeviceSize InCapacity, const std::string& Name)
+		: Queue{InQueue}, Capacity{(InCapacity + READBACK_ALIGNMENT - 1) & ~(READBACK_ALIGNMENT - 1)}, DebugName{Name}
+	{
+		RingBuffer = DeviceContext.CreateBuffer(Capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsagePolicy::Readback, "Readback Ring: " + Name);
+		MappedData = static_cast<const uint8_t*>(RingBuffer->GetMappedMemory());
+
+		ASSERT(MappedData != nullptr, "Readback ring memory has to be persistently mapped!");
+	}
+
+	std::shared_ptr<ReadbackFuture> ReadbackRing::ReadBuffer(VkCommandBuffer CmdBuffer, const Buffer& SrcBuffer, VkDeviceSize Offset, VkDeviceSize Size,
+															 VkPipelineStageFlags2 SrcStages, VkAccessFlags2 SrcAccess, ReadbackCallback Callback)
+	{
+		ASSERT(Offset + Size <= SrcBuffer.GetSize(), "Readback is outside of the source buffer!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		uint64_t Start = 0;
+		if(!Allocate(Size, Start))
+		{
+			return nullptr;
+		}
+
+		CopyBarriers.BufferBarrier(SrcBuffer.GetVkBuffer(), Offset, Size, SrcStages, SrcAccess, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+		CopyBarriers.Flush(CmdBuffer);
+
+		VkBufferCopy CopyRegion{};
+		CopyRegion.srcOffset = Offset;
+		CopyRegion.dstOffset = Start % Capacity;
+		CopyRegion.size = Size;
+		vkCmdCopyBuffer(CmdBuffer, SrcBuffer.GetVkBuffer(), RingBuffer->GetVkBuffer(), 1, &CopyRegion);
+		MakeHostVisible(CmdBuffer, Start, Size);
+
+		return AddPendingRead(Start, Size, std::move(Callback));
+	}
+
+	std::shared_ptr<ReadbackFuture> ReadbackRing::ReadTexture(VkCommandBuffer CmdBuffer, Texture& SrcTexture, uint32_t MipLevel, uint32_t Layer,
+															  VkOffset3D Offset, VkExtent3D Extent, ReadbackCallback Callback)
+	{
+		ASSERT(MipLevel < SrcTexture.GetMipLevels() && Layer < SrcTexture.GetLayerCount(), "Readback subresource is outside of the texture!");
+
+		// Depth copies are tightly packed 16 or 32 bit values, whatever the stencil part of the format is
+		uint32_t TexelSize = BytesPerPixel(SrcTexture.GetFormat());
+		if(SrcTexture.IsDepth())
+		{
+			const bool b16BitDepth = SrcTexture.GetFormat() == VK_FORMAT_D16_UNORM || SrcTexture.GetFormat() == VK_FORMAT_D16_UNORM_S8_UINT;
+			TexelSize = b16BitDepth ? 2 : 4;
+		}
+
+		ASSERT(TexelSize > 0, "Can't read back a texture with an unknown texel size!");
+		const VkDeviceSize Size = (VkDeviceSize)Extent.width * Extent.height * Extent.depth * TexelSize;
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		uint64_t Start = 0;
+		if(!Allocate(Size, Start))
+		{
+			return nullptr;
+		}
+
+		const VkImageLayout OldLayout = SrcTexture.GetSubresourceState(MipLevel, Layer).Layout;
+
+		CopyBarriers.TransitionImage(SrcTexture, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, MipLevel, 1, Layer, 1);
+		CopyBarriers.Flush(CmdBuffer);
+
+		VkBufferImageCopy CopyRegion{};
+		CopyRegion.bufferOffset = Start % Capacity;
+		CopyRegion.bufferRowLength = 0;
+		CopyRegion.bufferImageHeight = 0;
+		CopyRegion.imageSubresource = {SrcTexture.IsDepth() ? (VkImageAspectFlags)VK_IMAGE_ASPECT_DEPTH_BIT : SrcTexture.GetFullAspectMask(), MipLevel, Layer, 1};
+		CopyRegion.imageOffset = Offset;
+		CopyRegion.imageExtent = Extent;
+		vkCmdCopyImageToBuffer(CmdBuffer, SrcTexture.GetVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, RingBuffer->GetVkBuffer(), 1, &CopyRegion);
+		MakeHostVisible(CmdBuffer, Start, Size);
+
+		// Whoever uses the texture next expects the layout it had before, undefined contents stay in the transfer layout
+		if(OldLayout != VK_IMAGE_LAYOUT_UNDEFINED && OldLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+		{
+			CopyBarriers.TransitionImage(SrcTexture, OldLayout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+										 MipLevel, 1, Layer, 1);
+			CopyBarriers.Flush(CmdBuffer);
+		}
+
+		return AddPendingRead(Start, Size, std::move(Callback));
+	}
+
+	void ReadbackRing::Update()
+	{
+		std::vector<PendingRead> CompletedReads;
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+
+			if(PendingReads.empty())
+			{
+				return;
+			}
+
+			const uint64_t CompletedSubmit = Queue.GetCompletedSubmitIndex();
+			while(!PendingReads.empty() && PendingReads.front().SubmitIndex <= CompletedSubmit)
+			{
+				CompletedReads.push_back(std::move(PendingReads.front()));
+				PendingReads.pop_front();
+			}
+		}
+
+		if(CompletedReads.empty())
+		{
+			return;
+		}
+
+		// The regions are only handed back below, so the data can't be overwritten while the callbacks run without the lock
+		for(PendingRead& Read : CompletedReads)
+		{
+			const uint8_t* ReadData = MappedData + Read.Start % Capacity;
+
+			// Host cached memory isn't necessarily coherent
+			RingBuffer->Invalidate(Read.Start % Capacity, Read.Size);
+
+			if(Read.Callback)
+			{
+				Read.Callback(ReadData, Read.Size);
+			}
+
+			// Nobody is holding on to the future, no need to copy the data out of the ring
+			if(Read.Future.use_count() > 1)
+			{
+				Read.Future->Data.assign(ReadData, ReadData + Read.Size);
+			}
+
+			Read.Future->bReady.store(true, std::memory_order_release);
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		Tail = CompletedReads.back().End;
+	}
+
+	bool ReadbackRing::Allocate(VkDeviceSize Size, uint64_t& OutStart)
+	{
+		ASSERT(Size > 0 && Size <= Capacity, "Readback has to fit into the ring!");
+
+		uint64_t Start = (Head + READBACK_ALIGNMENT - 1) & ~(READBACK_ALIGNMENT - 1);
+
+		// Regions never wrap around the end of the buffer, the rest of the buffer is skipped instead
+		const VkDeviceSize Offset = Start % Capacity;
+		if(Offset + Size > Capacity)
+		{
+			Start += Capacity - Offset;
+		}
+
+		if(Start + Size - Tail > Capacity)
+		{
+			BE_WARN("{0}: readback ring is full, {1} bytes are still waiting on the GPU", DebugName, Head - Tail);
+			return false;
+		}
+
+		Head = Start + Size;
+		OutStart = Start;
+		return true;
+	}
+
+	void ReadbackRing::MakeHostVisible(VkCommandBuffer CmdBuffer, uint64_t Start, VkDeviceSize Size)
+	{
+		CopyBarriers.BufferBarrier(RingBuffer->GetVkBuffer(), Start % Capacity, Size, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+								   VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+		CopyBarriers.Flush(CmdBuffer);
+	}
+
+	std::shared_ptr<ReadbackFuture> ReadbackRing::AddPendingRead(uint64_t Start, VkDeviceSize Size, ReadbackCallback&& Callback)
+	{
+		// The copy is part of whatever gets submitted next
+		PendingRead Read;
+		Read.SubmitIndex = Queue.GetNextSubmitIndex();
+		Read.Start = Start;
+		Read.End = Start + Size;
+		Read.Size = Size;
+		Read.Future = std::make_shared<ReadbackFuture>();
+		Read.Callback = std::move(Callback);
+
+		PendingReads.push_back(Read);
+		return Read.Future;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+#include "BarrierBuilder.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace VulkanCore
+{
+
+class Context;
+class Buffer;
+class Texture;
+class CommandQueueManager;
+
+// Data points into the ring and is only valid during the callback
+using ReadbackCallback = std::function<void(const void* Data, VkDeviceSize Size)>;
+
+// Filled in once the copy has finished on the GPU. Checking it never waits.
+class ReadbackFuture final
+{
+public:
+	MOVABLE_ONLY(ReadbackFuture);
+
+	ReadbackFuture() = default;
+
+	bool IsReady() const { return bReady.load(std::memory_order_acquire); }
+
+	// Only valid once IsReady returned true
+	const std::vector<uint8_t>& GetData() const { return Data; }
+
+private:
+	friend class ReadbackRing;
+
+	std::vector<uint8_t> Data;
+	std::atomic<bool> bReady = false;
+};
+
+// Persistently mapped, host cached buffer that GPU results are copied into. Copies are recorded into the current frame's command buffer
+// and delivered a few frames later, once polling the queue's fences shows the submit has completed, so reading results never stalls the GPU.
+class ReadbackRing final
+{
+public:
+	MOVABLE_ONLY(ReadbackRing);
+
+	explicit ReadbackRing(const Context& DeviceContext, CommandQueueManager& InQueue, VkDeviceSize InCapacity, const std::string& Name = "");
+
+	// Records a copy of the buffer range. SrcStages and SrcAccess are the last writes to the range the copy has to wait on.
+	// Returns nullptr if the ring is full, the read can be retried next frame.
+	std::shared_ptr<ReadbackFuture> ReadBuffer(VkCommandBuffer CmdBuffer, const Buffer& SrcBuffer, VkDeviceSize Offset, VkDeviceSize Size,
+											   VkPipelineStageFlags2 SrcStages, VkAccessFlags2 SrcAccess, ReadbackCallback Callback = nullptr);
+
+	// Records a copy of a region of one mip level and layer, tightly packed. The texture goes back to its previous layout after the copy.
+	// Only the depth aspect of depth stencil formats is read.
+	std::shared_ptr<ReadbackFuture> ReadTexture(VkCommandBuffer CmdBuffer, Texture& SrcTexture, uint32_t MipLevel, uint32_t Layer,
+												VkOffset3D Offset, VkExtent3D Extent, ReadbackCallback Callback = nullptr);
+
+	// Delivers every read whose submit has completed, without waiting. Needs to be called once per frame from the thread that owns the ring.
+	void Update();
+
+	VkDeviceSize GetCapacity() const { return Capacity; }
+	VkDeviceSize GetUsedSize() const { return Head - Tail; }
+
+private:
+	struct PendingRead
+	{
+		uint64_t SubmitIndex;
+		uint64_t Start;
+		uint64_t End;
+		VkDeviceSize Size;
+
+		std::shared_ptr<ReadbackFuture> Future;
+		ReadbackCallback Callback;
+	};
+
+	// Returns false if there is no space, Start is the ring position the data is copied to
+	bool Allocate(VkDeviceSize Size, uint64_t& OutStart);
+
+	void MakeHostVisible(VkCommandBuffer CmdBuffer, uint64_t Start, VkDeviceSize Size);
+
+	std::shared_ptr<ReadbackFuture> AddPendingRead(uint64_t Start, VkDeviceSize Size, ReadbackCallback&& Callback);
+
+private:
+	CommandQueueManager& Queue;
+
+	std::shared_ptr<Buffer> RingBuffer;
+	const uint8_t* MappedData = nullptr;
+	VkDeviceSize Capacity = 0;
+
+	// Positions only ever increase, the offset into the buffer is Position % Capacity
+	uint64_t Head = 0;
+	uint64_t Tail = 0;
+
+	// In submit order, so reads complete front to back
+	std::deque<PendingRead> PendingReads;
+
+	BarrierBuilder CopyBarriers;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
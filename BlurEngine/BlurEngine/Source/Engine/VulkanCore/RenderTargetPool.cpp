@@ -0,0 +1,321 @@
+#include "RenderTargetPool.h"
+#include "Context.h"
+#include "Texture.h"
+#include "BarrierBuilder.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace VulkanCore
+{
+
+	static TextureCreateInfo MakeTextureCreateInfo(const RenderTargetDesc& Desc)
+	{
+		TextureCreateInfo CreateInfo;
+		CreateInfo.Type = VK_IMAGE_TYPE_2D;
+		CreateInfo.Format = Desc.Format;
+		CreateInfo.Flags = 0;
+		CreateInfo.UsageFlags = Desc.UsageFlags | (Desc.bTransient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+		CreateInfo.Extents = VkExtent3D{Desc.Extents.width, Desc.Extents.height, 1};
+		CreateInfo.NumMipLevels = 1;
+		CreateInfo.LayerCount = Desc.LayerCount;
+		CreateInfo.MemoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		CreateInfo.MsaaSamples = Desc.MsaaSamples;
+		CreateInfo.bGenerateMips = false;
+		CreateInfo.bDedicatedMemory = false;
+		CreateInfo.Name = Desc.Name;
+
+		return CreateInfo;
+	}
+
+	RenderTargetPool::RenderTargetPool(const Context& InContext, const std::string& Name)
+		: DeviceContext{InContext}, Allocator{InContext.GetAllocator()}, DebugName{Name}
+	{
+	}
+
+	RenderTargetPool::~RenderTargetPool()
+	{
+		// Images have to go before the memory they are bound to
+		DeclaredTargets.Clear();
+		CachedTargets.clear();
+
+		for(const MemoryBlock& Block : MemoryBlocks)
+		{
+			ReleaseMemory(Block);
+		}
+	}
+
+	RenderTargetHandle RenderTargetPool::DeclareTarget(const RenderTargetDesc& Desc, uint32_t FirstPass, uint32_t LastPass)
+	{
+		ASSERT(FirstPass <= LastPass, "Render target has to be used by at least one pass!");
+
+		DeclaredRenderTarget Target;
+		Target.Desc = Desc;
+		Target.FirstPass = FirstPass;
+		Target.LastPass = LastPass;
+
+		return DeclaredTargets.Allocate(std::move(Target));
+	}
+
+	bool RenderTargetPool::Compile()
+	{
+		RequestedMemorySize = 0;
+
+		// Nothing is freed until the next Reset, so positions in this array can stand in for handles
+		std::vector<DeclaredRenderTarget>& Targets = DeclaredTargets.GetObjects();
+
+		for(DeclaredRenderTarget& Target : Targets)
+		{
+			const VkImageCreateInfo ImageInfo = Texture::MakeImageCreateInfo(MakeTextureCreateInfo(Target.Desc));
+
+			VkDeviceImageMemoryRequirements RequirementsInfo{};
+			RequirementsInfo.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+			RequirementsInfo.pCreateInfo = &ImageInfo;
+			RequirementsInfo.pNext = VK_NULL_HANDLE;
+
+			VkMemoryRequirements2 Requirements{};
+			Requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+			Requirements.pNext = VK_NULL_HANDLE;
+
+			vkGetDeviceImageMemoryRequirements(DeviceContext.GetDevice(), &RequirementsInfo, &Requirements);
+
+			Target.MemoryRequirements = Requirements.memoryRequirements;
+			Target.Block = UINT32_MAX;
+			Target.AliasPredecessor = UINT32_MAX;
+			RequestedMemorySize += Target.MemoryRequirements.size;
+		}
+
+		// Largest targets are placed first so the smaller ones can fill in blocks already sized for them
+		std::vector<uint32_t> PlacementOrder(Targets.size());
+		std::iota(PlacementOrder.begin(), PlacementOrder.end(), 0);
+		std::stable_sort(PlacementOrder.begin(), PlacementOrder.end(), [&Targets](uint32_t A, uint32_t B)
+		{
+			return Targets[A].MemoryRequirements.size > Targets[B].MemoryRequirements.size;
+		});
+
+		std::vector<MemoryBlock> OldBlocks = std::move(MemoryBlocks);
+		MemoryBlocks.clear();
+
+		for(const uint32_t TargetIndex : PlacementOrder)
+		{
+			DeclaredRenderTarget& Target = Targets[TargetIndex];
+
+			uint32_t BlockIndex = 0;
+			while(BlockIndex < (uint32_t)MemoryBlocks.size() && !CanPlaceInBlock(MemoryBlocks[BlockIndex], TargetIndex))
+			{
+				BlockIndex++;
+			}
+
+			if(BlockIndex == (uint32_t)MemoryBlocks.size())
+			{
+				MemoryBlock NewBlock;
+				NewBlock.MemoryTypeBits = Target.MemoryRequirements.memoryTypeBits;
+				NewBlock.bLazilyAllocated = Target.Desc.bTransient;
+				MemoryBlocks.emplace_back(NewBlock);
+			}
+
+			MemoryBlock& Block = MemoryBlocks[BlockIndex];
+			Block.Size = std::max(Block.Size, Target.MemoryRequirements.size);
+			Block.Alignment = std::max(Block.Alignment, Target.MemoryRequirements.alignment);
+			Block.MemoryTypeBits &= Target.MemoryRequirements.memoryTypeBits;
+			Block.Targets.push_back(TargetIndex);
+
+			Target.Block = BlockIndex;
+		}
+
+		for(MemoryBlock& Block : MemoryBlocks)
+		{
+			std::sort(Block.Targets.begin(), Block.Targets.end(), [&Targets](uint32_t A, uint32_t B)
+			{
+				return Targets[A].FirstPass < Targets[B].FirstPass;
+			});
+
+			// The first target of a frame follows the last target of the previous frame
+			const size_t NumTargets = Block.Targets.size();
+			for(size_t Index = 0; Index < NumTargets; Index++)
+			{
+				Targets[Block.Targets[Index]].AliasPredecessor = Block.Targets[(Index + NumTargets - 1) % NumTargets];
+			}
+
+			Block.Allocation = AcquireMemory(Block, OldBlocks);
+		}
+
+		bool bTargetsChanged = false;
+
+		std::vector<CachedTarget> OldTargets = std::move(CachedTargets);
+		CachedTargets.clear();
+
+		for(DeclaredRenderTarget& Target : Targets)
+		{
+			const VmaAllocation BlockMemory = MemoryBlocks[Target.Block].Allocation;
+
+			const auto CachedIt = std::find_if(OldTargets.begin(), OldTargets.end(), [&Target, BlockMemory](const CachedTarget& Cached)
+			{
+				return Cached.Allocation == BlockMemory && Cached.Desc == Target.Desc;
+			});
+
+			if(CachedIt != OldTargets.end())
+			{
+				Target.Target = CachedIt->Target;
+				OldTargets.erase(CachedIt);
+			}
+			else
+			{
+				Target.Target = std::make_shared<Texture>(DeviceContext, MakeTextureCreateInfo(Target.Desc), BlockMemory);
+				bTargetsChanged = true;
+			}
+
+			CachedTargets.push_back({Target.Desc, BlockMemory, Target.Target});
+		}
+
+		bTargetsChanged |= !OldTargets.empty();
+		OldTargets.clear();
+
+		for(const MemoryBlock& Block : OldBlocks)
+		{
+			ReleaseMemory(Block);
+		}
+
+#if _DEBUG
+		BE_INFO("{0}: {1} render targets placed in {2} memory blocks, {3} bytes allocated for {4} bytes requested",
+				DebugName, DeclaredTargets.GetSize(), MemoryBlocks.size(), GetAllocatedMemorySize(), RequestedMemorySize);
+#endif
+
+		return bTargetsChanged;
+	}
+
+	void RenderTargetPool::Reset()
+	{
+		DeclaredTargets.Clear();
+	}
+
+	const std::shared_ptr<Texture>& RenderTargetPool::GetTarget(RenderTargetHandle Target) const
+	{
+		const DeclaredRenderTarget& Declared = GetDeclaredTarget(Target);
+		ASSERT(Declared.Target != nullptr, "Render target pool needs to be compiled before targets can be used!");
+
+		return Declared.Target;
+	}
+
+	void RenderTargetPool::TransitionForFirstUse(RenderTargetHandle Target, BarrierBuilder& Barriers, VkImageLayout NewLayout, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess)
+	{
+		const std::shared_ptr<Texture>& TargetTexture = GetTarget(Target);
+		const std::shared_ptr<Texture>& Predecessor = DeclaredTargets.GetObjects()[GetDeclaredTarget(Target).AliasPredecessor].Target;
+
+		SubresourceState DiscardedState;
+		for(uint32_t Layer = 0; Layer < Predecessor->GetLayerCount(); Layer++)
+		{
+			for(uint32_t Mip = 0; Mip < Predecessor->GetMipLevels(); Mip++)
+			{
+				const SubresourceState& LastUse = Predecessor->GetSubresourceState(Mip, Layer);
+				DiscardedState.Stages |= LastUse.Stages;
+				DiscardedState.Access |= LastUse.Access;
+			}
+		}
+
+		// Old contents are discarded, but the transition still has to wait on whoever used the memory last
+		TargetTexture->SetSubresourceState(DiscardedState);
+		Barriers.TransitionImage(*TargetTexture, NewLayout, DstStages, DstAccess);
+	}
+
+	const DeclaredRenderTarget& RenderTargetPool::GetDeclaredTarget(RenderTargetHandle Target) const
+	{
+		ASSERT(DeclaredTargets.IsValid(Target), "Invalid render target handle or it was declared before the pool was reset!");
+		return DeclaredTargets[Target];
+	}
+
+	VkDeviceSize RenderTargetPool::GetAllocatedMemorySize() const
+	{
+		VkDeviceSize TotalSize = 0;
+		for(const MemoryBlock& Block : MemoryBlocks)
+		{
+			TotalSize += Block.Size;
+		}
+
+		return TotalSize;
+	}
+
+	bool RenderTargetPool::LifetimesOverlap(const DeclaredRenderTarget& A, const DeclaredRenderTarget& B)
+	{
+		return A.FirstPass <= B.LastPass && B.FirstPass <= A.LastPass;
+	}
+
+	bool RenderTargetPool::CanPlaceInBlock(const MemoryBlock& Block, uint32_t TargetIndex) const
+	{
+		const std::vector<DeclaredRenderTarget>& Targets = DeclaredTargets.GetObjects();
+		const DeclaredRenderTarget& Target = Targets[TargetIndex];
+
+		if(Block.bLazilyAllocated != Target.Desc.bTransient || (Block.MemoryTypeBits & Target.MemoryRequirements.memoryTypeBits) == 0)
+		{
+			return false;
+		}
+
+		return std::none_of(Block.Targets.begin(), Block.Targets.end(), [&Targets, &Target](uint32_t Other)
+		{
+			return LifetimesOverlap(Target, Targets[Other]);
+		});
+	}
+
+	VmaAllocation RenderTargetPool::AcquireMemory(MemoryBlock& Block, std::vector<MemoryBlock>& OldBlocks)
+	{
+		// Memory from the last compile is reused if it is still big enough, so shrinking the window doesn't cause any allocations
+		for(auto It = OldBlocks.begin(); It != OldBlocks.end(); ++It)
+		{
+			VmaAllocationInfo AllocationInfo;
+			vmaGetAllocationInfo(Allocator, It->Allocation, &AllocationInfo);
+
+			const bool bCompatibleType = (Block.MemoryTypeBits & (1u << AllocationInfo.memoryType)) != 0;
+			if(bCompatibleType && It->bLazilyAllocated == Block.bLazilyAllocated && It->Size >= Block.Size && It->Alignment >= Block.Alignment)
+			{
+				const VmaAllocation Reused = It->Allocation;
+				Block.Size = It->Size;
+				Block.Alignment = It->Alignment;
+				OldBlocks.erase(It);
+				return Reused;
+			}
+		}
+
+		VkMemoryRequirements Requirements;
+		Requirements.size = Block.Size;
+		Requirements.alignment = Block.Alignment;
+		Requirements.memoryTypeBits = Block.MemoryTypeBits;
+
+		VmaAllocationCreateInfo AllocInfo{};
+		AllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		AllocInfo.usage = VMA_MEMORY_USAGE_UNKNOWN;
+		AllocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (Block.bLazilyAllocated ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+		AllocInfo.priority = 1.0f;
+
+		VmaAllocation Allocation = nullptr;
+		VkResult Result = vmaAllocateMemory(Allocator, &Requirements, &AllocInfo, &Allocation, nullptr);
+
+		if(Result != VK_SUCCESS && Block.bLazilyAllocated)
+		{
+			// Most desktop GPUs don't expose lazily allocated memory
+			AllocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			Result = vmaAllocateMemory(Allocator, &Requirements, &AllocInfo, &Allocation, nullptr);
+		}
+
+		VK_CHECK(Result);
+
+		vmaSetAllocationName(Allocator, Allocation, (DebugName + " Block").c_str());
+
+		if(MemoryBudgetTracker* MemoryTracker = DeviceContext.GetMemoryTracker())
+		{
+			MemoryTracker->TrackAllocation(MemoryCategory::RenderTargets, Block.Size);
+		}
+
+		return Allocation;
+	}
+
+	void RenderTargetPool::ReleaseMemory(const MemoryBlock& Block)
+	{
+		if(MemoryBudgetTracker* MemoryTracker = DeviceContext.GetMemoryTracker())
+		{
+			MemoryTracker->UntrackAllocation(MemoryCategory::RenderTargets, Block.Size);
+		}
+
+		vmaFreeMemory(Allocator, Block.Allocation);
+	}
+
+}
\ No newline at end of file
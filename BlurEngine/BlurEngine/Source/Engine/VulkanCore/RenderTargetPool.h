@@ -0,0 +1,123 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+#include "Handle.h"
+
+#include <vma/vk_mem_alloc.h>
+
+namespace VulkanCore
+{
+
+class Context;
+class Texture;
+class BarrierBuilder;
+
+struct RenderTargetDesc
+{
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	VkExtent2D Extents = {0, 0};
+	VkImageUsageFlags UsageFlags = 0;
+	VkSampleCountFlagBits MsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	uint32_t LayerCount = 1;
+	// Transient targets never leave tile memory (load/store ops DONT_CARE) and are backed by lazily allocated memory when available
+	bool bTransient = false;
+	std::string Name = "";
+
+	bool operator==(const RenderTargetDesc& Other) const
+	{
+		return Format == Other.Format && Extents.width == Other.Extents.width && Extents.height == Other.Extents.height &&
+			   UsageFlags == Other.UsageFlags && MsaaSamples == Other.MsaaSamples && LayerCount == Other.LayerCount && bTransient == Other.bTransient;
+	}
+};
+
+// A target declared for the current set of passes, only accessed by the pool that declared it
+struct DeclaredRenderTarget
+{
+	RenderTargetDesc Desc;
+	uint32_t FirstPass = 0;
+	uint32_t LastPass = 0;
+
+	VkMemoryRequirements MemoryRequirements{};
+	uint32_t Block = UINT32_MAX;
+	// Position of the target that used the same memory right before this one
+	uint32_t AliasPredecessor = UINT32_MAX;
+
+	std::shared_ptr<Texture> Target;
+};
+
+// Declarations live in a HandlePool that Reset clears, so handles kept across a Reset are caught instead of aliasing another target
+using RenderTargetHandle = Handle<DeclaredRenderTarget>;
+
+// Hands out render targets for a set of passes. Targets are declared with the range of passes they are used in,
+// targets whose ranges don't overlap share the same memory, and textures and memory are kept between compiles
+// so they get reused across frames and window resizes.
+class RenderTargetPool final
+{
+public:
+	MOVABLE_ONLY(RenderTargetPool);
+
+	explicit RenderTargetPool(const Context& InContext, const std::string& Name = "");
+	~RenderTargetPool();
+
+	// Returns a handle to the target, used from FirstPass up to and including LastPass
+	RenderTargetHandle DeclareTarget(const RenderTargetDesc& Desc, uint32_t FirstPass, uint32_t LastPass);
+
+	// Places every declared target into memory. Returns true if any texture changed, which means framebuffers referencing them need to be recreated.
+	// None of the pool's targets can be in use by the GPU while compiling.
+	bool Compile();
+
+	// Clears the declarations, memory and textures stay around to be reused by the next Compile
+	void Reset();
+
+	const std::shared_ptr<Texture>& GetTarget(RenderTargetHandle Target) const;
+
+	// Transitions a target for the first pass it is used in. Its contents are undefined, but the pass needs to wait on the
+	// last target that used the same memory.
+	void TransitionForFirstUse(RenderTargetHandle Target, BarrierBuilder& Barriers, VkImageLayout NewLayout, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess);
+
+	VkDeviceSize GetAllocatedMemorySize() const;
+	VkDeviceSize GetRequestedMemorySize() const { return RequestedMemorySize; }
+
+private:
+	struct MemoryBlock
+	{
+		VmaAllocation Allocation = nullptr;
+		VkDeviceSize Size = 0;
+		VkDeviceSize Alignment = 0;
+		uint32_t MemoryTypeBits = 0;
+		bool bLazilyAllocated = false;
+
+		// Positions of the targets in DeclaredTargets' objects, which don't move until the next Reset
+		std::vector<uint32_t> Targets;
+	};
+
+	struct CachedTarget
+	{
+		RenderTargetDesc Desc;
+		VmaAllocation Allocation = nullptr;
+		std::shared_ptr<Texture> Target;
+	};
+
+	const DeclaredRenderTarget& GetDeclaredTarget(RenderTargetHandle Target) const;
+
+	static bool LifetimesOverlap(const DeclaredRenderTarget& A, const DeclaredRenderTarget& B);
+
+	bool CanPlaceInBlock(const MemoryBlock& Block, uint32_t TargetIndex) const;
+	VmaAllocation AcquireMemory(MemoryBlock& Block, std::vector<MemoryBlock>& OldBlocks);
+	void ReleaseMemory(const MemoryBlock& Block);
+
+private:
+	const Context& DeviceContext;
+	VmaAllocator Allocator = nullptr;
+
+	HandlePool<DeclaredRenderTarget> DeclaredTargets;
+	std::vector<MemoryBlock> MemoryBlocks;
+	std::vector<CachedTarget> CachedTargets;
+
+	VkDeviceSize RequestedMemorySize = 0;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
@@ -25,4 +25,21 @@ namespace VulkanCore
 		VK_CHECK(vkCreateSampler(VulkanDevice, &CreateInfo, nullptr, &VulkanSampler));
 	}
 
+	Sampler::Sampler(Sampler&& Other) noexcept
+		: VulkanDevice{Other.VulkanDevice}, VulkanSampler{std::exchange(Other.VulkanSampler, VK_NULL_HANDLE)}
+	{
+	}
+
+	Sampler& Sampler::operator=(Sampler&& Other) noexcept
+	{
+		if(this != &Other)
+		{
+			vkDestroySampler(VulkanDevice, VulkanSampler, nullptr);
+			VulkanDevice = Other.VulkanDevice;
+			VulkanSampler = std::exchange(Other.VulkanSampler, VK_NULL_HANDLE);
+		}
+
+		return *this;
+	}
+
 }
\ No newline at end of file
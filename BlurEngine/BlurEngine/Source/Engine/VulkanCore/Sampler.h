@@ -2,6 +2,7 @@
 
 #include "VulkanCommon.h"
 #include "Utility.h"
+#include "Handle.h"
 
 namespace VulkanCore
 {
@@ -22,12 +23,25 @@ struct SamplerCreateInfo
 	VkCompareOp CompareOp;
 
 	std::string Name;
+
+	// Name is only used for debugging, two infos that only differ by name describe the same VkSampler
+	bool operator==(const SamplerCreateInfo& Other) const
+	{
+		return MinFilter == Other.MinFilter && MagFilter == Other.MagFilter && AddressModeU == Other.AddressModeU &&
+			   AddressModeV == Other.AddressModeV && AddressModeW == Other.AddressModeW && MaxLod == Other.MaxLod &&
+			   bEnableCompare == Other.bEnableCompare && (!bEnableCompare || CompareOp == Other.CompareOp);
+	}
 };
 
 class Sampler final
 {
 public:
-	MOVABLE_ONLY(Sampler);
+	Sampler(const Sampler&) = delete;
+	Sampler& operator=(const Sampler&) = delete;
+
+	// Samplers are stored by value in a HandlePool, a moved from sampler must not destroy the VkSampler it handed over
+	Sampler(Sampler&& Other) noexcept;
+	Sampler& operator=(Sampler&& Other) noexcept;
 
 	explicit Sampler(const Context& DeviceContext, const SamplerCreateInfo& SamplerInfo);
 
@@ -43,4 +57,25 @@ private:
 	VkSampler VulkanSampler = VK_NULL_HANDLE;
 };
 
+using SamplerHandle = Handle<Sampler>;
+
+}
+
+namespace std
+{
+	template<>
+	struct hash<VulkanCore::SamplerCreateInfo>
+	{
+		size_t operator()(const VulkanCore::SamplerCreateInfo& Info) const
+		{
+			size_t Seed = 0;
+			Util::HashCombine(Seed, Info.MinFilter, Info.MagFilter, Info.AddressModeU, Info.AddressModeV, Info.AddressModeW, Info.MaxLod, Info.bEnableCompare);
+			if(Info.bEnableCompare)
+			{
+				Util::HashCombine(Seed, Info.CompareOp);
+			}
+
+			return Seed;
+		}
+	};
 }
\ No newline at end of file
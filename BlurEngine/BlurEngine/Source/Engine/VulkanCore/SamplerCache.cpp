@@ -0,0 +1,61 @@
+#include "SamplerCache.h"
+#include "Context.h"
+#include "Pipeline.h"
+
+namespace VulkanCore
+{
+
+	SamplerCache::SamplerCache(const Context& InContext, uint32_t InTableSize, const std::string& Name)
+		: DeviceContext{InContext}, TableSize{InTableSize}, DebugName{"Sampler Cache: " + Name}
+	{
+		Samplers.Reserve(TableSize);
+	}
+
+	uint32_t SamplerCache::RequestSampler(const SamplerCreateInfo& CreateInfo)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		auto Itr = SamplerIndices.find(CreateInfo);
+		if(Itr != SamplerIndices.end())
+		{
+			return Itr->second;
+		}
+
+		if(Samplers.GetSize() >= TableSize)
+		{
+			BE_ERROR("{0} is full, returning the first sampler in the table instead of creating {1}", DebugName, CreateInfo.Name);
+			return 0;
+		}
+
+		const uint32_t NewIndex = Samplers.GetSize();
+		Samplers.Allocate(DeviceContext, CreateInfo);
+		SamplerIndices[CreateInfo] = NewIndex;
+
+		return NewIndex;
+	}
+
+	const Sampler& SamplerCache::GetSampler(uint32_t Index) const
+	{
+		ASSERT(Index < Samplers.GetSize(), "Sampler index is outside of the sampler table!");
+		return Samplers.GetObjects()[Index];
+	}
+
+	void SamplerCache::WriteSamplerTable(Pipeline& TargetPipeline, uint32_t Set, uint32_t Binding, uint32_t SetIndex)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		uint32_t& WrittenCount = WrittenCounts[{&TargetPipeline, Set, Binding, SetIndex}];
+
+		const std::vector<Sampler>& TableSamplers = Samplers.GetObjects();
+		if(WrittenCount >= TableSamplers.size())
+		{
+			return;
+		}
+
+		std::span<const Sampler> NewSamplers(TableSamplers.begin() + WrittenCount, TableSamplers.end());
+		TargetPipeline.BindResource(Set, Binding, SetIndex, NewSamplers, WrittenCount);
+
+		WrittenCount = Samplers.GetSize();
+	}
+
+}
\ No newline at end of file
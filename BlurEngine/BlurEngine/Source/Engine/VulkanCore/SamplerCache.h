@@ -0,0 +1,72 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+#include "Sampler.h"
+
+#include <unordered_map>
+#include <mutex>
+
+namespace VulkanCore
+{
+
+class Context;
+class Pipeline;
+
+// Deduplicates samplers and keeps them in a global sampler table. Materials reference samplers 
+// by their index in the table, so the table only needs to be bound once per frame.
+// Samplers live by value in a HandlePool and are never freed, so their dense order is the table order.
+class SamplerCache final
+{
+public:
+	MOVABLE_ONLY(SamplerCache);
+
+	explicit SamplerCache(const Context& InContext, uint32_t InTableSize, const std::string& Name = "");
+
+	// Returns the table index of a sampler matching CreateInfo, the sampler is only created if no matching one exists
+	uint32_t RequestSampler(const SamplerCreateInfo& CreateInfo);
+
+	// The pool is reserved to the table size up front, the returned sampler stays valid for the lifetime of the cache
+	const Sampler& GetSampler(uint32_t Index) const;
+	uint32_t GetSamplerCount() const { return Samplers.GetSize(); }
+
+	// Writes every sampler the target table hasn't received yet, the first call for a target writes the whole table
+	void WriteSamplerTable(Pipeline& TargetPipeline, uint32_t Set, uint32_t Binding, uint32_t SetIndex = 0);
+
+private:
+	// Every pipeline, set and set index holds its own copy of the table, so each one tracks how much of it was written
+	struct TableTarget
+	{
+		const Pipeline* TargetPipeline = nullptr;
+		uint32_t Set = 0;
+		uint32_t Binding = 0;
+		uint32_t SetIndex = 0;
+
+		bool operator==(const TableTarget& Other) const = default;
+	};
+
+	struct TableTargetHasher
+	{
+		size_t operator()(const TableTarget& Target) const
+		{
+			size_t Seed = 0;
+			Util::HashCombine(Seed, Target.TargetPipeline, Target.Set, Target.Binding, Target.SetIndex);
+			return Seed;
+		}
+	};
+
+	const Context& DeviceContext;
+
+	std::unordered_map<SamplerCreateInfo, uint32_t> SamplerIndices;
+	HandlePool<Sampler> Samplers;
+
+	// Samplers in the range [WrittenCount, Samplers.GetSize()) have not been written to that target yet
+	std::unordered_map<TableTarget, uint32_t, TableTargetHasher> WrittenCounts;
+	uint32_t TableSize = 0;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
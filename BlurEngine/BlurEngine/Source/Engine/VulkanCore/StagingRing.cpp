@@ -0,0 +1,291 @@
+#include "StagingRing.h"
+#include "Context.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "CommandQueueManager.h"
+#include "BarrierBuilder.h"
+
+#include <algorithm>
+
+namespace VulkanCore
+{
+
+	// Capacity is kept a multiple of this so aligned positions stay aligned after wrapping
+	static constexpr VkDeviceSize MAX_STAGING_ALIGNMENT = 256;
+
+	StagingRing::StagingRing(const Context& DeviceContext, CommandQueueManager& InQueue, VkDeviceSize InCapacity, const std::string& Name)
+		: Queue{InQueue}, Capacity{(InCapacity + MAX_STAGING_ALIGNMENT - 1) & ~(MAX_STAGING_ALIGNMENT - 1)}, DebugName{Name}
+	{
+		RingBuffer = DeviceContext.CreateBuffer(Capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsagePolicy::Staging, "Staging Ring: " + Name);
+		MappedData = static_cast<uint8_t*>(RingBuffer->GetMappedMemory());
+
+		ASSERT(MappedData != nullptr, "Staging ring memory has to be persistently mapped!");
+	}
+
+	bool StagingRing::Upload(const void* Data, VkDeviceSize Size, const Buffer& DstBuffer, VkDeviceSize DstOffset)
+	{
+		ASSERT(Size > 0 && Size <= Capacity, "Staging allocation has to fit into the ring!");
+		ASSERT(DstOffset + Size <= DstBuffer.GetSize(), "Staging copy is outside of the destination buffer!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		const StagingAllocation Allocation = AllocateRegion(Size, 16);
+		if(!Allocation.IsValid())
+		{
+			return false;
+		}
+
+		CopyIntoRing(Allocation, Data);
+		AddPendingCopy(Allocation, DstBuffer.GetVkBuffer(), DstOffset);
+
+		return true;
+	}
+
+	bool StagingRing::Upload(std::span<const StagingUploadRegion> Regions, const Buffer& DstBuffer)
+	{
+		VkDeviceSize TotalSize = 0;
+		for(const StagingUploadRegion& Region : Regions)
+		{
+			ASSERT(Region.DstOffset + Region.Size <= DstBuffer.GetSize(), "Staging copy is outside of the destination buffer!");
+			TotalSize += Region.Size;
+		}
+
+		if(TotalSize == 0)
+		{
+			return true;
+		}
+
+		ASSERT(TotalSize <= Capacity, "Staging allocation has to fit into the ring!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		const StagingAllocation Allocation = AllocateRegion(TotalSize, 16);
+		if(!Allocation.IsValid())
+		{
+			return false;
+		}
+
+		VkDeviceSize StagingOffset = 0;
+		for(const StagingUploadRegion& Region : Regions)
+		{
+			if(Region.Size == 0)
+			{
+				continue;
+			}
+
+			StagingAllocation RegionAllocation;
+			RegionAllocation.MappedData = static_cast<uint8_t*>(Allocation.MappedData) + StagingOffset;
+			RegionAllocation.Offset = Allocation.Offset + StagingOffset;
+			RegionAllocation.Size = Region.Size;
+
+			CopyIntoRing(RegionAllocation, Region.Data);
+			AddPendingCopy(RegionAllocation, DstBuffer.GetVkBuffer(), Region.DstOffset);
+
+			StagingOffset += Region.Size;
+		}
+
+		return true;
+	}
+
+	bool StagingRing::UploadTexture(const void* Data, VkDeviceSize Size, const std::shared_ptr<Texture>& DstTexture, uint32_t MipLevel, uint32_t Layer)
+	{
+		ASSERT(DstTexture && MipLevel < DstTexture->GetMipLevels() && Layer < DstTexture->GetLayerCount(), "Staging copy is outside of the destination texture!");
+		ASSERT(Size > 0 && Size <= Capacity, "Staging allocation has to fit into the ring!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		// Buffer to image copies need their source offset aligned to the texel size, which is never larger than 16 bytes
+		const StagingAllocation Allocation = AllocateRegion(Size, 16);
+		if(!Allocation.IsValid())
+		{
+			return false;
+		}
+
+		CopyIntoRing(Allocation, Data);
+
+		const VkExtent3D Extents = DstTexture->GetExtents();
+
+		PendingTextureCopy Copy;
+		Copy.DstTexture = DstTexture;
+		Copy.Region = {};
+		Copy.Region.bufferOffset = Allocation.Offset;
+		Copy.Region.bufferRowLength = 0;
+		Copy.Region.bufferImageHeight = 0;
+		Copy.Region.imageSubresource = {DstTexture->GetFullAspectMask(), MipLevel, Layer, 1};
+		Copy.Region.imageOffset = {0, 0, 0};
+		Copy.Region.imageExtent = {std::max(Extents.width >> MipLevel, 1u), std::max(Extents.height >> MipLevel, 1u), std::max(Extents.depth >> MipLevel, 1u)};
+
+		PendingTextureCopies.push_back(std::move(Copy));
+		return true;
+	}
+
+	StagingAllocation StagingRing::AllocateRegion(VkDeviceSize Size, VkDeviceSize Alignment)
+	{
+		auto FindStart = [this, Size, Alignment](uint64_t& OutStart)
+		{
+			uint64_t Start = (Head + Alignment - 1) & ~(Alignment - 1);
+
+			// Regions never wrap around the end of the buffer, the rest of the buffer is skipped instead
+			const VkDeviceSize Offset = Start % Capacity;
+			if(Offset + Size > Capacity)
+			{
+				Start += Capacity - Offset;
+			}
+
+			OutStart = Start;
+			return Start + Size - Tail <= Capacity;
+		};
+
+		uint64_t Start = 0;
+		if(!FindStart(Start))
+		{
+			ReclaimCompleted();
+
+			if(!FindStart(Start))
+			{
+				return StagingAllocation{};
+			}
+		}
+
+		Head = Start + Size;
+
+		const VkDeviceSize Offset = Start % Capacity;
+		return StagingAllocation{MappedData + Offset, Offset, Size};
+	}
+
+	void StagingRing::AddPendingCopy(const StagingAllocation& Allocation, VkBuffer DstBuffer, VkDeviceSize DstOffset)
+	{
+		VkBufferCopy Region{};
+		Region.srcOffset = Allocation.Offset;
+		Region.dstOffset = DstOffset;
+		Region.size = Allocation.Size;
+
+		PendingCopies[DstBuffer].push_back(Region);
+	}
+
+	void StagingRing::CopyIntoRing(const StagingAllocation& Allocation, const void* Data) const
+	{
+		// The ring is only ever written on the CPU, streaming stores keep uploads from evicting the cache on write-combined memory
+		if(RingBuffer->IsWriteCombined())
+		{
+			Buffer::StreamCopy(Allocation.MappedData, Data, Allocation.Size);
+		}
+		else
+		{
+			memcpy(Allocation.MappedData, Data, Allocation.Size);
+		}
+	}
+
+	void StagingRing::RecordCopies(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(PendingCopies.empty() && PendingTextureCopies.empty())
+		{
+			return;
+		}
+
+		FlushWrittenRange();
+
+		for(auto& [DstBuffer, Regions] : PendingCopies)
+		{
+			// Uploads written back to back usually land back to back in the destination too, those become a single region
+			std::sort(Regions.begin(), Regions.end(), [](const VkBufferCopy& A, const VkBufferCopy& B)
+			{
+				return A.srcOffset < B.srcOffset;
+			});
+
+			size_t NumRegions = 0;
+			for(const VkBufferCopy& Region : Regions)
+			{
+				if(NumRegions > 0)
+				{
+					VkBufferCopy& Previous = Regions[NumRegions - 1];
+					if(Previous.srcOffset + Previous.size == Region.srcOffset && Previous.dstOffset + Previous.size == Region.dstOffset)
+					{
+						Previous.size += Region.size;
+						continue;
+					}
+				}
+
+				Regions[NumRegions++] = Region;
+			}
+
+			vkCmdCopyBuffer(CmdBuffer, RingBuffer->GetVkBuffer(), DstBuffer, (uint32_t)NumRegions, Regions.data());
+
+			Barriers.BufferBarrier(DstBuffer, 0, VK_WHOLE_SIZE, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, DstStages, DstAccess);
+		}
+
+		PendingCopies.clear();
+
+		if(!PendingTextureCopies.empty())
+		{
+			for(const PendingTextureCopy& Copy : PendingTextureCopies)
+			{
+				const VkImageSubresourceLayers& Subresource = Copy.Region.imageSubresource;
+				Barriers.TransitionImage(*Copy.DstTexture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+										 Subresource.mipLevel, 1, Subresource.baseArrayLayer, 1);
+			}
+
+			Barriers.Flush(CmdBuffer);
+
+			for(const PendingTextureCopy& Copy : PendingTextureCopies)
+			{
+				const VkImageSubresourceLayers& Subresource = Copy.Region.imageSubresource;
+				vkCmdCopyBufferToImage(CmdBuffer, RingBuffer->GetVkBuffer(), Copy.DstTexture->GetVkImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Copy.Region);
+
+				Barriers.TransitionImage(*Copy.DstTexture, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+										 VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, Subresource.mipLevel, 1, Subresource.baseArrayLayer, 1);
+			}
+
+			PendingTextureCopies.clear();
+		}
+
+		InFlightRegions.push_back({Queue.GetNextSubmitIndex(), Head});
+	}
+
+	void StagingRing::Reclaim()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		ReclaimCompleted();
+	}
+
+	void StagingRing::ReclaimCompleted()
+	{
+		if(InFlightRegions.empty())
+		{
+			return;
+		}
+
+		const uint64_t CompletedSubmit = Queue.GetCompletedSubmitIndex();
+		while(!InFlightRegions.empty() && InFlightRegions.front().SubmitIndex <= CompletedSubmit)
+		{
+			Tail = InFlightRegions.front().End;
+			InFlightRegions.pop_front();
+		}
+	}
+
+	void StagingRing::FlushWrittenRange()
+	{
+		if(FlushedHead == Head)
+		{
+			return;
+		}
+
+		// Only does anything on non-coherent memory
+		const VkDeviceSize Start = FlushedHead % Capacity;
+		const VkDeviceSize Length = Head - FlushedHead;
+		if(Start + Length <= Capacity)
+		{
+			RingBuffer->Upload(Start, Length);
+		}
+		else
+		{
+			RingBuffer->Upload(Start, Capacity - Start);
+			RingBuffer->Upload(0, Length - (Capacity - Start));
+		}
+
+		FlushedHead = Head;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <deque>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+namespace VulkanCore
+{
+
+class Context;
+class Buffer;
+class Texture;
+class CommandQueueManager;
+class BarrierBuilder;
+
+struct StagingAllocation
+{
+	void* MappedData = nullptr;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+
+	bool IsValid() const { return MappedData != nullptr; }
+};
+
+// One piece of a multi-region upload into the same destination buffer
+struct StagingUploadRegion
+{
+	const void* Data = nullptr;
+	VkDeviceSize Size = 0;
+	VkDeviceSize DstOffset = 0;
+};
+
+// Persistently mapped upload buffer that is sub-allocated as a ring. Regions are handed back once the submit that
+// copied out of them has completed, so uploads never create or destroy any Vulkan objects.
+class StagingRing final
+{
+public:
+	MOVABLE_ONLY(StagingRing);
+
+	explicit StagingRing(const Context& DeviceContext, CommandQueueManager& InQueue, VkDeviceSize InCapacity, const std::string& Name = "");
+
+	// Allocates, copies Data into the ring and schedules the copy under one lock, so RecordCopies on another thread can't
+	// retire the region before its copy is queued. Regions are never handed out without their copy, RecordCopies retires
+	// everything up to Head. Returns false if there was no space, the upload can be retried after the pending copies have been submitted.
+	bool Upload(const void* Data, VkDeviceSize Size, const Buffer& DstBuffer, VkDeviceSize DstOffset = 0);
+
+	// Uploads every region or none of them, the regions are packed back to back into one allocation of the ring
+	bool Upload(std::span<const StagingUploadRegion> Regions, const Buffer& DstBuffer);
+
+	// Uploads the tightly packed texels of one mip level of one layer. The texture is kept alive until the copy is recorded, it is
+	// moved to TRANSFER_DST_OPTIMAL for the copy and to SHADER_READ_ONLY_OPTIMAL after it.
+	bool UploadTexture(const void* Data, VkDeviceSize Size, const std::shared_ptr<Texture>& DstTexture, uint32_t MipLevel = 0, uint32_t Layer = 0);
+
+	// Records every scheduled copy with one vkCmdCopyBuffer per destination and adds a barrier for each destination to Barriers.
+	// Texture copies flush Barriers once to get their textures into the transfer layout, their transitions back are left in Barriers.
+	// The command buffer has to be submitted through the queue the ring was created with.
+	void RecordCopies(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers, VkPipelineStageFlags2 DstStages, VkAccessFlags2 DstAccess);
+
+	// Hands back regions whose submits have completed on the GPU
+	void Reclaim();
+
+	VkDeviceSize GetCapacity() const { return Capacity; }
+	VkDeviceSize GetUsedSize() const { return Head - Tail; }
+	bool HasPendingCopies() const { return !PendingCopies.empty() || !PendingTextureCopies.empty(); }
+
+private:
+	// Head position the ring can be reclaimed up to once the submit has completed
+	struct InFlightRegion
+	{
+		uint64_t SubmitIndex;
+		uint64_t End;
+	};
+
+	struct PendingTextureCopy
+	{
+		std::shared_ptr<Texture> DstTexture;
+		VkBufferImageCopy Region;
+	};
+
+	// Both expect the mutex to be held, AllocateRegion returns an invalid allocation if the ring is still full after reclaiming
+	StagingAllocation AllocateRegion(VkDeviceSize Size, VkDeviceSize Alignment);
+	void AddPendingCopy(const StagingAllocation& Allocation, VkBuffer DstBuffer, VkDeviceSize DstOffset);
+
+	void CopyIntoRing(const StagingAllocation& Allocation, const void* Data) const;
+
+	void ReclaimCompleted();
+	void FlushWrittenRange();
+
+private:
+	CommandQueueManager& Queue;
+
+	std::shared_ptr<Buffer> RingBuffer;
+	uint8_t* MappedData = nullptr;
+	VkDeviceSize Capacity = 0;
+
+	// Positions only ever increase, the offset into the buffer is Position % Capacity
+	uint64_t Head = 0;
+	uint64_t Tail = 0;
+	uint64_t FlushedHead = 0;
+
+	std::deque<InFlightRegion> InFlightRegions;
+	std::unordered_map<VkBuffer, std::vector<VkBufferCopy>> PendingCopies;
+	std::vector<PendingTextureCopy> PendingTextureCopies;
+
+	std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
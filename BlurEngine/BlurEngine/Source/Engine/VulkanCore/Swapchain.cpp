@@ -1,6 +1,7 @@
 #include "Swapchain.h"
 #include "Context.h"
 #include "Texture.h"
+#include "SyncObjectPool.h"
 
 namespace VulkanCore
 {
@@ -24,10 +25,14 @@ namespace VulkanCore
 
 	Swapchain::~Swapchain()
 	{
-		VK_CHECK(vkWaitForFences(VulkanDevice, 1, &AcquireFence, VK_TRUE, UINT64_MAX));
-		vkDestroyFence(VulkanDevice, AcquireFence, nullptr);
-		vkDestroySemaphore(VulkanDevice, ImageRendered, nullptr);
-		vkDestroySemaphore(VulkanDevice, ImageAvailable, nullptr);
+		if(bAcquirePending)
+		{
+			VK_CHECK(vkWaitForFences(VulkanDevice, 1, &AcquireFence, VK_TRUE, UINT64_MAX));
+		}
+
+		SyncFences->Release(AcquireFence);
+		SyncSemaphores->Release(ImageRendered);
+		SyncSemaphores->Release(ImageAvailable);
 		vkDestroySwapchainKHR(VulkanDevice, VulkanSwapchain, nullptr);
 	}
 
@@ -48,9 +53,15 @@ namespace VulkanCore
 
 	std::shared_ptr<VulkanCore::Texture> Swapchain::AcquireImage()
 	{
-		VK_CHECK(vkWaitForFences(VulkanDevice, 1, &AcquireFence, VK_TRUE, UINT64_MAX));
-		VK_CHECK(vkResetFences(VulkanDevice, 1, &AcquireFence));
+		// Pooled fences start unsignaled, so there is nothing to wait on before the first acquire
+		if(bAcquirePending)
+		{
+			VK_CHECK(vkWaitForFences(VulkanDevice, 1, &AcquireFence, VK_TRUE, UINT64_MAX));
+			VK_CHECK(vkResetFences(VulkanDevice, 1, &AcquireFence));
+		}
+
 		VK_CHECK(vkAcquireNextImageKHR(VulkanDevice, VulkanSwapchain, UINT64_MAX, ImageAvailable, AcquireFence, &ImageIndex));
+		bAcquirePending = true;
 
 		return Images[ImageIndex];
 	}
@@ -121,8 +132,8 @@ namespace VulkanCore
 		VK_CHECK(vkCreateSwapchainKHR(VulkanDevice, &CreateInfo, nullptr, &VulkanSwapchain));
 
 		CreateSwapchainImages(DeviceContext, ImageFormat, Extent);
-		CreateSemaphores();
-		CreateFence();
+		CreateSemaphores(DeviceContext);
+		CreateFence(DeviceContext);
 
 		Framebuffers.resize(NumImages);
 	}
@@ -155,25 +166,19 @@ namespace VulkanCore
 		}
 	}
 
-	void Swapchain::CreateSemaphores()
+	void Swapchain::CreateSemaphores(const Context& DeviceContext)
 	{
-		VkSemaphoreCreateInfo CreateInfo;
-		CreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		CreateInfo.pNext = VK_NULL_HANDLE;
-		CreateInfo.flags = 0;
+		SyncSemaphores = DeviceContext.GetSemaphorePool();
 
-		VK_CHECK(vkCreateSemaphore(VulkanDevice, &CreateInfo, nullptr, &ImageAvailable));
-		VK_CHECK(vkCreateSemaphore(VulkanDevice, &CreateInfo, nullptr, &ImageRendered));
+		ImageAvailable = SyncSemaphores->Acquire();
+		ImageRendered = SyncSemaphores->Acquire();
 	}
 
-	void Swapchain::CreateFence()
+	void Swapchain::CreateFence(const Context& DeviceContext)
 	{
-		VkFenceCreateInfo CreateInfo;
-		CreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		CreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-		CreateInfo.pNext = VK_NULL_HANDLE;
+		SyncFences = DeviceContext.GetFencePool();
 
-		VK_CHECK(vkCreateFence(VulkanDevice, &CreateInfo, nullptr, &AcquireFence));
+		AcquireFence = SyncFences->Acquire();
+		bAcquirePending = false;
 	}
-}
-
+}
\ No newline at end of file
@@ -9,6 +9,8 @@ namespace VulkanCore
 	class PhysicalDevice;
 	class Texture;
 	class Framebuffer;
+	class FencePool;
+	class SemaphorePool;
 
 	class Swapchain final
 	{
@@ -38,7 +40,7 @@ namespace VulkanCore
 
 		VkSwapchainKHR GetVulkanSwapchain() const { return VulkanSwapchain; }
 
-		std::shared_ptr<Texture> GetTexture(uint32_t Index)
+		const std::shared_ptr<Texture>& GetTexture(uint32_t Index) const
 		{
 			ASSERT(Index < Images.size(), "Index is greater than the number of images in the swapchain");
 			return Images[Index];
@@ -60,8 +62,8 @@ namespace VulkanCore
 							 VkColorSpaceKHR ImageColorSpace, VkPresentModeKHR PresentMode, VkExtent2D Extent, VkSwapchainKHR OldSwapchain = VK_NULL_HANDLE);
 		void CreateSwapchainImages(const Context& DeviceContext, VkFormat Format, const VkExtent2D& Extent);
 
-		void CreateSemaphores();
-		void CreateFence();
+		void CreateSemaphores(const Context& DeviceContext);
+		void CreateFence(const Context& DeviceContext);
 		void CreateFramebuffers(const Context& DeviceContext, uint32_t NumImages);
 
 	private:
@@ -77,6 +79,11 @@ namespace VulkanCore
 
 		VkExtent2D SwapchainExtent;
 		VkFence AcquireFence = VK_NULL_HANDLE;
+		bool bAcquirePending = false;
+
+		// Sync objects are borrowed from the context's pools and handed back on destruction, recreating the swapchain creates none
+		FencePool* SyncFences = nullptr;
+		SemaphorePool* SyncSemaphores = nullptr;
 
 		VkSurfaceFormatKHR SwapchainSurfaceFormat;
 		VkPresentModeKHR CurrentPresentMode;
@@ -0,0 +1,153 @@
+#include "SyncObjectPool.h"
+#include "Context.h"
+#include "Logger.h"
+
+namespace VulkanCore
+{
+
+	FencePool::FencePool(const Context& DeviceContext, const std::string& Name)
+		: VulkanDevice{DeviceContext.GetDevice()}, DebugName{"Fence Pool: " + Name}
+	{
+	}
+
+	FencePool::~FencePool()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(FreeFences.size() != CreatedCount)
+		{
+			BE_WARN("{0}: {1} fences were never released", DebugName, CreatedCount - (uint32_t)FreeFences.size());
+		}
+
+		for(VkFence Fence : FreeFences)
+		{
+			vkDestroyFence(VulkanDevice, Fence, nullptr);
+		}
+	}
+
+	VkFence FencePool::Acquire()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(!FreeFences.empty())
+		{
+			VkFence Fence = FreeFences.back();
+			FreeFences.pop_back();
+			return Fence;
+		}
+
+		VkFenceCreateInfo FenceInfo{};
+		FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		FenceInfo.flags = 0;
+		FenceInfo.pNext = VK_NULL_HANDLE;
+
+		VkFence Fence = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateFence(VulkanDevice, &FenceInfo, nullptr, &Fence));
+		CreatedCount++;
+
+#if _DEBUG
+		BE_INFO("{0}: created fence {1}", DebugName, CreatedCount);
+#endif
+
+		return Fence;
+	}
+
+	void FencePool::Release(VkFence Fence)
+	{
+		if(Fence == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		if(vkGetFenceStatus(VulkanDevice, Fence) == VK_SUCCESS)
+		{
+			VK_CHECK(vkResetFences(VulkanDevice, 1, &Fence));
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		FreeFences.push_back(Fence);
+	}
+
+	uint32_t FencePool::GetCreatedCount() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		return CreatedCount;
+	}
+
+	uint32_t FencePool::GetFreeCount() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		return static_cast<uint32_t>(FreeFences.size());
+	}
+
+	SemaphorePool::SemaphorePool(const Context& DeviceContext, const std::string& Name)
+		: VulkanDevice{DeviceContext.GetDevice()}, DebugName{"Semaphore Pool: " + Name}
+	{
+	}
+
+	SemaphorePool::~SemaphorePool()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(FreeSemaphores.size() != CreatedCount)
+		{
+			BE_WARN("{0}: {1} semaphores were never released", DebugName, CreatedCount - (uint32_t)FreeSemaphores.size());
+		}
+
+		for(VkSemaphore Semaphore : FreeSemaphores)
+		{
+			vkDestroySemaphore(VulkanDevice, Semaphore, nullptr);
+		}
+	}
+
+	VkSemaphore SemaphorePool::Acquire()
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		if(!FreeSemaphores.empty())
+		{
+			VkSemaphore Semaphore = FreeSemaphores.back();
+			FreeSemaphores.pop_back();
+			return Semaphore;
+		}
+
+		VkSemaphoreCreateInfo SemaphoreInfo{};
+		SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		SemaphoreInfo.flags = 0;
+		SemaphoreInfo.pNext = VK_NULL_HANDLE;
+
+		VkSemaphore Semaphore = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateSemaphore(VulkanDevice, &SemaphoreInfo, nullptr, &Semaphore));
+		CreatedCount++;
+
+#if _DEBUG
+		BE_INFO("{0}: created semaphore {1}", DebugName, CreatedCount);
+#endif
+
+		return Semaphore;
+	}
+
+	void SemaphorePool::Release(VkSemaphore Semaphore)
+	{
+		if(Semaphore == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		FreeSemaphores.push_back(Semaphore);
+	}
+
+	uint32_t SemaphorePool::GetCreatedCount() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		return CreatedCount;
+	}
+
+	uint32_t SemaphorePool::GetFreeCount() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+		return static_cast<uint32_t>(FreeSemaphores.size());
+	}
+
+}
\ No newline at end of file
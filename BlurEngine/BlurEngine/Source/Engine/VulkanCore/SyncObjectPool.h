@@ -0,0 +1,68 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <mutex>
+
+namespace VulkanCore
+{
+
+class Context;
+
+// Recycles fences instead of creating and destroying them, once the pool has grown to the number of fences in flight
+// acquiring one is a pop from the free list. Fences are always handed out and taken back unsignaled.
+class FencePool final
+{
+public:
+	MOVABLE_ONLY(FencePool);
+
+	explicit FencePool(const Context& DeviceContext, const std::string& Name = "");
+	~FencePool();
+
+	VkFence Acquire();
+	// The fence must not be part of a pending submit, it's reset if it was signaled
+	void Release(VkFence Fence);
+
+	// Fences created over the pool's lifetime, stays flat once the steady state is reached
+	uint32_t GetCreatedCount() const;
+	uint32_t GetFreeCount() const;
+
+private:
+	VkDevice VulkanDevice = VK_NULL_HANDLE;
+
+	std::vector<VkFence> FreeFences;
+	uint32_t CreatedCount = 0;
+
+	mutable std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+// Same as FencePool for binary semaphores. A released semaphore must not have a signal or wait operation still pending.
+class SemaphorePool final
+{
+public:
+	MOVABLE_ONLY(SemaphorePool);
+
+	explicit SemaphorePool(const Context& DeviceContext, const std::string& Name = "");
+	~SemaphorePool();
+
+	VkSemaphore Acquire();
+	void Release(VkSemaphore Semaphore);
+
+	uint32_t GetCreatedCount() const;
+	uint32_t GetFreeCount() const;
+
+private:
+	VkDevice VulkanDevice = VK_NULL_HANDLE;
+
+	std::vector<VkSemaphore> FreeSemaphores;
+	uint32_t CreatedCount = 0;
+
+	mutable std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "Texture.h"
 #include "Context.h"
+#include "BarrierBuilder.h"
+
+#include <algorithm>
 
 namespace VulkanCore
 {
@@ -15,31 +18,13 @@ namespace VulkanCore
 		ASSERT(TextureExtents.width > 0 && TextureExtents.height > 0, "Texture cannot have dimensions equal to 0");
 		ASSERT(MipLevels > 0, "Texture must have at least one mip level");
 
-		if(bGenerateMips)
-		{
-			MipLevels = GetMipLevelCount(TextureExtents.width, TextureExtents.height);
-		}
+		const VkImageCreateInfo ImageInfo = MakeImageCreateInfo(CreateInfo);
+		MipLevels = ImageInfo.mipLevels;
 
 		ASSERT(!(MipLevels > 1 && MsaaSamples != VK_SAMPLE_COUNT_1_BIT), "Multisampled images cannot have more than 1 mip level");
 
-		VkImageCreateInfo ImageInfo{};
-		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-		ImageInfo.flags = Flags;
-		ImageInfo.imageType = ImageType;
-		ImageInfo.format = TextureFormat;
-		ImageInfo.extent = TextureExtents;
-		ImageInfo.mipLevels = MipLevels;
-		ImageInfo.arrayLayers = LayerCount;
-		ImageInfo.samples = MsaaSamples;
-		ImageInfo.tiling = ImageTiling;
-		ImageInfo.usage = UsageFlags;
-		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		ImageInfo.pNext = VK_NULL_HANDLE;
-		ImageInfo.pQueueFamilyIndices = VK_NULL_HANDLE;
-
 		VmaAllocationCreateInfo AllocInfo{};
-		AllocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		AllocInfo.flags = CreateInfo.bDedicatedMemory ? VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT : 0;
 		AllocInfo.usage = CreateInfo.MemoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ? VMA_MEMORY_USAGE_AUTO_PREFER_HOST : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 		AllocInfo.priority = 1.0f;
 
@@ -50,11 +35,40 @@ namespace VulkanCore
 			VmaAllocationInfo AllocationInfo;
 			vmaGetAllocationInfo(Allocator, Allocation, &AllocationInfo);
 			DeviceSize = AllocationInfo.size;
+
+			const VkImageUsageFlags AttachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			Category = (UsageFlags & AttachmentUsage) ? MemoryCategory::RenderTargets : MemoryCategory::Textures;
+
+			if(MemoryBudgetTracker* MemoryTracker = DeviceContext.GetMemoryTracker())
+			{
+				MemoryTracker->TrackAllocation(Category, DeviceSize);
+			}
 		}
 
-		ViewType = VulkanUtils::ImageTypeToImageViewType(ImageType, Flags, bMultiview);
+		InitImageView(CreateInfo.Name);
+	}
 
-		ImageView = CreateImageView(ViewType, TextureFormat, MipLevels, LayerCount, CreateInfo.Name);
+	Texture::Texture(const Context& InContext, const TextureCreateInfo& CreateInfo, VmaAllocation AliasedMemory, VkDeviceSize MemoryOffset)
+		: DeviceContext{InContext}, Allocator{InContext.GetAllocator()}, UsageFlags{CreateInfo.UsageFlags}, Flags{CreateInfo.Flags},
+		  ImageType{CreateInfo.Type}, TextureFormat{CreateInfo.Format}, TextureExtents{CreateInfo.Extents}, bOwnsVkImage{true},
+		  MipLevels{CreateInfo.NumMipLevels}, LayerCount{CreateInfo.LayerCount}, bMultiview{CreateInfo.bMultiview}, bGenerateMips{CreateInfo.bGenerateMips},
+		  MsaaSamples{CreateInfo.MsaaSamples}, ImageTiling{CreateInfo.Tiling}, DebugName{CreateInfo.Name}
+	{
+		DebugName = "Texture: " + CreateInfo.Name;
+
+		ASSERT(AliasedMemory != nullptr, "Aliased texture needs memory to be placed in!");
+
+		const VkImageCreateInfo ImageInfo = MakeImageCreateInfo(CreateInfo);
+		MipLevels = ImageInfo.mipLevels;
+
+		// Allocation stays null so only the image is destroyed with the texture
+		VK_CHECK(vmaCreateAliasingImage2(Allocator, AliasedMemory, MemoryOffset, &ImageInfo, &TextureImage));
+
+		VkMemoryRequirements MemoryRequirements;
+		vkGetImageMemoryRequirements(DeviceContext.GetDevice(), TextureImage, &MemoryRequirements);
+		DeviceSize = MemoryRequirements.size;
+
+		InitImageView(CreateInfo.Name);
 	}
 
 	Texture::Texture(const Context& InContext, VkDevice Device, VkImage Image, VkFormat Format, 
@@ -62,6 +76,8 @@ namespace VulkanCore
 		: DeviceContext{InContext}, TextureImage{Image}, TextureFormat{Format}, TextureExtents{Extents}, LayerCount{NumLayers},
 		  bMultiview{IsMultiview}, DebugName{Name}
 	{
+		InitSubresourceStates();
+
 		ImageView = CreateImageView(bMultiview ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D, TextureFormat, 1, LayerCount, DebugName);
 	}
 
@@ -74,12 +90,117 @@ namespace VulkanCore
 
 		vkDestroyImageView(DeviceContext.GetDevice(), ImageView, nullptr);
 
+		if(Allocation != nullptr && DeviceContext.GetMemoryTracker())
+		{
+			DeviceContext.GetMemoryTracker()->UntrackAllocation(Category, DeviceSize);
+		}
+
 		if(bOwnsVkImage)
 		{
 			vmaDestroyImage(Allocator, TextureImage, Allocation);
 		}
 	}
 
+	VkImageCreateInfo Texture::MakeImageCreateInfo(const TextureCreateInfo& CreateInfo)
+	{
+		VkImageCreateInfo ImageInfo{};
+		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		ImageInfo.flags = CreateInfo.Flags;
+		ImageInfo.imageType = CreateInfo.Type;
+		ImageInfo.format = CreateInfo.Format;
+		ImageInfo.extent = CreateInfo.Extents;
+		ImageInfo.mipLevels = CreateInfo.bGenerateMips ? GetMipLevelCount(CreateInfo.Extents.width, CreateInfo.Extents.height) : CreateInfo.NumMipLevels;
+		ImageInfo.arrayLayers = CreateInfo.LayerCount;
+		ImageInfo.samples = CreateInfo.MsaaSamples;
+		ImageInfo.tiling = CreateInfo.Tiling;
+		ImageInfo.usage = CreateInfo.UsageFlags;
+		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		ImageInfo.pNext = VK_NULL_HANDLE;
+		ImageInfo.pQueueFamilyIndices = VK_NULL_HANDLE;
+
+		return ImageInfo;
+	}
+
+	bool Texture::CanRelocate() const
+	{
+		constexpr VkImageUsageFlags CopyUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if(Allocation == nullptr || !bOwnsVkImage || !ImageViewFramebuffers.empty() || (UsageFlags & CopyUsage) != CopyUsage)
+		{
+			return false;
+		}
+
+		return std::all_of(SubresourceStates.begin(), SubresourceStates.end(), [this](const SubresourceState& State)
+		{
+			return State.Layout == SubresourceStates[0].Layout;
+		});
+	}
+
+	std::pair<VkImage, VkImageView> Texture::Relocate(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers, VmaAllocation DstAllocation)
+	{
+		ASSERT(CanRelocate(), "Trying to relocate a texture that can't be moved!");
+
+		const VkImageLayout Layout = GetLayout();
+
+		VkImageCreateInfo ImageInfo{};
+		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		ImageInfo.flags = Flags;
+		ImageInfo.imageType = ImageType;
+		ImageInfo.format = TextureFormat;
+		ImageInfo.extent = TextureExtents;
+		ImageInfo.mipLevels = MipLevels;
+		ImageInfo.arrayLayers = LayerCount;
+		ImageInfo.samples = MsaaSamples;
+		ImageInfo.tiling = ImageTiling;
+		ImageInfo.usage = UsageFlags;
+		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		ImageInfo.pNext = VK_NULL_HANDLE;
+
+		VkImage NewImage = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateImage(DeviceContext.GetDevice(), &ImageInfo, nullptr, &NewImage));
+		VK_CHECK(vmaBindImageMemory(Allocator, DstAllocation, NewImage));
+
+		// Contents that were never written don't need to be copied
+		const bool bCopyContents = Layout != VK_IMAGE_LAYOUT_UNDEFINED;
+		if(bCopyContents)
+		{
+			Barriers.TransitionImage(*this, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		}
+
+		// From here on the texture refers to the new image, which starts out undefined
+		const VkImage OldImage = std::exchange(TextureImage, NewImage);
+		// The tracked states belong to the old image, the copy below has to transition the new one out of undefined
+		SetSubresourceState({VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE});
+		const VkImageView OldView = ImageView;
+		InitImageView(DebugName);
+
+		if(!bCopyContents)
+		{
+			return {OldImage, OldView};
+		}
+
+		Barriers.TransitionImage(*this, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		Barriers.Flush(CmdBuffer);
+
+		std::vector<VkImageCopy> Regions(MipLevels);
+		for(uint32_t Mip = 0; Mip < MipLevels; Mip++)
+		{
+			VkImageCopy& Region = Regions[Mip];
+			Region.srcSubresource = {GetFullAspectMask(), Mip, 0, LayerCount};
+			Region.dstSubresource = {GetFullAspectMask(), Mip, 0, LayerCount};
+			Region.srcOffset = {0, 0, 0};
+			Region.dstOffset = {0, 0, 0};
+			Region.extent = {std::max(TextureExtents.width >> Mip, 1u), std::max(TextureExtents.height >> Mip, 1u), std::max(TextureExtents.depth >> Mip, 1u)};
+		}
+
+		vkCmdCopyImage(CmdBuffer, OldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, TextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)Regions.size(), Regions.data());
+
+		Barriers.TransitionImage(*this, Layout);
+
+		return {OldImage, OldView};
+	}
+
 	bool Texture::IsDepth() const
 	{
 		return (TextureFormat == VK_FORMAT_D16_UNORM || TextureFormat == VK_FORMAT_D16_UNORM_S8_UINT || TextureFormat == VK_FORMAT_D24_UNORM_S8_UINT ||
@@ -92,6 +213,36 @@ namespace VulkanCore
 				TextureFormat == VK_FORMAT_D24_UNORM_S8_UINT || TextureFormat == VK_FORMAT_D32_SFLOAT_S8_UINT);
 	}
 
+	VkImageAspectFlags Texture::GetFullAspectMask() const
+	{
+		if(IsDepth() || IsStencil())
+		{
+			return (IsDepth() ? VK_IMAGE_ASPECT_DEPTH_BIT : 0) | (IsStencil() ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+		}
+
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+
+	const SubresourceState& Texture::GetSubresourceState(uint32_t MipLevel, uint32_t Layer) const
+	{
+		ASSERT(MipLevel < MipLevels && Layer < LayerCount, "Subresource is outside of the texture!");
+		return SubresourceStates[Layer * MipLevels + MipLevel];
+	}
+
+	void Texture::SetSubresourceState(const SubresourceState& NewState, uint32_t BaseMip, uint32_t MipCount, uint32_t BaseLayer, uint32_t NumLayers)
+	{
+		const uint32_t LastMip = MipCount == VK_REMAINING_MIP_LEVELS ? MipLevels : std::min(BaseMip + MipCount, MipLevels);
+		const uint32_t LastLayer = NumLayers == VK_REMAINING_ARRAY_LAYERS ? LayerCount : std::min(BaseLayer + NumLayers, LayerCount);
+
+		for(uint32_t Layer = BaseLayer; Layer < LastLayer; Layer++)
+		{
+			for(uint32_t Mip = BaseMip; Mip < LastMip; Mip++)
+			{
+				SubresourceStates[Layer * MipLevels + Mip] = NewState;
+			}
+		}
+	}
+
 	VkImageView Texture::GetImageView(uint32_t MipLevel)
 	{
 		ASSERT(MipLevel == UINT32_MAX || MipLevel < MipLevels, "GetImageView was provided an invalid mip level!");
@@ -142,9 +293,23 @@ namespace VulkanCore
 		return Result;
 	}
 
-	uint32_t Texture::GetMipLevelCount(uint32_t TextureWidth, uint32_t TextureHeight) const
+	void Texture::InitSubresourceStates()
+	{
+		SubresourceStates.assign(static_cast<size_t>(MipLevels) * LayerCount, SubresourceState{});
+	}
+
+	void Texture::InitImageView(const std::string& Name)
+	{
+		InitSubresourceStates();
+
+		ViewType = VulkanUtils::ImageTypeToImageViewType(ImageType, Flags, bMultiview);
+
+		ImageView = CreateImageView(ViewType, TextureFormat, MipLevels, LayerCount, Name);
+	}
+
+	uint32_t Texture::GetMipLevelCount(uint32_t TextureWidth, uint32_t TextureHeight)
 	{
 		return static_cast<uint32_t>(std::floor(std::log2(std::max(TextureWidth, TextureHeight))));
 	}
 
-}
+}
\ No newline at end of file
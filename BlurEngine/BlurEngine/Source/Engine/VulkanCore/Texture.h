@@ -2,6 +2,7 @@
 
 #include "VulkanCommon.h"
 #include "Utility.h"
+#include "MemoryBudgetTracker.h"
 
 #include <vma/vk_mem_alloc.h>
 
@@ -9,6 +10,7 @@ namespace VulkanCore
 {
 
 class Context;
+class BarrierBuilder;
 
 struct TextureCreateInfo
 {
@@ -24,9 +26,25 @@ struct TextureCreateInfo
 	bool bGenerateMips = false;
 	bool bMultiview = false;
 	VkImageTiling Tiling = VK_IMAGE_TILING_OPTIMAL;
+	// Large, long lived images benefit from their own allocation, everything else should be suballocated
+	bool bDedicatedMemory = true;
 	std::string Name = "";
 };
 
+// Layout and last access of a single mip level of a single array layer
+struct SubresourceState
+{
+	VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags2 Stages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 Access = VK_ACCESS_2_NONE;
+
+	// Stages and accesses of the last write, and what a barrier has made that write visible to so far
+	VkPipelineStageFlags2 WriteStages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 WriteAccess = VK_ACCESS_2_NONE;
+	VkPipelineStageFlags2 VisibleStages = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 VisibleAccess = VK_ACCESS_2_NONE;
+};
+
 class Texture final
 {
 public:
@@ -34,25 +52,52 @@ public:
 
 	explicit Texture(const Context& InContext, const TextureCreateInfo& CreateInfo);
 
+	// Creates the image in memory owned by someone else, the memory is not freed with the texture
+	explicit Texture(const Context& InContext, const TextureCreateInfo& CreateInfo, VmaAllocation AliasedMemory, VkDeviceSize MemoryOffset = 0);
+
 	explicit Texture(const Context& InContext, VkDevice Device, VkImage Image, VkFormat Format, VkExtent3D Extents, 
 					 uint32_t NumLayers = 1, bool IsMultiview = false, const std::string& Name = "");
 
 	~Texture();
 
+	static VkImageCreateInfo MakeImageCreateInfo(const TextureCreateInfo& CreateInfo);
+
 	bool IsDepth() const;
 	bool IsStencil() const;
 
 	VkFormat GetFormat() const { return TextureFormat; }
 	VkSampleCountFlagBits GetSampleCount() const { return MsaaSamples; }
-	VkImageLayout GetLayout() const { return ImageLayout; }
+	VkImageLayout GetLayout() const { return GetSubresourceState(0, 0).Layout; }
 	VkImageView GetImageView(uint32_t MipLevel);
 	VkExtent3D GetExtents() const { return TextureExtents; }
 	VkImage GetVkImage() const { return TextureImage; }
+	uint32_t GetMipLevels() const { return MipLevels; }
+	uint32_t GetLayerCount() const { return LayerCount; }
+
+	// Aspects that need to be included when transitioning the whole image
+	VkImageAspectFlags GetFullAspectMask() const;
+
+	const SubresourceState& GetSubresourceState(uint32_t MipLevel, uint32_t Layer) const;
+	void SetSubresourceState(const SubresourceState& NewState, uint32_t BaseMip = 0, uint32_t MipCount = VK_REMAINING_MIP_LEVELS, 
+							 uint32_t BaseLayer = 0, uint32_t NumLayers = VK_REMAINING_ARRAY_LAYERS);
+
+	VmaAllocation GetAllocation() const { return Allocation; }
+	VkDeviceSize GetDeviceSize() const { return DeviceSize; }
+
+	// Only textures that own their memory, can be copied and have every subresource in the same layout can be moved by the defragmenter
+	bool CanRelocate() const;
+
+	// Creates a new image in DstAllocation and records a copy of every subresource into it. The texture uses the new image and view right away,
+	// the old ones are returned and have to be destroyed once the GPU is done with them.
+	std::pair<VkImage, VkImageView> Relocate(VkCommandBuffer CmdBuffer, BarrierBuilder& Barriers, VmaAllocation DstAllocation);
 
 private:
 	VkImageView CreateImageView(VkImageViewType ImageViewType, VkFormat ImageFormat, uint32_t NumMips, uint32_t Layers, const std::string& Name);
 
-	uint32_t GetMipLevelCount(uint32_t TextureWidth, uint32_t TextureHeight) const;
+	static uint32_t GetMipLevelCount(uint32_t TextureWidth, uint32_t TextureHeight);
+
+	void InitSubresourceStates();
+	void InitImageView(const std::string& Name);
 
 private:
 	const Context& DeviceContext;
@@ -61,6 +106,8 @@ private:
 	VmaAllocation Allocation = nullptr;
 
 	VkDeviceSize DeviceSize = 0;
+	// Only textures that own their memory are tracked, aliased memory is tracked by whoever allocated it
+	MemoryCategory Category = MemoryCategory::Textures;
 
 	VkImageUsageFlags UsageFlags = 0;
 	VkImageCreateFlags Flags = 0;
@@ -72,7 +119,8 @@ private:
 
 	VkFormat TextureFormat = VK_FORMAT_UNDEFINED;
 	VkExtent3D TextureExtents;
-	VkImageLayout ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// Indexed by Layer * MipLevels + MipLevel
+	std::vector<SubresourceState> SubresourceStates;
 	bool bOwnsVkImage = false;
 
 	uint32_t MipLevels = 1;
@@ -0,0 +1,234 @@
+#include "UploadScheduler.h"
+#include "StagingRing.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+namespace VulkanCore
+{
+
+	UploadScheduler::UploadScheduler(const UploadBudgetSettings& InSettings, const std::string& Name)
+		: Settings{InSettings}, BudgetBytes{InSettings.InitialBytesPerFrame}, DebugName{"Upload Scheduler: " + Name}
+	{
+		ASSERT(Settings.MinBytesPerFrame > 0 && Settings.MinBytesPerFrame <= Settings.MaxBytesPerFrame, "Upload budget range is invalid!");
+		BudgetBytes = std::clamp(BudgetBytes, Settings.MinBytesPerFrame, Settings.MaxBytesPerFrame);
+	}
+
+	UploadID UploadScheduler::Submit(UploadRequest&& Request)
+	{
+		ASSERT(Request.Data != nullptr && Request.Size > 0, "Trying to schedule an empty upload!");
+		ASSERT(Request.DstBuffer != nullptr, "Trying to schedule an upload without a destination!");
+		ASSERT(Request.Priority < UploadPriority::Count, "Invalid upload priority!");
+
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		PendingUpload NewUpload;
+		NewUpload.ID = NextID++;
+		NewUpload.Request = std::move(Request);
+
+		const UploadID ID = NewUpload.ID;
+		Queues[(size_t)NewUpload.Request.Priority].push_back(std::move(NewUpload));
+
+		return ID;
+	}
+
+	bool UploadScheduler::Cancel(UploadID ID)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		for(std::deque<PendingUpload>& Queue : Queues)
+		{
+			auto Itr = std::find_if(Queue.begin(), Queue.end(), [ID](const PendingUpload& Upload) { return Upload.ID == ID; });
+			if(Itr != Queue.end())
+			{
+				Queue.erase(Itr);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void UploadScheduler::BeginFrame(double FrameSeconds)
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		const bool bMissedTarget = FrameSeconds > Settings.TargetFrameSeconds * (1.0 + FRAME_TIME_TOLERANCE);
+
+		// Backs off quickly when uploading coincides with a slow frame, and probes upwards slowly while the budget is what holds uploads back
+		if(bMissedTarget && BytesLastFrame > 0)
+		{
+			const VkDeviceSize ReducedBudget = (VkDeviceSize)((double)BudgetBytes * Settings.BudgetDecrease);
+			BudgetBytes = std::max(ReducedBudget, Settings.MinBytesPerFrame);
+
+#if _DEBUG
+			BE_INFO("{0}: frame took {1:.2f} ms while uploading {2} KB, budget lowered to {3} KB", DebugName, FrameSeconds * 1000.0,
+					BytesLastFrame >> 10, BudgetBytes >> 10);
+#endif
+		}
+		else if(!bMissedTarget && bBudgetLimitedLastFrame)
+		{
+			BudgetBytes = std::min(BudgetBytes + Settings.BudgetIncrease, Settings.MaxBytesPerFrame);
+		}
+	}
+
+	void UploadScheduler::Update(StagingRing& Uploads)
+	{
+		std::vector<std::pair<UploadID, UploadCompleteCallback>> Completed;
+
+		{
+			std::unique_lock<std::mutex> MutexLock(Mutex);
+
+			// Critical uploads can go over the budget, they still count as uploading for the next frame's adjustment
+			BytesLastFrame = 0;
+
+			VkDeviceSize Budget = BudgetBytes;
+			bool bRingFull = !ServeClass(UploadPriority::Critical, Budget, Uploads, true);
+
+			std::deque<PendingUpload>& VisibleQueue = Queues[(size_t)UploadPriority::Visible];
+			std::deque<PendingUpload>& PrefetchQueue = Queues[(size_t)UploadPriority::Prefetch];
+
+			// One round per class at a time, prefetching gets its weighted share of every round that fits into the budget
+			while(!bRingFull && Budget > 0 && (!VisibleQueue.empty() || !PrefetchQueue.empty()))
+			{
+				bRingFull = !ServeClass(UploadPriority::Visible, Budget, Uploads, false) || !ServeClass(UploadPriority::Prefetch, Budget, Uploads, false);
+			}
+
+			bBudgetLimitedLastFrame = Budget == 0 && (!VisibleQueue.empty() || !PrefetchQueue.empty());
+
+			Completed.swap(CompletedUploads);
+		}
+
+		for(auto& [ID, OnComplete] : Completed)
+		{
+			if(OnComplete)
+			{
+				OnComplete(ID);
+			}
+		}
+	}
+
+	bool UploadScheduler::HasPendingUploads() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		return std::any_of(Queues.begin(), Queues.end(), [](const std::deque<PendingUpload>& Queue) { return !Queue.empty(); });
+	}
+
+	UploadSchedulerStats UploadScheduler::GetStats() const
+	{
+		std::unique_lock<std::mutex> MutexLock(Mutex);
+
+		UploadSchedulerStats Stats;
+		Stats.BudgetBytes = BudgetBytes;
+		Stats.BytesLastFrame = BytesLastFrame;
+
+		for(size_t Class = 0; Class < Queues.size(); Class++)
+		{
+			for(const PendingUpload& Upload : Queues[Class])
+			{
+				Stats.PendingBytes[Class] += Upload.Request.Size - Upload.UploadedBytes;
+			}
+
+			Stats.PendingUploads[Class] = (uint32_t)Queues[Class].size();
+		}
+
+		return Stats;
+	}
+
+	UploadScheduler::CopyResult UploadScheduler::CopyUpload(PendingUpload& Upload, VkDeviceSize Bytes, StagingRing& Uploads, VkDeviceSize& OutCopied)
+	{
+		const uint8_t* Data = static_cast<const uint8_t*>(Upload.Request.Data);
+
+		OutCopied = 0;
+		while(OutCopied < Bytes)
+		{
+			const VkDeviceSize PieceSize = std::min(Bytes - OutCopied, UPLOAD_PIECE_SIZE);
+			if(!Uploads.Upload(Data + Upload.UploadedBytes, PieceSize, *Upload.Request.DstBuffer, Upload.Request.DstOffset + Upload.UploadedBytes))
+			{
+				return CopyResult::RingFull;
+			}
+
+			Upload.UploadedBytes += PieceSize;
+			OutCopied += PieceSize;
+		}
+
+		return CopyResult::Copied;
+	}
+
+	bool UploadScheduler::ServeClass(UploadPriority Priority, VkDeviceSize& InOutBudget, StagingRing& Uploads, bool bUnlimited)
+	{
+		std::deque<PendingUpload>& Queue = Queues[(size_t)Priority];
+		const VkDeviceSize Quantum = UPLOAD_QUANTUM * GetClassWeight(Priority);
+
+		// Each upload gets one turn, unlimited classes are drained completely
+		size_t NumTurns = Queue.size();
+		while(NumTurns > 0 && !Queue.empty())
+		{
+			if(!bUnlimited && InOutBudget == 0)
+			{
+				return true;
+			}
+
+			PendingUpload& Upload = Queue.front();
+			const VkDeviceSize Remaining = Upload.Request.Size - Upload.UploadedBytes;
+
+			// A turn cut short by the budget or a full ring keeps its deficit and carries on where it stopped
+			if(Upload.Deficit == 0)
+			{
+				Upload.Deficit = Quantum;
+			}
+
+			const VkDeviceSize Bytes = bUnlimited ? Remaining : std::min({Upload.Deficit, Remaining, InOutBudget});
+
+			VkDeviceSize Copied = 0;
+			const CopyResult Result = CopyUpload(Upload, Bytes, Uploads, Copied);
+
+			Upload.Deficit -= std::min(Upload.Deficit, Copied);
+			InOutBudget -= std::min(InOutBudget, Copied);
+			BytesLastFrame += Copied;
+
+			if(Upload.UploadedBytes == Upload.Request.Size)
+			{
+				CompletedUploads.emplace_back(Upload.ID, std::move(Upload.Request.OnComplete));
+				Queue.pop_front();
+
+				if(!bUnlimited)
+				{
+					NumTurns--;
+				}
+				continue;
+			}
+
+			if(Result == CopyResult::RingFull)
+			{
+				return false;
+			}
+
+			// Out of budget in the middle of the turn, the upload stays first in line for the next frame
+			if(Upload.Deficit > 0)
+			{
+				return true;
+			}
+
+			Queue.push_back(std::move(Upload));
+			Queue.pop_front();
+			NumTurns--;
+		}
+
+		return true;
+	}
+
+	VkDeviceSize UploadScheduler::GetClassWeight(UploadPriority Priority)
+	{
+		switch(Priority)
+		{
+		case UploadPriority::Critical:	return 16;
+		case UploadPriority::Visible:	return 4;
+		case UploadPriority::Prefetch:	return 1;
+		default:						return 1;
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "VulkanCommon.h"
+#include "Utility.h"
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace VulkanCore
+{
+
+class Buffer;
+class StagingRing;
+
+enum class UploadPriority : uint8_t
+{
+	// Needed by this frame, ignores the budget
+	Critical,
+	// Used by something on screen, gets most of the budget
+	Visible,
+	// Speculative loads, only gets a small share of the budget while there is visible work
+	Prefetch,
+	Count
+};
+
+using UploadID = uint64_t;
+
+// Called once every byte of the upload has been copied into the staging ring, the copy lands with the ring's next RecordCopies
+using UploadCompleteCallback = std::function<void(UploadID)>;
+
+struct UploadRequest
+{
+	// Has to stay valid until the upload completes or is cancelled, Owner can keep it alive
+	const void* Data = nullptr;
+	VkDeviceSize Size = 0;
+	std::shared_ptr<const void> Owner;
+
+	// Has to outlive the upload
+	const Buffer* DstBuffer = nullptr;
+	VkDeviceSize DstOffset = 0;
+
+	UploadPriority Priority = UploadPriority::Visible;
+	UploadCompleteCallback OnComplete;
+};
+
+struct UploadBudgetSettings
+{
+	double TargetFrameSeconds = 1.0 / 60.0;
+
+	VkDeviceSize MinBytesPerFrame = 1 * 1024 * 1024;
+	VkDeviceSize MaxBytesPerFrame = 64 * 1024 * 1024;
+	VkDeviceSize InitialBytesPerFrame = 16 * 1024 * 1024;
+
+	// Budget grows by this much per frame that was limited by it and still hit the target
+	VkDeviceSize BudgetIncrease = 1 * 1024 * 1024;
+	// And is scaled by this after a frame that missed the target while uploading
+	double BudgetDecrease = 0.5;
+};
+
+struct UploadSchedulerStats
+{
+	VkDeviceSize BudgetBytes = 0;
+	VkDeviceSize BytesLastFrame = 0;
+	std::array<VkDeviceSize, (size_t)UploadPriority::Count> PendingBytes{};
+	std::array<uint32_t, (size_t)UploadPriority::Count> PendingUploads{};
+};
+
+// Streams uploads into the staging ring a bounded number of bytes per frame instead of all at once, so loading a large asset is
+// spread over several frames rather than showing up as a spike. The budget adapts to the measured frame time (additive increase,
+// multiplicative decrease). Within a priority class uploads share the budget by deficit round robin, every upload gets a quantum
+// per round, so a small buffer queued behind a large texture still finishes in its first round.
+class UploadScheduler final
+{
+public:
+	MOVABLE_ONLY(UploadScheduler);
+
+	explicit UploadScheduler(const UploadBudgetSettings& InSettings = UploadBudgetSettings{}, const std::string& Name = "");
+
+	UploadID Submit(UploadRequest&& Request);
+
+	// Drops whatever hasn't been copied into the staging ring yet and the callback with it.
+	// Returns false if the upload already completed, callbacks should check the upload is still wanted.
+	bool Cancel(UploadID ID);
+
+	// Adapts the budget to how long the last frame took, called once per frame before Update
+	void BeginFrame(double FrameSeconds);
+
+	// Copies up to this frame's budget into the ring, critical uploads first. Stops early if the ring is full.
+	void Update(StagingRing& Uploads);
+
+	void SetTargetFrameTime(double Seconds) { Settings.TargetFrameSeconds = Seconds; }
+
+	bool HasPendingUploads() const;
+	UploadSchedulerStats GetStats() const;
+
+public:
+	static constexpr UploadID INVALID_UPLOAD = 0;
+
+	// Largest single copy into the ring, a large upload never needs the whole ring at once
+	static constexpr VkDeviceSize UPLOAD_PIECE_SIZE = 4 * 1024 * 1024;
+	// Bytes an upload gets per round robin turn, multiplied by its class weight
+	static constexpr VkDeviceSize UPLOAD_QUANTUM = 256 * 1024;
+	// Frames this much over the target count as missed
+	static constexpr double FRAME_TIME_TOLERANCE = 0.1;
+
+private:
+	struct PendingUpload
+	{
+		UploadID ID = INVALID_UPLOAD;
+		UploadRequest Request;
+		VkDeviceSize UploadedBytes = 0;
+		VkDeviceSize Deficit = 0;
+	};
+
+	enum class CopyResult : uint8_t
+	{
+		Copied,
+		RingFull
+	};
+
+	// Copies up to Bytes of the upload into the ring, in pieces of at most UPLOAD_PIECE_SIZE
+	CopyResult CopyUpload(PendingUpload& Upload, VkDeviceSize Bytes, StagingRing& Uploads, VkDeviceSize& OutCopied);
+
+	// Round robin over one class. Returns false once the ring is full.
+	bool ServeClass(UploadPriority Priority, VkDeviceSize& InOutBudget, StagingRing& Uploads, bool bUnlimited);
+
+	static VkDeviceSize GetClassWeight(UploadPriority Priority);
+
+private:
+	UploadBudgetSettings Settings;
+
+	VkDeviceSize BudgetBytes = 0;
+	VkDeviceSize BytesLastFrame = 0;
+	bool bBudgetLimitedLastFrame = false;
+
+	std::array<std::deque<PendingUpload>, (size_t)UploadPriority::Count> Queues;
+	UploadID NextID = 1;
+
+	// Filled while the mutex is held, called after it is released so callbacks can submit or cancel uploads
+	std::vector<std::pair<UploadID, UploadCompleteCallback>> CompletedUploads;
+
+	mutable std::mutex Mutex;
+
+	std::string DebugName;
+};
+
+}
\ No newline at end of file
@@ -1,14 +1,15 @@
 #ifndef COMMON_SHADER_STRUCTS
 #define COMMON_SHADER_STRUCTS
 
+// Scalars only so the std430 layout matches the tightly packed EngineCore::Vertex
 struct Vertex
 {
-	vec4 position;
-	vec4 color;
-	vec4 normal;
-	vec4 tangent;
-	vec4 biTangent;
-	vec2 texCoord;
+	float positionX, positionY, positionZ;
+	float colorX, colorY, colorZ;
+	float normalX, normalY, normalZ;
+	float tangentX, tangentY, tangentZ;
+	float biTangentX, biTangentY, biTangentZ;
+	float texCoordU, texCoordV;
 };
 
 struct IndirectDrawAndMeshData
@@ -16,10 +17,27 @@ struct IndirectDrawAndMeshData
 	uint indexCount;
 	uint instanceCount;
 	uint firstIndex;
-	uint vertexOffset;
+	int vertexOffset;
 	uint firstInstance;
 
 	uint meshId;
+	int materialIndex;
+};
+
+// Matches EngineCore::Material, texture and sampler IDs are stored as floats and are negative when unused
+struct Material
+{
+	vec4 baseColorIDs;
+	vec4 metallicData;
+	vec2 normalIDs;
+	vec2 emissiveIDs;
+	vec4 baseColor;
+
+	// XY = UV scale, ZW = UV offset
+	vec4 baseColorUVTransform;
+	vec4 metallicUVTransform;
+	vec4 normalUVTransform;
+	vec4 emissiveUVTransform;
 };
 
 layout(set = 0, binding = 0) uniform Matricies
@@ -50,8 +68,15 @@ layout(set = 3, binding = 0) readonly buffer IndirectDrawAndMeshDataBuffer
 }
 indirectDrawAlias[4];
 
+layout(set = 3, binding = 0) readonly buffer MaterialBuffer
+{
+	Material materials[];
+}
+materialAlias[4];
+
 const int VERTEX_INDEX = 0;
 const int INDICES_INDEX = 1;
 const int INDIRECT_DRAW_INDEX = 2;
+const int MATERIAL_INDEX = 3;
 
 #endif
\ No newline at end of file
@@ -1,15 +1,37 @@
 #version 460
 #extension GL_KHR_vulkan_glsl : enable
 #extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
 
 #include "CommonStructs.glsl"
 
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 2, binding = 0) uniform sampler samplers[];
+
 layout(location = 0) in vec2 inTexCoord;
 layout(location = 1) in flat uint inMeshId;
+layout(location = 2) in flat int inMaterialIndex;
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-	outColor = vec4(0.5, 0.5, 0.5, 1.0f);
+	if(inMaterialIndex < 0)
+	{
+		outColor = vec4(0.5, 0.5, 0.5, 1.0f);
+		return;
+	}
+
+	Material material = materialAlias[MATERIAL_INDEX].materials[inMaterialIndex];
+	outColor = material.baseColor;
+
+	if(material.baseColorIDs.x >= 0.0 && material.baseColorIDs.y >= 0.0)
+	{
+		// Atlased textures only cover part of their page, the transform moves the mesh's UVs into that part
+		vec2 uv = inTexCoord * material.baseColorUVTransform.xy + material.baseColorUVTransform.zw;
+
+		uint textureId = uint(material.baseColorIDs.x);
+		uint samplerId = uint(material.baseColorIDs.y);
+		outColor *= texture(sampler2D(textures[nonuniformEXT(textureId)], samplers[nonuniformEXT(samplerId)]), uv);
+	}
 }
\ No newline at end of file
@@ -6,14 +6,16 @@
 
 layout(location = 0) out vec2 outTexCoord;
 layout(location = 1) out flat uint outMeshId;
+layout(location = 2) out flat int outMaterialIndex;
 
 void main()
 {
-	uint index = indexAlias[INDICES_INDEX].indices[gl_BaseVertex + gl_VertexIndex];
+	// The index buffer is bound and every draw's vertexOffset points into the shared vertex pool, so gl_VertexIndex already is the pool index
 	Vertex vertex = vertexAlias[VERTEX_INDEX].vertices[gl_VertexIndex];
 
-	gl_Position = MVP.projection * MVP.view * MVP.model * vertex.position;
-	outTexCoord = vertex.texCoord;
+	gl_Position = MVP.projection * MVP.view * MVP.model * vec4(vertex.positionX, vertex.positionY, vertex.positionZ, 1.0);
+	outTexCoord = vec2(vertex.texCoordU, vertex.texCoordV);
 
 	outMeshId = indirectDrawAlias[INDIRECT_DRAW_INDEX].meshDraws[gl_DrawID].meshId;
+	outMaterialIndex = indirectDrawAlias[INDIRECT_DRAW_INDEX].meshDraws[gl_DrawID].materialIndex;
 }
\ No newline at end of file